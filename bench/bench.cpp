@@ -0,0 +1,328 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "synthetic.hpp"
+#include "periodic.hpp"
+#include "dynamicParticles.hpp"
+
+#include "instrument.hpp"
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/random/uniform_int.hpp>
+#include <memory>
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+using namespace Colloids;
+
+/** @brief wall clock in seconds */
+double now()
+{
+	return (boost::posix_time::microsec_clock::universal_time() - boost::posix_time::ptime(boost::gregorian::date(2000,1,1))).total_microseconds() * 1e-6;
+}
+
+void setThreads(const size_t &threads)
+{
+#ifdef _OPENMP
+	omp_set_num_threads(threads);
+#endif
+}
+
+/** @brief memory order of the particles, written in the CSV output */
+string order = "generated";
+
+/** @brief one line of the CSV output */
+void report(const string &config, const bool periodic, const size_t &N, const string &kernel, const size_t &threads, const double &seconds, const double &items)
+{
+	const double throughput = seconds>0.0 ? items/seconds : 0.0;
+	cout << config << "," << (periodic?"periodic":"open") << "," << order << "," << N << "," << kernel << "," << threads << ","
+		<< seconds << "," << throughput << "," << throughput/threads << endl;
+}
+
+/** @brief mimic the detection order of a tracker: no relation between memory and space */
+void shuffle(Particles &parts, boost::mt19937 &rng)
+{
+	for(size_t p=parts.size(); p>1; --p)
+		swap(parts[p-1], parts[boost::uniform_int<size_t>(0, p-1)(rng)]);
+}
+
+/** @brief generate a configuration by name */
+Particles* generate(const string &config, const size_t &N, boost::mt19937 &rng)
+{
+	auto_ptr<Particles> parts(new Particles(0, 1.0));
+	if(config=="fcc")
+		makeCrystal(*parts, fcc, N, 0.05, rng);
+	else if(config=="hcp")
+		makeCrystal(*parts, hcp, N, 0.05, rng);
+	else if(config=="bcc")
+		makeCrystal(*parts, bcc, N, 0.05, rng);
+	else if(config=="rcp")
+		makeDisordered(*parts, N, 0.64, 50, rng);
+	else if(config=="liquid")
+		makeDisordered(*parts, N, 0.45, 10, rng);
+	else if(config=="dilute")
+		makeDilute(*parts, N, 0.05, rng);
+	else
+		throw invalid_argument("Unknown configuration "+config);
+	return parts.release();
+}
+
+/** @brief time the static kernels on a configuration */
+void benchStatic(const string &config, const bool periodic, Particles &parts, const size_t &threads)
+{
+	const size_t N = parts.size();
+	double t0 = now();
+	parts.makeRTreeIndex();
+	report(config, periodic, N, "index", threads, now()-t0, N);
+
+	const double range = 2.6 * parts.radius;
+	size_t nbNgb = 0;
+	t0 = now();
+	#pragma omp parallel for schedule(runtime) reduction(+:nbNgb)
+	for(ssize_t p=0; p<(ssize_t)N; ++p)
+		nbNgb += parts.getEuclidianNeighbours(p, range).size();
+	report(config, periodic, N, "getEuclidianNeighbours", threads, now()-t0, N);
+	cerr << config << " " << N << " particles, " << nbNgb/(double)N << " neighbours per particle" << endl;
+
+	vector<size_t> all(N);
+	for(size_t p=0; p<N; ++p)
+		all[p] = p;
+	t0 = now();
+	const QueryResults batch = parts.getEuclidianNeighbours(all, range);
+	report(config, periodic, N, "getEuclidianNeighbours.batch", threads, now()-t0, N);
+	if(batch.items.size() != nbNgb)
+		cerr << "batch queries found " << batch.items.size() << " neighbours instead of " << nbNgb << endl;
+
+	t0 = now();
+	parts.makeNgbList(1.3);
+	report(config, periodic, N, "makeNgbList", threads, now()-t0, N);
+
+	vector<BooData> qlm, qlm_cg, qlm_surf;
+	t0 = now();
+	parts.getBOOs(qlm);
+	report(config, periodic, N, "getBOOs", threads, now()-t0, N);
+
+	t0 = now();
+	parts.getCgBOOs(all, qlm, qlm_cg);
+	report(config, periodic, N, "getCgBOOs", threads, now()-t0, N);
+
+	t0 = now();
+	parts.getSurfBOOs(qlm_surf);
+	report(config, periodic, N, "getSurfBOOs", threads, now()-t0, N);
+
+	vector< vector<size_t> > SP5c;
+	t0 = now();
+	parts.getSP5c(SP5c);
+	report(config, periodic, N, "getSP5c", threads, now()-t0, N);
+
+	t0 = now();
+	parts.getRdf(200, 5.0);
+	report(config, periodic, N, "getRdf", threads, now()-t0, N);
+}
+
+/** @brief time the linking and the dynamics on a brownian trajectory */
+void benchDynamics(const string &config, const Particles &initial, const size_t &nbFrames, const size_t &threads, boost::mt19937 &rng)
+{
+	const size_t N = initial.size();
+	boost::ptr_vector<Particles> frames;
+	makeBrownian(initial, frames, nbFrames, 0.02, rng);
+
+	double t0 = now();
+	DynamicParticles dyn(frames, initial.radius, 1.0);
+	report(config, false, N, "link", threads, now()-t0, N*nbFrames);
+
+	t0 = now();
+	dyn.getMSD(0, nbFrames-1);
+	report(config, false, N, "getMSD", threads, now()-t0, N*nbFrames);
+
+	t0 = now();
+	dyn.getSelfISF(0, nbFrames-1);
+	report(config, false, N, "getSelfISF", threads, now()-t0, N*nbFrames);
+}
+
+/** @brief the neighbours of all the particles, each list sorted */
+size_t allNeighbours(const Particles &parts, const double &range, vector< vector<size_t> > &ngbs)
+{
+	ngbs.resize(parts.size());
+	size_t nbNgb = 0;
+	#pragma omp parallel for schedule(runtime) reduction(+:nbNgb)
+	for(ssize_t p=0; p<(ssize_t)parts.size(); ++p)
+	{
+		ngbs[p] = parts.getEuclidianNeighbours(p, range);
+		sort(ngbs[p].begin(), ngbs[p].end());
+		nbNgb += ngbs[p].size();
+	}
+	return nbNgb;
+}
+
+/**
+    @brief time how the spatial index follows a brownian trajectory, and the queries on it.
+    rebuild makes a new index at each frame, update gives the index of the previous frame to the next one.
+    The queries on an updated index are checked against a new index.
+*/
+void benchIndexing(const string &config, const Particles &initial, const size_t &nbFrames, const vector<string> &indexings, const size_t &threads, boost::mt19937 &rng)
+{
+	const size_t N = initial.size();
+	boost::ptr_vector<Particles> frames;
+	makeBrownian(initial, frames, nbFrames, 0.02, rng);
+	//the particles keep their position index from frame to frame
+	vector<size_t> ids(N);
+	for(size_t p=0; p<N; ++p)
+		ids[p] = p;
+	const double range = 2.6 * initial.radius;
+	vector< vector<size_t> > ngbs, expected;
+
+	for(size_t i=0; i<indexings.size(); ++i)
+	{
+		if(indexings[i]!="rebuild" && indexings[i]!="update")
+			throw invalid_argument("Unknown indexing "+indexings[i]);
+		const bool update = indexings[i]=="update";
+		double indexing = 0.0, querying = 0.0;
+		size_t nbWrong = 0;
+		for(size_t t=0; t<nbFrames; ++t)
+		{
+			double t0 = now();
+			if(!update)
+				frames[t].makeRTreeIndex();
+			else if(t)
+				frames[t-1].moveIndex(frames[t], ids);
+			else
+				frames[t].makeRTreeIndex(FrozenRStarIndex_S::updatableLeafSize);
+			indexing += now()-t0;
+
+			t0 = now();
+			allNeighbours(frames[t], range, ngbs);
+			querying += now()-t0;
+
+			if(update)
+			{
+				//copy the coordinates only, a copy of the particles would take the index
+				Particles fresh(static_cast<const vector<Coord>&>(frames[t]), frames[t].radius);
+				fresh.makeRTreeIndex();
+				allNeighbours(fresh, range, expected);
+				for(size_t p=0; p<N; ++p)
+					nbWrong += ngbs[p] != expected[p];
+			}
+		}
+		report(config, false, N, "index."+indexings[i], threads, indexing, N*nbFrames);
+		report(config, false, N, "getEuclidianNeighbours."+indexings[i], threads, querying, N*nbFrames);
+		if(nbWrong)
+			cerr << "the updated index gave wrong neighbours to " << nbWrong << " particles" << endl;
+	}
+}
+
+template<class T>
+vector<T> parseList(const string &arg)
+{
+	vector<string> tokens;
+	boost::split(tokens, arg, boost::is_any_of(","));
+	vector<T> values;
+	for(size_t i=0; i<tokens.size(); ++i)
+		values.push_back(boost::lexical_cast<T>(tokens[i]));
+	return values;
+}
+
+int main(int argc, char ** argv)
+{
+	Instrument::setToolName("bench");
+	if(argc<2)
+	{
+		cerr<<"Time the main kernels of the library on synthetic configurations"<<endl;
+		cerr<<"syntax: bench N [threads [configurations [boxes [frames [orders [indexings]]]]]]"<<endl;
+		cerr<<"N\tcomma separated numbers of particles, for example 1000,10000,100000"<<endl;
+		cerr<<"threads\tcomma separated numbers of threads (default 1)"<<endl;
+		cerr<<"configurations\tcomma separated among fcc,hcp,bcc,rcp,liquid,dilute (default all)"<<endl;
+		cerr<<"boxes\tcomma separated among open,periodic (default both)"<<endl;
+		cerr<<"frames\tnumber of frames of the brownian trajectory used to time the dynamics. 0 to skip (default 10)"<<endl;
+		cerr<<"orders\tcomma separated memory orders of the particles among generated,shuffled,morton,hilbert (default generated)."<<endl;
+		cerr<<"\tshuffled mimics the detection order of a tracker, morton and hilbert sort it along a space filling curve."<<endl;
+		cerr<<"indexings\tcomma separated ways for the spatial index to follow the brownian trajectory among rebuild,update, or none (default none)."<<endl;
+		cerr<<"\tupdate moves the index of each frame to the next one and checks its queries against a new index."<<endl;
+		cerr<<"Output on stdout in CSV format: config,box,order,N,kernel,threads,seconds,items_per_s,items_per_s_per_thread"<<endl;
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		const vector<size_t> sizes = parseList<size_t>(argv[1]);
+		const vector<size_t> threads = parseList<size_t>(argc>2 ? argv[2] : "1");
+		const vector<string> configs = parseList<string>(argc>3 ? argv[3] : "fcc,hcp,bcc,rcp,liquid,dilute");
+		const vector<string> boxes = parseList<string>(argc>4 ? argv[4] : "open,periodic");
+		const size_t nbFrames = argc>5 ? boost::lexical_cast<size_t>(argv[5]) : 10;
+		const vector<string> orders = parseList<string>(argc>6 ? argv[6] : "generated");
+		const vector<string> indexings = argc>7 && string(argv[7])!="none" ? parseList<string>(argv[7]) : vector<string>();
+
+		cout << "config,box,order,N,kernel,threads,seconds,items_per_s,items_per_s_per_thread" << endl;
+		for(size_t n=0; n<sizes.size(); ++n)
+			for(size_t c=0; c<configs.size(); ++c)
+			{
+				//same configuration for all boxes and thread numbers
+				boost::mt19937 rng(n * configs.size() + c);
+				const auto_ptr<Particles> generated(generate(configs[c], sizes[n], rng));
+				//the shuffled order is the starting point of the sorted orders
+				Particles shuffled(*generated);
+				shuffle(shuffled, rng);
+				for(size_t o=0; o<orders.size(); ++o)
+				{
+					order = orders[o];
+					Particles parts(order=="generated" ? *generated : shuffled);
+					if(order=="morton")
+						parts.sortSpatially(Particles::morton);
+					else if(order=="hilbert")
+						parts.sortSpatially(Particles::hilbert);
+					else if(order!="generated" && order!="shuffled")
+						throw invalid_argument("Unknown order "+order);
+					for(size_t th=0; th<threads.size(); ++th)
+					{
+						setThreads(threads[th]);
+						for(size_t b=0; b<boxes.size(); ++b)
+						{
+							if(boxes[b]=="open")
+							{
+								Particles open(parts);
+								benchStatic(configs[c], false, open, threads[th]);
+							}
+							else if(boxes[b]=="periodic")
+							{
+								PeriodicParticles periodic(parts);
+								benchStatic(configs[c], true, periodic, threads[th]);
+							}
+							else
+								throw invalid_argument("Unknown box "+boxes[b]);
+						}
+						if(nbFrames>1)
+							benchDynamics(configs[c], parts, nbFrames, threads[th], rng);
+						if(nbFrames>1 && !indexings.empty())
+							benchIndexing(configs[c], parts, nbFrames, indexings, threads[th], rng);
+					}
+				}
+			}
+	}
+	catch(const exception &e)
+	{
+		cerr<< e.what()<<endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
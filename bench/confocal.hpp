@@ -0,0 +1,391 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+
+ * \file confocal.hpp
+ * \brief Synthetic confocal stacks with known particle positions, to benchmark the trackers
+ * \author Mathieu Leocmach
+ * \date 18 October 2026
+ *
+ * Header only, so that both the tracker of libcolloids-graphic and the multiscale finder can use it.
+ */
+
+#ifndef confocal_H
+#define confocal_H
+
+#include <vector>
+#include <string>
+#include <ostream>
+#include <deque>
+#include <cmath>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/array.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_01.hpp>
+#include <boost/random/poisson_distribution.hpp>
+#include <boost/random/variate_generator.hpp>
+
+namespace Colloids
+{
+    /** \brief Parameters of a synthetic confocal stack. Lengths are in XY pixels. */
+    struct ConfocalParameters
+    {
+        /** \brief image size, z slowest, x fastest */
+        size_t nz, ny, nx;
+        size_t nbParticles;
+        /** \brief mean radius and relative standard deviation of the radii */
+        double radius, polydispersity;
+        /** \brief size of a voxel in z divided by its size in x and y */
+        double ZXratio;
+        /** \brief standard deviations of the gaussian point spread function in XY pixels */
+        double psfXY, psfZ;
+        /** \brief mean photon count inside a particle and in the background */
+        double photons, background;
+        /** \brief standard deviation of the gaussian read noise */
+        double readNoise;
+        /** \brief displacement of the whole sample between consecutive frames (x,y,z) */
+        boost::array<double,3> drift;
+        /** \brief standard deviation of the brownian displacement of each particle between consecutive frames */
+        double diffusion;
+
+        ConfocalParameters(const size_t &z=64, const size_t &y=128, const size_t &x=128) :
+            nz(z), ny(y), nx(x), nbParticles(0), radius(5.0), polydispersity(0.05), ZXratio(1.0),
+            psfXY(1.0), psfZ(2.5), photons(150.0), background(20.0), readNoise(3.0), diffusion(0.2)
+        {
+            drift[0] = 0.3;
+            drift[1] = 0.1;
+            drift[2] = 0.0;
+        };
+    };
+
+    /** \brief A particle of the ground truth. Coordinates in x,y,z order, all in XY pixels. */
+    struct TrueSphere
+    {
+        boost::array<double,3> center;
+        double r;
+    };
+
+    /**
+        \brief Generate a time series of noisy confocal stacks of polydisperse spheres.
+
+        Particles are placed without overlap by random sequential addition.
+        Each frame is rendered with antialiased edges, blurred by an anisotropic gaussian PSF,
+        then converted to photon counts with Poisson statistics plus gaussian read noise, and clamped to 8 bits.
+    */
+    class ConfocalStack
+    {
+        public:
+            explicit ConfocalStack(const ConfocalParameters &param, const unsigned seed=0);
+
+            const ConfocalParameters& getParameters() const {return param;};
+            /** \brief ground truth at the last rendered frame */
+            const std::vector<TrueSphere>& getSpheres() const {return spheres;};
+            size_t size() const {return param.nz * param.ny * param.nx;};
+
+            void render(std::vector<unsigned char> &image);
+            void next();
+
+        private:
+            ConfocalParameters param;
+            boost::mt19937 rng;
+            std::vector<TrueSphere> spheres;
+            std::vector<float> buffer;
+
+            void place();
+            void blur(const size_t &axis, const double &sigma);
+    };
+
+    /** \brief Accuracy of a set of tracked positions against the ground truth */
+    struct TrackingScore
+    {
+        size_t nbTrue, nbFound, nbMatched;
+        double rmsXY, rmsZ;
+        double recall() const {return nbTrue ? nbMatched/(double)nbTrue : 0.0;};
+        double precision() const {return nbFound ? nbMatched/(double)nbFound : 0.0;};
+    };
+
+    template<class InputIterator>
+    TrackingScore score(const std::vector<TrueSphere> &truth, InputIterator first, InputIterator last, const boost::array<double,3> &margin, const boost::array<double,3> &extent);
+
+    /** \brief CSV header of the tracking benchmarks */
+    inline void writeTrackingHeader(std::ostream &os)
+    {
+        os << "tracker,frame,stage,seconds,voxels_per_s,true,found,matched,recall,precision,rms_xy,rms_z" << std::endl;
+    }
+
+    /** \brief one CSV line per stage. The score is the one of the whole frame. */
+    inline void writeTrackingStage(std::ostream &os, const std::string &tracker, const size_t &frame, const std::string &stage, const double &seconds, const size_t &voxels, const TrackingScore &sc)
+    {
+        os << tracker << "," << frame << "," << stage << "," << seconds << "," << (seconds>0.0 ? voxels/seconds : 0.0) << ","
+            << sc.nbTrue << "," << sc.nbFound << "," << sc.nbMatched << "," << sc.recall() << "," << sc.precision() << ","
+            << sc.rmsXY << "," << sc.rmsZ << std::endl;
+    }
+
+    inline ConfocalStack::ConfocalStack(const ConfocalParameters &p, const unsigned seed) :
+        param(p), rng(seed)
+    {
+        if(param.nbParticles==0)
+        {
+            //about 30% volume fraction
+            const double v = 4.0*M_PI*pow(param.radius, 3.0)/3.0;
+            param.nbParticles = 0.3 * param.nx * param.ny * param.nz * param.ZXratio / v;
+        }
+        place();
+    }
+
+    /** \brief random sequential addition of non overlapping spheres */
+    inline void ConfocalStack::place()
+    {
+        boost::variate_generator<boost::mt19937&, boost::uniform_01<> > uni(rng, boost::uniform_01<>());
+        boost::variate_generator<boost::mt19937&, boost::normal_distribution<> > gauss(rng, boost::normal_distribution<>(param.radius, param.radius*param.polydispersity));
+        const double L[3] = {(double)param.nx, (double)param.ny, param.nz * param.ZXratio};
+        //cell list with cells larger than the largest diameter
+        const double cs = 2.0 * param.radius * (1.0 + 4.0 * param.polydispersity);
+        size_t nc[3];
+        for(size_t d=0; d<3; ++d)
+            nc[d] = std::max(1.0, std::floor(L[d]/cs));
+        std::vector< std::vector<size_t> > cells(nc[0]*nc[1]*nc[2]);
+        spheres.clear();
+        spheres.reserve(param.nbParticles);
+        size_t failures = 0;
+        while(spheres.size() < param.nbParticles && failures < 100 * param.nbParticles)
+        {
+            TrueSphere s;
+            s.r = std::max(0.5 * param.radius, std::min(gauss(), cs/2.0));
+            int ci[3];
+            for(size_t d=0; d<3; ++d)
+            {
+                s.center[d] = L[d] * uni();
+                ci[d] = std::min(nc[d]-1, (size_t)(s.center[d]/L[d]*nc[d]));
+            }
+            bool overlap = false;
+            for(int i=std::max(0, ci[0]-1); !overlap && i<=std::min((int)nc[0]-1, ci[0]+1); ++i)
+                for(int j=std::max(0, ci[1]-1); !overlap && j<=std::min((int)nc[1]-1, ci[1]+1); ++j)
+                    for(int k=std::max(0, ci[2]-1); !overlap && k<=std::min((int)nc[2]-1, ci[2]+1); ++k)
+                    {
+                        const std::vector<size_t> &cell = cells[(k*nc[1]+j)*nc[0]+i];
+                        for(size_t q=0; !overlap && q<cell.size(); ++q)
+                        {
+                            double distSq = 0.0;
+                            for(size_t d=0; d<3; ++d)
+                                distSq += pow(s.center[d] - spheres[cell[q]].center[d], 2);
+                            overlap = distSq < pow(s.r + spheres[cell[q]].r, 2);
+                        }
+                    }
+            if(overlap)
+            {
+                ++failures;
+                continue;
+            }
+            cells[(ci[2]*nc[1]+ci[1])*nc[0]+ci[0]].push_back(spheres.size());
+            spheres.push_back(s);
+        }
+    }
+
+    /** \brief move the particles to the next frame: global drift plus independent brownian steps. Overlaps are not prevented. */
+    inline void ConfocalStack::next()
+    {
+        boost::variate_generator<boost::mt19937&, boost::normal_distribution<> > gauss(rng, boost::normal_distribution<>(0.0, param.diffusion));
+        for(size_t p=0; p<spheres.size(); ++p)
+            for(size_t d=0; d<3; ++d)
+                spheres[p].center[d] += param.drift[d] + gauss();
+    }
+
+    /** \brief render the current frame into an 8 bits image (z slowest, x fastest) */
+    inline void ConfocalStack::render(std::vector<unsigned char> &image)
+    {
+        const ssize_t n[3] = {(ssize_t)param.nx, (ssize_t)param.ny, (ssize_t)param.nz};
+        buffer.assign(size(), 0.0f);
+        //antialiased spheres, fraction of the voxel inside estimated from the distance to the surface
+        #pragma omp parallel for schedule(dynamic)
+        for(ssize_t p=0; p<(ssize_t)spheres.size(); ++p)
+        {
+            const TrueSphere &s = spheres[p];
+            const double c[3] = {s.center[0], s.center[1], s.center[2]/param.ZXratio};
+            const double r[3] = {s.r+1, s.r+1, (s.r+1)/param.ZXratio};
+            ssize_t lo[3], hi[3];
+            for(size_t d=0; d<3; ++d)
+            {
+                lo[d] = std::max((ssize_t)0, (ssize_t)std::floor(c[d]-r[d]));
+                hi[d] = std::min(n[d]-1, (ssize_t)std::ceil(c[d]+r[d]));
+            }
+            for(ssize_t k=lo[2]; k<=hi[2]; ++k)
+                for(ssize_t j=lo[1]; j<=hi[1]; ++j)
+                    for(ssize_t i=lo[0]; i<=hi[0]; ++i)
+                    {
+                        const double dist = std::sqrt(pow(i-c[0], 2) + pow(j-c[1], 2) + pow((k-c[2])*param.ZXratio, 2));
+                        const float v = std::max(0.0, std::min(1.0, s.r - dist + 0.5));
+                        if(v>0.0f)
+                        {
+                            float &px = buffer[(k*n[1]+j)*n[0]+i];
+                            //spheres do not overlap at the first frame, but may later on
+                            #pragma omp atomic
+                            px += v;
+                        }
+                    }
+        }
+        blur(0, param.psfXY);
+        blur(1, param.psfXY);
+        blur(2, param.psfZ/param.ZXratio);
+
+        //photon statistics and read noise
+        image.resize(size());
+        boost::variate_generator<boost::mt19937&, boost::normal_distribution<> > read(rng, boost::normal_distribution<>(0.0, param.readNoise));
+        for(size_t i=0; i<buffer.size(); ++i)
+        {
+            const double mean = param.background + param.photons * std::min(1.0f, buffer[i]);
+            double count;
+            if(mean < 50.0)
+            {
+                boost::variate_generator<boost::mt19937&, boost::poisson_distribution<> > poisson(rng, boost::poisson_distribution<>(mean));
+                count = poisson();
+            }
+            else
+            {
+                //gaussian approximation of the Poisson distribution at large counts
+                boost::variate_generator<boost::mt19937&, boost::normal_distribution<> > poisson(rng, boost::normal_distribution<>(mean, std::sqrt(mean)));
+                count = poisson();
+            }
+            image[i] = (unsigned char)std::max(0.0, std::min(255.0, count + read() + 0.5));
+        }
+    }
+
+    /** \brief separable gaussian blur of the buffer along one axis (0 for x, 2 for z) */
+    inline void ConfocalStack::blur(const size_t &axis, const double &sigma)
+    {
+        if(sigma <= 0.0)
+            return;
+        const ssize_t n[3] = {(ssize_t)param.nx, (ssize_t)param.ny, (ssize_t)param.nz};
+        const ssize_t stride = axis==0 ? 1 : (axis==1 ? n[0] : n[0]*n[1]);
+        const ssize_t halfWidth = std::ceil(3.0 * sigma);
+        std::vector<float> kernel(2*halfWidth+1);
+        for(ssize_t i=-halfWidth; i<=halfWidth; ++i)
+            kernel[i+halfWidth] = std::exp(-0.5*i*i/sigma/sigma);
+        const float sum = std::accumulate(kernel.begin(), kernel.end(), 0.0f);
+        for(size_t i=0; i<kernel.size(); ++i)
+            kernel[i] /= sum;
+        //each line along the axis is convolved independently
+        const ssize_t length = n[axis], nbLines = size() / length;
+        #pragma omp parallel
+        {
+            std::vector<float> line(length);
+            #pragma omp for schedule(static)
+            for(ssize_t l=0; l<nbLines; ++l)
+            {
+                //offset of the first pixel of the line
+                ssize_t offset;
+                if(axis==0)
+                    offset = l * n[0];
+                else if(axis==1)
+                    offset = (l / n[0]) * n[0] * n[1] + l % n[0];
+                else
+                    offset = l;
+                for(ssize_t i=0; i<length; ++i)
+                    line[i] = buffer[offset + i*stride];
+                for(ssize_t i=0; i<length; ++i)
+                {
+                    float v = 0.0f;
+                    for(ssize_t m=std::max((ssize_t)0, i-halfWidth); m<=std::min(length-1, i+halfWidth); ++m)
+                        v += kernel[m-i+halfWidth] * line[m];
+                    buffer[offset + i*stride] = v;
+                }
+            }
+        }
+    }
+
+    /**
+        \brief Match tracked positions to the ground truth.
+
+        Only the true particles farther than margin from the sides of the extent (in x,y,z) are expected to be found,
+        and only the tracked positions in the same region are counted.
+        Each true particle is matched to the closest tracked position closer than its radius.
+        \param first iterator on tracked positions, in x,y,z order and XY pixel units
+    */
+    template<class InputIterator>
+    TrackingScore score(const std::vector<TrueSphere> &truth, InputIterator first, InputIterator last, const boost::array<double,3> &margin, const boost::array<double,3> &extent)
+    {
+        TrackingScore sc;
+        sc.nbTrue = 0;
+        sc.nbFound = 0;
+        sc.nbMatched = 0;
+        sc.rmsXY = 0.0;
+        sc.rmsZ = 0.0;
+        std::vector< boost::array<double,3> > found;
+        for(; first!=last; ++first)
+        {
+            boost::array<double,3> c;
+            bool inside = true;
+            for(size_t d=0; d<3; ++d)
+            {
+                c[d] = (*first)[d];
+                inside &= c[d] >= margin[d] && c[d] <= extent[d]-margin[d];
+            }
+            found.push_back(c);
+            if(inside)
+                sc.nbFound++;
+        }
+        //sort the found positions by x to limit the search
+        std::sort(found.begin(), found.end());
+        std::vector<bool> used(found.size(), false);
+        for(size_t p=0; p<truth.size(); ++p)
+        {
+            const TrueSphere &s = truth[p];
+            bool inside = true;
+            for(size_t d=0; d<3; ++d)
+                inside &= s.center[d] >= margin[d] && s.center[d] <= extent[d]-margin[d];
+            if(!inside)
+                continue;
+            sc.nbTrue++;
+            boost::array<double,3> low = s.center;
+            low[0] -= s.r;
+            ssize_t best = -1;
+            double bestSq = s.r * s.r;
+            for(size_t f = std::lower_bound(found.begin(), found.end(), low) - found.begin(); f<found.size() && found[f][0] <= s.center[0]+s.r; ++f)
+            {
+                if(used[f])
+                    continue;
+                double distSq = 0.0;
+                for(size_t d=0; d<3; ++d)
+                    distSq += pow(found[f][d]-s.center[d], 2);
+                if(distSq < bestSq)
+                {
+                    bestSq = distSq;
+                    best = f;
+                }
+            }
+            if(best<0)
+                continue;
+            used[best] = true;
+            sc.nbMatched++;
+            sc.rmsXY += pow(found[best][0]-s.center[0], 2) + pow(found[best][1]-s.center[1], 2);
+            sc.rmsZ += pow(found[best][2]-s.center[2], 2);
+        }
+        //a particle matched but found slightly outside the region is not a false positive
+        sc.nbFound = std::max(sc.nbFound, sc.nbMatched);
+        if(sc.nbMatched)
+        {
+            sc.rmsXY = std::sqrt(sc.rmsXY / sc.nbMatched);
+            sc.rmsZ = std::sqrt(sc.rmsZ / sc.nbMatched);
+        }
+        return sc;
+    }
+}
+
+#endif
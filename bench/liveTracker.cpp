@@ -0,0 +1,159 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "confocal.hpp"
+#include "liveTracker.hpp"
+
+#include "instrument.hpp"
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/lexical_cast.hpp>
+#include <fstream>
+#include <cstring>
+
+using namespace std;
+using namespace Colloids;
+using namespace boost::posix_time;
+
+/** \brief camera replaying frames rendered in advance */
+class MemorySource : public FrameSource
+{
+	const vector< vector<unsigned char> > &frames;
+	size_t width, height, t;
+
+	public:
+		MemorySource(const vector< vector<unsigned char> > &frames, const size_t &width, const size_t &height) :
+			frames(frames), width(width), height(height), t(0) {};
+		size_t getWidth() const {return width;};
+		size_t getHeight() const {return height;};
+		bool grab(unsigned char *buffer)
+		{
+			const vector<unsigned char> &f = frames[t++ % frames.size()];
+			memcpy(buffer, &f[0], f.size());
+			return true;
+		}
+};
+
+/** \brief score the first frames against the ground truth, ignore the others */
+struct Scorer : public LiveConsumer
+{
+	const vector< vector<TrueSphere> > &truth;
+	boost::array<double,3> margin, extent;
+	vector<TrackingScore> scores;
+
+	Scorer(const vector< vector<TrueSphere> > &truth, const boost::array<double,3> &margin, const boost::array<double,3> &extent) :
+		truth(truth), margin(margin), extent(extent) {};
+
+	void operator()(const size_t &frame, const vector<LiveCenter> &centers)
+	{
+		if(frame >= truth.size())
+			return;
+		//in the plane of the ground truth
+		vector< boost::array<double,3> > found(centers.size());
+		for(size_t c=0; c<centers.size(); ++c)
+		{
+			found[c][0] = centers[c].x;
+			found[c][1] = centers[c].y;
+			found[c][2] = 0.0;
+		}
+		scores.push_back(score(truth[frame], found.begin(), found.end(), margin, extent));
+	}
+};
+
+double elapsed(const ptime &past)
+{
+	return (microsec_clock::universal_time() - past).total_microseconds() * 1e-6;
+}
+
+int main(int argc, char ** argv)
+{
+	Instrument::setToolName("bench_live_tracker");
+	if(argc<2)
+	{
+		cerr<<"Time LiveTracker2D streaming synthetic 2D frames and score it against the ground truth"<<endl;
+		cerr<<"syntax: bench_live_tracker output.csv [ny nx [radius [frames [workers]]]]"<<endl;
+		cerr<<"Default is 1024x1024 frames of particles of radius 5 pixels, 200 frames, 1 worker."<<endl;
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		ConfocalParameters param(1, 1024, 1024);
+		if(argc>3)
+		{
+			param.ny = boost::lexical_cast<size_t>(argv[2]);
+			param.nx = boost::lexical_cast<size_t>(argv[3]);
+		}
+		if(argc>4)
+			param.radius = boost::lexical_cast<double>(argv[4]);
+		const size_t nbFrames = argc>5 ? boost::lexical_cast<size_t>(argv[5]) : 200;
+		const size_t nbWorkers = argc>6 ? boost::lexical_cast<size_t>(argv[6]) : 1;
+		//a single slice through the middle of the particles: no blur along z. 40% of the area covered
+		param.psfZ = 0.0;
+		param.nbParticles = 0.4 * param.nx * param.ny / (M_PI * param.radius * param.radius);
+
+		ofstream out(argv[1]);
+		if(!out.good())
+			throw invalid_argument((string("Cannot open ")+argv[1]).c_str());
+		writeTrackingHeader(out);
+
+		//a few distinct frames, replayed
+		ConfocalStack stack(param);
+		const size_t nbDistinct = min(nbFrames, (size_t)4);
+		vector< vector<unsigned char> > frames(nbDistinct);
+		vector< vector<TrueSphere> > truth(nbDistinct);
+		for(size_t t=0; t<nbDistinct; ++t)
+		{
+			if(t)
+				stack.next();
+			stack.render(frames[t]);
+			truth[t] = stack.getSpheres();
+		}
+		cout << truth[0].size() << " particles in the plane" << endl;
+
+		const boost::array<double,3> margin = {{2.0*param.radius+1.0, 2.0*param.radius+1.0, -1.0}},
+			extent = {{(double)param.nx, (double)param.ny, 1.0}};
+		const char* names[2] = {"LiveTracker2D_real", "LiveTracker2D_fourier"};
+		for(int f=0; f<2; ++f)
+		{
+			LiveTracker2D::Parameters p(param.radius);
+			p.filter = (LiveTracker2D::Filter)f;
+			const ptime plan = microsec_clock::universal_time();
+			LiveTracker2D tracker(param.ny, param.nx, p, nbWorkers);
+			cout << names[f] << " setup " << elapsed(plan) << "s" << endl;
+
+			MemorySource source(frames, param.nx, param.ny);
+			Scorer scorer(truth, margin, extent);
+			const ptime past = microsec_clock::universal_time();
+			const size_t n = tracker.stream(source, scorer, nbFrames);
+			const double seconds = elapsed(past);
+			for(size_t t=0; t<scorer.scores.size(); ++t)
+				writeTrackingStage(out, names[f], t, "stream", seconds/n, param.nx*param.ny, scorer.scores[t]);
+			const TrackingScore &sc = scorer.scores.front();
+			cout << names[f] << " " << n/seconds << " fps with " << nbWorkers << " worker(s), recall=" << sc.recall()
+				<< " precision=" << sc.precision() << " rms xy=" << sc.rmsXY << endl;
+		}
+	}
+	catch(const exception &e)
+	{
+		cerr<< e.what()<<endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,156 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "synthetic.hpp"
+#include "periodic.hpp"
+#include "dynamicParticles.hpp"
+
+#include <boost/lexical_cast.hpp>
+#include <memory>
+
+using namespace std;
+using namespace Colloids;
+
+/** @brief largest difference between two series, absolute and relative to the largest value of the reference */
+struct Deviation
+{
+	double absolute, relative;
+
+	Deviation(const vector<double> &reference, const vector<double> &tested) : absolute(0.0), relative(0.0)
+	{
+		double scale = 0.0;
+		for(size_t i=0; i<reference.size(); ++i)
+		{
+			absolute = max(absolute, fabs(tested[i]-reference[i]));
+			scale = max(scale, fabs(reference[i]));
+		}
+		if(scale>0.0)
+			relative = absolute / scale;
+	}
+};
+
+size_t nbFailures = 0;
+
+/** @brief one line of the CSV output */
+void report(const string &config, const string &quantity, const Deviation &dev, const double &tolerance)
+{
+	const bool ok = dev.relative <= tolerance;
+	if(!ok)
+		++nbFailures;
+	cout << config << "," << quantity << "," << dev.absolute << "," << dev.relative << "," << tolerance << "," << (ok?"ok":"FAILED") << endl;
+}
+
+/** @brief Ql of every particle computed in double and from single precision storage */
+void compareBOO(const string &config, Particles &parts)
+{
+	parts.makeRTreeIndex();
+	parts.makeNgbList(1.3);
+	vector<size_t> all(parts.size());
+	for(size_t p=0; p<all.size(); ++p)
+		all[p] = p;
+	BooArray<double> qlm, qlm_cg;
+	BooArray<float> qlm_f, qlm_cg_f;
+	parts.getBOOs_packed(qlm);
+	parts.getCgBOOs_packed(all, qlm, qlm_cg);
+	parts.getBOOs_packed(qlm_f);
+	parts.getCgBOOs_packed(all, qlm_f, qlm_cg_f);
+	const size_t ls[2] = {4, 6};
+	for(size_t i=0; i<2; ++i)
+	{
+		vector<double> Q(parts.size()), Q_f(parts.size()), Qcg(parts.size()), Qcg_f(parts.size());
+		for(size_t p=0; p<parts.size(); ++p)
+		{
+			Q[p] = qlm.getQl(p, ls[i]);
+			Q_f[p] = qlm_f.getQl(p, ls[i]);
+			Qcg[p] = qlm_cg.getQl(p, ls[i]);
+			Qcg_f[p] = qlm_cg_f.getQl(p, ls[i]);
+		}
+		const string l = boost::lexical_cast<string>(ls[i]);
+		report(config, "Q"+l, Deviation(Q, Q_f), 1e-4);
+		report(config, "cgQ"+l, Deviation(Qcg, Qcg_f), 1e-4);
+	}
+}
+
+/** @brief g(r) computed in double and from single precision storage */
+void compareRdf(const string &config, const Particles &parts)
+{
+	vector<size_t> inside = parts.selectInside(5.0*2.0*parts.radius);
+	Particles::RdfBinner b(parts, 200, 5.0), b_f(parts, 200, 5.0);
+	b.fill_packed<double>(inside);
+	b_f.fill_packed<float>(inside);
+	b.normalize(inside.size());
+	b_f.normalize(inside.size());
+	//a few pairs may change bin
+	report(config, "g(r)", Deviation(b.g, b_f.g), 1e-2);
+}
+
+/** @brief MSD computed in double and from single precision storage */
+void compareMSD(const string &config, const Particles &initial, const size_t &nbFrames, boost::mt19937 &rng)
+{
+	boost::ptr_vector<Particles> frames;
+	makeBrownian(initial, frames, nbFrames, 0.02, rng);
+	DynamicParticles dyn(frames, initial.radius, 1.0);
+	const vector<size_t> selection = dyn.selectSpanning(Interval(0, nbFrames-1));
+	report(config, "MSD", Deviation(dyn.getMSD_packed<double>(selection, 0, nbFrames-1), dyn.getMSD_packed<float>(selection, 0, nbFrames-1)), 1e-4);
+}
+
+int main(int argc, char ** argv)
+{
+	if(argc<2)
+	{
+		cerr<<"Compare the analyses in single precision storage to the double precision path"<<endl;
+		cerr<<"syntax: bench_precision N [frames]"<<endl;
+		cerr<<"N\tnumber of particles of each synthetic configuration (fcc, liquid, periodic fcc)"<<endl;
+		cerr<<"frames\tnumber of frames of the brownian trajectory used for the MSD (default 10)"<<endl;
+		cerr<<"Output on stdout in CSV format: config,quantity,max_abs_diff,max_rel_diff,tolerance,status"<<endl;
+		cerr<<"Exit status is non zero if any quantity is out of tolerance"<<endl;
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		const size_t N = boost::lexical_cast<size_t>(argv[1]);
+		const size_t nbFrames = argc>2 ? boost::lexical_cast<size_t>(argv[2]) : 10;
+		boost::mt19937 rng(0);
+		cout << "config,quantity,max_abs_diff,max_rel_diff,tolerance,status" << endl;
+
+		Particles crystal(0, 1.0), liquid(0, 1.0);
+		makeCrystal(crystal, fcc, N, 0.05, rng);
+		makeDisordered(liquid, N, 0.45, 10, rng);
+		PeriodicParticles periodic(crystal);
+
+		compareBOO("fcc", crystal);
+		compareBOO("liquid", liquid);
+		compareBOO("periodic fcc", periodic);
+		compareRdf("fcc", crystal);
+		compareRdf("liquid", liquid);
+		compareRdf("periodic fcc", periodic);
+		if(nbFrames>1)
+		{
+			compareMSD("fcc", crystal, nbFrames, rng);
+			compareMSD("liquid", liquid, nbFrames, rng);
+		}
+	}
+	catch(const exception &e)
+	{
+		cerr<<e.what()<<endl;
+		return EXIT_FAILURE;
+	}
+	return nbFailures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
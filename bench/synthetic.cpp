@@ -0,0 +1,203 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "synthetic.hpp"
+
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_01.hpp>
+#include <boost/random/variate_generator.hpp>
+
+using namespace std;
+using namespace Colloids;
+
+typedef boost::variate_generator<boost::mt19937&, boost::normal_distribution<> > Normal;
+typedef boost::variate_generator<boost::mt19937&, boost::uniform_01<> > Uniform;
+
+/** @brief set a cubic box and fold the positions inside */
+void setBox(Particles &parts, const double &L)
+{
+	for(size_t d=0; d<3; ++d)
+	{
+		parts.bb.edges[d].first = 0.0;
+		parts.bb.edges[d].second = L;
+	}
+	for(Particles::iterator p=parts.begin(); p!=parts.end(); ++p)
+		for(size_t d=0; d<3; ++d)
+			(*p)[d] -= L * floor((*p)[d] / L);
+}
+
+/** @brief box size to get a volume fraction phi with N particles */
+double boxSize(const Particles &parts, const size_t &N, const double &phi)
+{
+	return pow(N * 4.0 * M_PI * pow(parts.radius, 3.0) / 3.0 / phi, 1.0/3.0);
+}
+
+/** @brief Crystal with nearest neighbour distance of one diameter, plus gaussian noise.
+  *
+  * \param N Approximate number of particles. The box contains an integer number of unit cells in each direction.
+  * \param noise Standard deviation of the noise, in diameters
+  */
+void Colloids::makeCrystal(Particles &parts, const Lattice lattice, const size_t &N, const double &noise, boost::mt19937 &rng)
+{
+	const double a = 2.0 * parts.radius;
+	//unit cell (cubic except for hcp) and basis in fractions of the cell
+	vector<Coord> basis;
+	Coord cell(3);
+	switch(lattice)
+	{
+	case fcc:
+		cell = a * sqrt(2.0);
+		{
+			const double b[4][3] = {{0,0,0}, {.5,.5,0}, {.5,0,.5}, {0,.5,.5}};
+			for(size_t i=0; i<4; ++i)
+				basis.push_back(Coord(b[i], 3));
+		}
+		break;
+	case bcc:
+		cell = 2.0 * a / sqrt(3.0);
+		{
+			const double b[2][3] = {{0,0,0}, {.5,.5,.5}};
+			for(size_t i=0; i<2; ++i)
+				basis.push_back(Coord(b[i], 3));
+		}
+		break;
+	case hcp:
+		cell[0] = a;
+		cell[1] = a * sqrt(3.0);
+		cell[2] = a * sqrt(8.0/3.0);
+		{
+			const double b[4][3] = {{0,0,0}, {.5,.5,0}, {.5,5.0/6.0,.5}, {0,1.0/3.0,.5}};
+			for(size_t i=0; i<4; ++i)
+				basis.push_back(Coord(b[i], 3));
+		}
+		break;
+	}
+	//same number of cells in each direction, the box is cubic only for cubic cells
+	const size_t m = max(1.0, ceil(pow(N / (double)basis.size(), 1.0/3.0)));
+	parts.assign(m*m*m*basis.size(), Coord(0.0, 3));
+	Normal gauss(rng, boost::normal_distribution<>(0.0, noise * a));
+	Particles::iterator p = parts.begin();
+	for(size_t i=0; i<m; ++i)
+		for(size_t j=0; j<m; ++j)
+			for(size_t k=0; k<m; ++k)
+				for(size_t b=0; b<basis.size(); ++b, ++p)
+				{
+					(*p)[0] = (i + basis[b][0]) * cell[0] + gauss();
+					(*p)[1] = (j + basis[b][1]) * cell[1] + gauss();
+					(*p)[2] = (k + basis[b][2]) * cell[2] + gauss();
+				}
+	for(size_t d=0; d<3; ++d)
+	{
+		parts.bb.edges[d].first = 0.0;
+		parts.bb.edges[d].second = m * cell[d];
+	}
+	for(p=parts.begin(); p!=parts.end(); ++p)
+		for(size_t d=0; d<3; ++d)
+			(*p)[d] -= m * cell[d] * floor((*p)[d] / (m * cell[d]));
+}
+
+/** @brief Dense disordered packing: random positions relaxed by removing overlaps
+  *
+  * At each sweep, every overlapping pair is pushed apart by half its overlap (periodic boundary conditions).
+  * A few sweeps give a liquid-like structure; many sweeps at phi>0.6 approach a jammed packing.
+  */
+void Colloids::makeDisordered(Particles &parts, const size_t &N, const double &phi, const size_t &sweeps, boost::mt19937 &rng)
+{
+	makeDilute(parts, N, phi, rng);
+	const double L = parts.bb.edges[0].second, sigma = 2.0 * parts.radius;
+	//cell list with cells larger than a diameter
+	const size_t nc = max(1.0, floor(L / sigma));
+	const double cs = L / nc;
+	vector<int> head(nc*nc*nc), next(N);
+	vector<Coord> moves(N, Coord(0.0, 3));
+	for(size_t s=0; s<sweeps; ++s)
+	{
+		fill(head.begin(), head.end(), -1);
+		for(size_t p=0; p<N; ++p)
+		{
+			size_t c = 0;
+			for(size_t d=0; d<3; ++d)
+				c = c*nc + min(nc-1, (size_t)(parts[p][d] / cs));
+			next[p] = head[c];
+			head[c] = p;
+		}
+		#pragma omp parallel for schedule(static)
+		for(int p=0; p<(int)N; ++p)
+		{
+			moves[p] = 0.0;
+			int ci[3];
+			for(size_t d=0; d<3; ++d)
+				ci[d] = min(nc-1, (size_t)(parts[p][d] / cs));
+			for(int i=-1; i<=1; ++i)
+				for(int j=-1; j<=1; ++j)
+					for(int k=-1; k<=1; ++k)
+					{
+						const int c = (((ci[0]+i+nc)%nc)*nc + (ci[1]+j+nc)%nc)*nc + (ci[2]+k+nc)%nc;
+						for(int q=head[c]; q>=0; q=next[q])
+						{
+							if(q==p)
+								continue;
+							Coord diff = parts[p] - parts[q];
+							for(size_t d=0; d<3; ++d)
+								diff[d] -= L * floor(diff[d] / L + 0.5);
+							const double dist = sqrt(dot(diff, diff));
+							if(dist < sigma && dist > 0.0)
+								moves[p] += diff * (0.5 * (sigma - dist) / dist);
+						}
+					}
+		}
+		for(size_t p=0; p<N; ++p)
+			parts[p] += moves[p];
+		setBox(parts, L);
+		//with nc<3 the neighbouring cells are visited several times
+		if(nc<3)
+			break;
+	}
+}
+
+/** @brief Uniformly random positions, overlaps allowed */
+void Colloids::makeDilute(Particles &parts, const size_t &N, const double &phi, boost::mt19937 &rng)
+{
+	const double L = boxSize(parts, N, phi);
+	Uniform uni(rng, boost::uniform_01<>());
+	parts.assign(N, Coord(0.0, 3));
+	for(Particles::iterator p=parts.begin(); p!=parts.end(); ++p)
+		for(size_t d=0; d<3; ++d)
+			(*p)[d] = L * uni();
+	setBox(parts, L);
+}
+
+/** @brief Frames of a brownian motion starting from a configuration. Positions are not folded into the box.
+  *
+  * \param step Standard deviation of the displacement per frame and per direction, in diameters
+  */
+void Colloids::makeBrownian(const Particles &initial, boost::ptr_vector<Particles> &frames, const size_t &nbFrames, const double &step, boost::mt19937 &rng)
+{
+	Normal gauss(rng, boost::normal_distribution<>(0.0, step * 2.0 * initial.radius));
+	frames.clear();
+	for(size_t t=0; t<nbFrames; ++t)
+	{
+		Particles *parts = new Particles(t ? frames.back() : initial);
+		if(t)
+			for(Particles::iterator p=parts->begin(); p!=parts->end(); ++p)
+				for(size_t d=0; d<3; ++d)
+					(*p)[d] += gauss();
+		frames.push_back(parts);
+	}
+}
@@ -0,0 +1,45 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+
+ * \file synthetic.hpp
+ * \brief Generators of synthetic particle configurations for benchmarking
+ * \author Mathieu Leocmach
+ * \date 18 October 2026
+ *
+ */
+
+#ifndef synthetic_H
+#define synthetic_H
+
+#include "particles.hpp"
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+namespace Colloids
+{
+    enum Lattice {fcc, hcp, bcc};
+
+    /** \brief Configurations are generated in a cubic box [0,L)^3 stored in bb. Positions are folded into the box. */
+    void makeCrystal(Particles &parts, const Lattice lattice, const size_t &N, const double &noise, boost::mt19937 &rng);
+    void makeDisordered(Particles &parts, const size_t &N, const double &phi, const size_t &sweeps, boost::mt19937 &rng);
+    void makeDilute(Particles &parts, const size_t &N, const double &phi, boost::mt19937 &rng);
+    void makeBrownian(const Particles &initial, boost::ptr_vector<Particles> &frames, const size_t &nbFrames, const double &step, boost::mt19937 &rng);
+}
+
+#endif
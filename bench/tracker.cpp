@@ -0,0 +1,124 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "confocal.hpp"
+#include "tracker.hpp"
+
+#include "instrument.hpp"
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/lexical_cast.hpp>
+#include <fstream>
+
+using namespace std;
+using namespace Colloids;
+using namespace boost::posix_time;
+
+double elapsed(const ptime &past)
+{
+	return (microsec_clock::universal_time() - past).total_microseconds() * 1e-6;
+}
+
+int main(int argc, char ** argv)
+{
+	Instrument::setToolName("bench_tracker");
+	if(argc<2)
+	{
+		cerr<<"Time the stages of Tracker::trackXYZ on synthetic confocal stacks and score them against the ground truth"<<endl;
+		cerr<<"syntax: bench_tracker output.csv [nz ny nx [radius [frames [ZXratio]]]]"<<endl;
+		cerr<<"Default is a 64x128x128 stack of particles of radius 5 pixels, 3 frames, cubic voxels."<<endl;
+		return EXIT_FAILURE;
+	}
+
+	try
+	{
+		ConfocalParameters param;
+		if(argc>4)
+		{
+			param.nz = boost::lexical_cast<size_t>(argv[2]);
+			param.ny = boost::lexical_cast<size_t>(argv[3]);
+			param.nx = boost::lexical_cast<size_t>(argv[4]);
+		}
+		if(argc>5)
+			param.radius = boost::lexical_cast<double>(argv[5]);
+		const size_t nbFrames = argc>6 ? boost::lexical_cast<size_t>(argv[6]) : 3;
+		if(argc>7)
+			param.ZXratio = boost::lexical_cast<double>(argv[7]);
+
+		ofstream out(argv[1]);
+		if(!out.good())
+			throw invalid_argument((string("Cannot open ")+argv[1]).c_str());
+		writeTrackingHeader(out);
+
+		ConfocalStack stack(param);
+		cout << stack.getSpheres().size() << " particles" << endl;
+		boost::array<size_t,3> dims = {{param.nz, param.ny, param.nx}};
+		Tracker tracker(dims);
+		tracker.view = false;
+		tracker.quiet = true;
+		tracker.fortran_order = true;
+		//same band pass as TrackerIterator::setIsotropicBandPass, in row major order
+		const double radiusMin = param.radius/2.0, radiusMax = 4.0*param.radius;
+		boost::array<double,3>
+			radiiMin = {{radiusMin/param.ZXratio, radiusMin, radiusMin}},
+			radiiMax = {{radiusMax/param.ZXratio, radiusMax, radiusMax}};
+		tracker.makeBandPassMask(radiiMin, radiiMax);
+
+		//particles closer than 6 pixels to the sides are not detected by the tracker
+		boost::array<double,3> margin = {{param.radius+6.0, param.radius+6.0, (param.radius+6.0)*param.ZXratio}},
+			extent = {{(double)param.nx, (double)param.ny, param.nz*param.ZXratio}};
+		vector<unsigned char> image;
+		for(size_t t=0; t<nbFrames; ++t)
+		{
+			if(t)
+				stack.next();
+			stack.render(image);
+
+			//stages of trackXYZ, with the default thresholding of TrackerIterator
+			double times[4];
+			ptime past = microsec_clock::universal_time();
+			tracker.fillImage_charToUchar(image.begin());
+			times[0] = elapsed(past);
+			past = microsec_clock::universal_time();
+			tracker.FFTapplyMask();
+			times[1] = elapsed(past);
+			past = microsec_clock::universal_time();
+			tracker.findPixelCenters(tracker.mean);
+			times[2] = elapsed(past);
+			past = microsec_clock::universal_time();
+			Particles centers = tracker.getSubPixel(true);
+			times[3] = elapsed(past);
+
+			for(Particles::iterator p=centers.begin(); p!=centers.end(); ++p)
+				(*p)[2] *= param.ZXratio;
+			const TrackingScore sc = score(stack.getSpheres(), centers.begin(), centers.end(), margin, extent);
+			const char* stages[4] = {"fill", "bandpass", "pixelCenters", "subpix"};
+			for(size_t s=0; s<4; ++s)
+				writeTrackingStage(out, "Tracker", t, stages[s], times[s], stack.size(), sc);
+			writeTrackingStage(out, "Tracker", t, "trackXYZ", times[1]+times[2]+times[3], stack.size(), sc);
+			cout << "t=" << t << " recall=" << sc.recall() << " precision=" << sc.precision() << " rms xy=" << sc.rmsXY << " z=" << sc.rmsZ << endl;
+		}
+	}
+	catch(const exception &e)
+	{
+		cerr<< e.what()<<endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,462 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "liveTracker.hpp"
+#include "instrument.hpp"
+#include "cpuDispatch.hpp"
+
+#include <fstream>
+#include <stdexcept>
+#include <cmath>
+#include <algorithm>
+#include <new>
+
+using namespace std;
+using namespace Colloids;
+
+namespace {
+	/** \brief out[k] = sum_t taps[t]*line[k+t], for k in [0,n). The taps are symmetric and odd in number */
+	inline void convolveRow_impl(const float *line, const float *taps, const size_t nbTaps, float *out, const size_t n)
+	{
+		const size_t half = nbTaps/2;
+		const float c = taps[half];
+		for(size_t k=0; k<n; ++k)
+			out[k] = c * line[k+half];
+		for(size_t t=0; t<half; ++t)
+		{
+			const float w = taps[t];
+			const float *l = line + t, *r = line + nbTaps-1-t;
+			for(size_t k=0; k<n; ++k)
+				out[k] += w * (l[k] + r[k]);
+		}
+	}
+
+	/**
+		\brief One row of the vertical pass of the real space band pass.
+		out[k] = max(0, sum_t taps[t]*rows[t][k] - box[k]*invArea)
+		\return the sum of the row in stats[0] and the sum of the squares in stats[1]
+	*/
+	inline void bandPassRow_impl(const float *const *rows, const float *taps, const size_t nbTaps, const float *box, const float invArea, float *out, const size_t n, double *stats)
+	{
+		const size_t half = nbTaps/2;
+		const float c = taps[half];
+		const float *m = rows[half];
+		for(size_t k=0; k<n; ++k)
+			out[k] = c * m[k] - box[k] * invArea;
+		for(size_t t=0; t<half; ++t)
+		{
+			const float w = taps[t];
+			const float *u = rows[t], *d = rows[nbTaps-1-t];
+			for(size_t k=0; k<n; ++k)
+				out[k] += w * (u[k] + d[k]);
+		}
+		float s = 0.0f, s2 = 0.0f;
+		for(size_t k=0; k<n; ++k)
+		{
+			out[k] = max(out[k], 0.0f);
+			s += out[k];
+			s2 += out[k] * out[k];
+		}
+		stats[0] = s;
+		stats[1] = s2;
+	}
+
+	/**
+		\brief flags[k] is set if mid[k] is at least thr and larger than its 8 neighbours.
+		Ties are broken in favour of the last pixel in raster order, so that a plateau gives a single maximum.
+	*/
+	inline void maximaRow_impl(const float *up, const float *mid, const float *down, const float thr, unsigned char *flags, const size_t n)
+	{
+		for(size_t k=1; k+1<n; ++k)
+		{
+			const float c = mid[k];
+			flags[k] = (c >= thr)
+				& (c > up[k-1]) & (c > up[k]) & (c > up[k+1]) & (c > mid[k-1])
+				& (c >= mid[k+1]) & (c >= down[k-1]) & (c >= down[k]) & (c >= down[k+1]);
+		}
+	}
+
+	COLLOIDS_DISPATCH_VARIANTS(void, convolveRow, convolveRow_impl,
+		(const float *line, const float *taps, const size_t nbTaps, float *out, const size_t n), (line, taps, nbTaps, out, n))
+	COLLOIDS_DISPATCH_VARIANTS(void, bandPassRow, bandPassRow_impl,
+		(const float *const *rows, const float *taps, const size_t nbTaps, const float *box, const float invArea, float *out, const size_t n, double *stats),
+		(rows, taps, nbTaps, box, invArea, out, n, stats))
+	COLLOIDS_DISPATCH_VARIANTS(void, maximaRow, maximaRow_impl,
+		(const float *up, const float *mid, const float *down, const float thr, unsigned char *flags, const size_t n), (up, mid, down, thr, flags, n))
+
+	typedef void (*ConvolveRow)(const float*, const float*, const size_t, float*, const size_t);
+	typedef void (*BandPassRow)(const float *const*, const float*, const size_t, const float*, const float, float*, const size_t, double*);
+	typedef void (*MaximaRow)(const float*, const float*, const float*, const float, unsigned char*, const size_t);
+
+	void convolveRow(const float *line, const float *taps, const size_t nbTaps, float *out, const size_t n)
+	{
+		static const ConvolveRow f = dispatch<ConvolveRow>(convolveRow_generic, convolveRow_sse42, convolveRow_avx2, convolveRow_avx512);
+		f(line, taps, nbTaps, out, n);
+	}
+	void bandPassRow(const float *const *rows, const float *taps, const size_t nbTaps, const float *box, const float invArea, float *out, const size_t n, double *stats)
+	{
+		static const BandPassRow f = dispatch<BandPassRow>(bandPassRow_generic, bandPassRow_sse42, bandPassRow_avx2, bandPassRow_avx512);
+		f(rows, taps, nbTaps, box, invArea, out, n, stats);
+	}
+	void maximaRow(const float *up, const float *mid, const float *down, const float thr, unsigned char *flags, const size_t n)
+	{
+		static const MaximaRow f = dispatch<MaximaRow>(maximaRow_generic, maximaRow_sse42, maximaRow_avx2, maximaRow_avx512);
+		f(up, mid, down, thr, flags, n);
+	}
+
+	inline size_t clampIndex(const ptrdiff_t i, const size_t n)
+	{
+		return i<0 ? 0 : ((size_t)i>=n ? n-1 : i);
+	}
+}
+
+/** \brief buffers of a thread tracking frames, allocated once */
+struct LiveTracker2D::Worker : boost::noncopyable
+{
+	/** \brief filtered frame, rows separated by stride. Padded for the in place real to complex FFT */
+	float *data;
+	size_t stride;
+	/** \brief horizontal passes of the real space filter, and a bordered line of the frame */
+	vector<float> gauss, box, columns, line;
+	vector<const float*> rows;
+	vector<unsigned char> flags;
+	vector<LiveCenter> centers;
+	double mean, deviation;
+
+	Worker(const size_t &height, const size_t &width, const Filter filter) : data(0), mean(0.0), deviation(0.0)
+	{
+		stride = (filter==fourier) ? 2*(width/2+1) : width;
+		data = (float*)fftwf_malloc(sizeof(float) * height * stride);
+		if(!data)
+			throw bad_alloc();
+		fill(data, data + height*stride, 0.0f);
+		flags.assign(width, 0);
+		//two local maxima cannot be neighbours
+		centers.reserve(((width+1)/2) * ((height+1)/2));
+	}
+	~Worker()
+	{
+		fftwf_free(data);
+	}
+};
+
+/** @brief Constructor. Allocates the buffers of each worker and plans the FFTs if needed */
+LiveTracker2D::LiveTracker2D(const size_t &height, const size_t &width, const Parameters &param, const size_t &nbWorkers) :
+	height(height), width(width), param(param), gaussHalf(0), boxHalf(0), forward_plan(0), backward_plan(0)
+{
+	if(height<3 || width<3)
+		throw invalid_argument("LiveTracker2D: the frames must be at least 3x3 pixels");
+	if(!(param.radiusMin > 0.0 && param.radiusMin < param.radiusMax))
+		throw invalid_argument("LiveTracker2D: we must have 0 < radiusMin < radiusMax");
+	for(size_t w=0; w<max((size_t)1, nbWorkers); ++w)
+		workers.push_back(new Worker(height, width, param.filter));
+	ring.resize(2 * workers.size() * width * height);
+
+	if(param.filter == real_space)
+	{
+		//gaussian of standard deviation radiusMin/2, cut at 3 standard deviations
+		const double sigma = param.radiusMin / 2.0;
+		gaussHalf = max((size_t)1, (size_t)ceil(3.0*sigma));
+		boxHalf = max((size_t)1, (size_t)floor(param.radiusMax/2.0 + 0.5));
+		taps.resize(2*gaussHalf+1);
+		double sum = 0.0;
+		for(size_t t=0; t<taps.size(); ++t)
+			sum += taps[t] = exp(-pow((double)t - (double)gaussHalf, 2) / (2.0*sigma*sigma));
+		for(size_t t=0; t<taps.size(); ++t)
+			taps[t] /= sum;
+		const size_t pad = max(gaussHalf, boxHalf);
+		for(size_t w=0; w<workers.size(); ++w)
+		{
+			workers[w].gauss.resize(height*width);
+			workers[w].box.resize(height*width);
+			workers[w].columns.resize(width);
+			workers[w].line.resize(width + 2*pad + 1);
+			workers[w].rows.resize(taps.size());
+		}
+	}
+	else
+	{
+		//annulus between the frequencies of radiusMax and radiusMin, on the half spectrum
+		const size_t nk = width/2 + 1;
+		const double fyMax = height/param.radiusMin/2.0, fxMax = width/param.radiusMin/2.0,
+			fyMin = height/param.radiusMax/2.0, fxMin = width/param.radiusMax/2.0;
+		spans.resize(height);
+		for(size_t j=0; j<height; ++j)
+		{
+			const double fy = min(j, height-j), outer = pow(fy/fyMax, 2), inner = pow(fy/fyMin, 2);
+			const size_t last = (outer >= 1.0) ? 0 : min(nk, (size_t)ceil(fxMax*sqrt(1.0 - outer)));
+			const size_t first = (inner >= 1.0) ? 0 : min(last, (size_t)ceil(fxMin*sqrt(1.0 - inner)));
+			spans[j] = make_pair(first, last);
+		}
+		//the plans are made on the buffer of the first worker and executed on the buffers of all workers
+		int n[2] = {(int)height, (int)width};
+		float *d = workers[0].data;
+		forward_plan = fftwf_plan_dft_r2c(2, n, d, (fftwf_complex *)d, param.fftwFlags);
+		backward_plan = fftwf_plan_dft_c2r(2, n, (fftwf_complex *)d, d, param.fftwFlags);
+		if(!forward_plan || !backward_plan)
+			throw runtime_error("LiveTracker2D: FFTW planning failed");
+	}
+}
+
+/** @brief Destructor  */
+LiveTracker2D::~LiveTracker2D()
+{
+	if(forward_plan)
+		fftwf_destroy_plan(forward_plan);
+	if(backward_plan)
+		fftwf_destroy_plan(backward_plan);
+}
+
+/** @brief Track a single frame with the buffers of the first worker */
+const std::vector<LiveCenter>& LiveTracker2D::track(const unsigned char *frame)
+{
+	run(workers[0], frame);
+	return workers[0].centers;
+}
+
+/**
+	@brief Track the frames of a source until it ends or maxFrames are tracked.
+
+	The ring holds two batches of one frame per worker. While the workers track the frames of a batch,
+	the calling thread grabs the next batch. The centers are then given to the consumer in the order of the frames.
+	\return the number of frames tracked
+*/
+size_t LiveTracker2D::stream(FrameSource &source, LiveConsumer &consumer, const size_t &maxFrames)
+{
+	if(source.getWidth() != width || source.getHeight() != height)
+		throw invalid_argument("LiveTracker2D: the source does not have the size of the tracker");
+	const size_t nbWorkers = workers.size(), frameSize = width*height;
+	unsigned char *batches[2] = {&ring[0], &ring[nbWorkers*frameSize]};
+	size_t nbGrabbed[2] = {0, 0}, grabbed = 0, delivered = 0;
+
+	while(nbGrabbed[0] < nbWorkers && grabbed < maxFrames && source.grab(batches[0] + nbGrabbed[0]*frameSize))
+	{
+		nbGrabbed[0]++;
+		grabbed++;
+	}
+	for(size_t current=0; nbGrabbed[current]; current = 1-current)
+	{
+		const size_t next = 1-current;
+		nbGrabbed[next] = 0;
+		string error;
+		//task 0 grabs the next batch, task w+1 tracks the frame w of the current batch
+		#pragma omp parallel for schedule(static,1) num_threads(nbWorkers+1)
+		for(int task=0; task<=(int)nbWorkers; ++task)
+		{
+			try
+			{
+				if(task == 0)
+				{
+					Instrument::Timer timer("live.grab");
+					while(nbGrabbed[next] < nbWorkers && grabbed < maxFrames && source.grab(batches[next] + nbGrabbed[next]*frameSize))
+					{
+						nbGrabbed[next]++;
+						grabbed++;
+					}
+				}
+				else if((size_t)task <= nbGrabbed[current])
+					run(workers[task-1], batches[current] + (task-1)*frameSize);
+			}
+			catch(const exception &e)
+			{
+				#pragma omp critical
+				error = e.what();
+			}
+		}
+		if(!error.empty())
+			throw runtime_error(error);
+		for(size_t w=0; w<nbGrabbed[current]; ++w)
+			consumer(delivered++, workers[w].centers);
+		Instrument::count("live.frames", nbGrabbed[current]);
+	}
+	return delivered;
+}
+
+/** @brief filter a frame, then find and refine the centers */
+void LiveTracker2D::run(Worker &w, const unsigned char *frame) const
+{
+	{
+		Instrument::Timer timer("live.filter");
+		if(param.filter == fourier)
+			filterFourier(w, frame);
+		else
+			filterRealSpace(w, frame);
+	}
+	Instrument::Timer timer("live.detect");
+	detect(w);
+}
+
+/** @brief separable real space band pass. The borders of the frame are extended by replication */
+void LiveTracker2D::filterRealSpace(Worker &w, const unsigned char *frame) const
+{
+	const size_t pad = max(gaussHalf, boxHalf);
+	float *line = &w.line[0];
+	//horizontal passes
+	for(size_t j=0; j<height; ++j)
+	{
+		const unsigned char *in = frame + j*width;
+		for(size_t k=0; k<width; ++k)
+			line[pad+k] = in[k];
+		fill(line, line+pad, line[pad]);
+		fill(line+pad+width, line+2*pad+width+1, line[pad+width-1]);
+		convolveRow(line + pad - gaussHalf, &taps[0], taps.size(), &w.gauss[j*width], width);
+		//running sum over the square side. The intensities are integers, so the sums are exact.
+		float *b = &w.box[j*width];
+		float s = 0.0f;
+		for(size_t k=pad-boxHalf; k<=pad+boxHalf; ++k)
+			s += line[k];
+		for(size_t k=0; k<width; ++k)
+		{
+			b[k] = s;
+			s += line[pad+k+boxHalf+1] - line[pad+k-boxHalf];
+		}
+	}
+	//vertical passes
+	fill(w.columns.begin(), w.columns.end(), 0.0f);
+	for(ptrdiff_t i=-(ptrdiff_t)boxHalf; i<=(ptrdiff_t)boxHalf; ++i)
+	{
+		const float *b = &w.box[clampIndex(i, height)*width];
+		for(size_t k=0; k<width; ++k)
+			w.columns[k] += b[k];
+	}
+	const float invArea = 1.0f / ((2*boxHalf+1) * (2*boxHalf+1));
+	double sum = 0.0, sum2 = 0.0;
+	for(size_t j=0; j<height; ++j)
+	{
+		for(size_t t=0; t<taps.size(); ++t)
+			w.rows[t] = &w.gauss[clampIndex((ptrdiff_t)j + t - gaussHalf, height)*width];
+		double stats[2];
+		bandPassRow(&w.rows[0], &taps[0], taps.size(), &w.columns[0], invArea, w.data + j*w.stride, width, stats);
+		sum += stats[0];
+		sum2 += stats[1];
+		const float *enter = &w.box[clampIndex((ptrdiff_t)j + boxHalf + 1, height)*width],
+			*leave = &w.box[clampIndex((ptrdiff_t)j - boxHalf, height)*width];
+		for(size_t k=0; k<width; ++k)
+			w.columns[k] += enter[k] - leave[k];
+	}
+	w.mean = sum / (width*height);
+	w.deviation = sqrt(max(0.0, sum2 / (width*height) - w.mean*w.mean));
+}
+
+/** @brief band pass by masking the half spectrum. The normalization of the FFT is included in the mask */
+void LiveTracker2D::filterFourier(Worker &w, const unsigned char *frame) const
+{
+	for(size_t j=0; j<height; ++j)
+	{
+		float *d = w.data + j*w.stride;
+		const unsigned char *in = frame + j*width;
+		for(size_t k=0; k<width; ++k)
+			d[k] = in[k];
+	}
+	fftwf_execute_dft_r2c(forward_plan, w.data, (fftwf_complex *)w.data);
+	const float scale = 1.0f / (width*height);
+	const size_t nk = width/2 + 1;
+	for(size_t j=0; j<height; ++j)
+	{
+		//complex numbers are pairs of floats
+		float *c = w.data + j*w.stride;
+		fill(c, c + 2*spans[j].first, 0.0f);
+		for(size_t k=2*spans[j].first; k<2*spans[j].second; ++k)
+			c[k] *= scale;
+		fill(c + 2*spans[j].second, c + 2*nk, 0.0f);
+	}
+	fftwf_execute_dft_c2r(backward_plan, (fftwf_complex *)w.data, w.data);
+	double sum = 0.0, sum2 = 0.0;
+	for(size_t j=0; j<height; ++j)
+	{
+		const float *d = w.data + j*w.stride;
+		float s = 0.0f, s2 = 0.0f;
+		for(size_t k=0; k<width; ++k)
+		{
+			s += d[k];
+			s2 += d[k] * d[k];
+		}
+		sum += s;
+		sum2 += s2;
+	}
+	w.mean = sum / (width*height);
+	w.deviation = sqrt(max(0.0, sum2 / (width*height) - w.mean*w.mean));
+}
+
+/**
+	@brief Local maxima of the filtered frame above the threshold, refined by the centroid of the positive intensities around them.
+	The maxima closer to the sides than the half width of the centroid, or not the brightest pixel of the centroid window, are ignored.
+*/
+void LiveTracker2D::detect(Worker &w) const
+{
+	w.centers.clear();
+	const float thr = w.mean + param.threshold * w.deviation;
+	const size_t m = max((size_t)1, (size_t)floor(2.0*param.radiusMin + 0.5));
+	if(2*m+1 > width || 2*m+1 > height)
+		return;
+	for(size_t j=m; j+m<height; ++j)
+	{
+		const float *mid = w.data + j*w.stride;
+		maximaRow(mid - w.stride, mid, mid + w.stride, thr, &w.flags[0], width);
+		for(size_t k=m; k+m<width; ++k)
+		{
+			if(!w.flags[k])
+				continue;
+			const float peak = mid[k];
+			float s = 0.0f, sx = 0.0f, sy = 0.0f, brightest = peak;
+			for(ptrdiff_t y=-(ptrdiff_t)m; y<=(ptrdiff_t)m; ++y)
+			{
+				const float *r = mid + y*(ptrdiff_t)w.stride + k;
+				for(ptrdiff_t x=-(ptrdiff_t)m; x<=(ptrdiff_t)m; ++x)
+				{
+					const float v = max(r[x], 0.0f);
+					brightest = max(brightest, r[x]);
+					s += v;
+					sx += x*v;
+					sy += y*v;
+				}
+			}
+			//as in the dilation of Crocker & Grier, a center is the brightest pixel of its window
+			if(brightest > peak || s <= 0.0f)
+				continue;
+			LiveCenter c;
+			c.x = k + sx/s;
+			c.y = j + sy/s;
+			c.intensity = s;
+			w.centers.push_back(c);
+		}
+	}
+	Instrument::gauge("live.centers", w.centers.size());
+}
+
+/** @brief Constructor. The files are headerSize bytes followed by height rows of width 8 bits pixels */
+FileSerieSource::FileSerieSource(const FileSerie &serie, const size_t &width, const size_t &height, const size_t &headerSize) :
+	serie(serie), width(width), height(height), headerSize(headerSize), t(0)
+{
+}
+
+/** @brief read the next file of the serie */
+bool FileSerieSource::grab(unsigned char *buffer)
+{
+	if(t >= serie.size())
+		return false;
+	const string filename = serie%(t++);
+	ifstream f(filename.c_str(), ios::in | ios::binary);
+	if(!f)
+		throw invalid_argument("no such file as "+filename);
+	f.seekg(headerSize);
+	if(!f.read(reinterpret_cast<char*>(buffer), width*height))
+		throw invalid_argument(filename+" is smaller than a frame");
+	return true;
+}
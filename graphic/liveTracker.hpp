@@ -0,0 +1,158 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+
+ * \file liveTracker.hpp
+ * \brief Streaming tracker of 2D frames for live acquisition
+ * \author Mathieu Leocmach
+ * \date 18 October 2026
+ *
+ * Tracker handles 2D images as 3D arrays with a singleton dimension, and allocates its results for each frame.
+ * LiveTracker2D is dedicated to a stream of 2D frames of fixed size: all the buffers and FFTW plans are made
+ * by the constructor, and tracking a frame allocates nothing.
+ *
+ * The band pass is either
+ *  - real space (default), after Crocker & Grier: a gaussian blur of standard deviation radiusMin/2
+ *    minus the average over a square of half width radiusMax/2, both separable;
+ *  - Fourier space, as Tracker: the annulus of the spectrum between the frequencies of radiusMax and radiusMin is kept.
+ * The centers are the local maxima of the filtered frame (over the 8 neighbours) brighter than a threshold
+ * and than the rest of the square of half width 2*radiusMin around them, refined by the intensity centroid of this square.
+ *
+ * LiveTracker2D::stream grabs the frames from a FrameSource into a ring buffer while a pool of OpenMP workers
+ * tracks the previously grabbed frames, and gives the centers to a LiveConsumer in the order of the frames.
+ */
+
+#ifndef live_tracker_H
+#define live_tracker_H
+
+extern "C" {
+#include "fftw3.h"
+}
+#include "files_series.hpp"
+
+#include <vector>
+#include <string>
+#include <boost/utility.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+namespace Colloids
+{
+    /** \brief A particle tracked in a 2D frame. Coordinates in pixels, x along the rows */
+    struct LiveCenter
+    {
+        float x, y;
+        /** \brief sum of the filtered intensity around the center */
+        float intensity;
+    };
+
+    /** \brief Source of 8 bits 2D frames, typically a camera
+        \ingroup graphic
+    */
+    class FrameSource
+    {
+        public:
+            virtual ~FrameSource(){};
+            virtual size_t getWidth() const = 0;
+            virtual size_t getHeight() const = 0;
+            /** \brief copy the next frame (getHeight() rows of getWidth() pixels) into buffer. \return false at the end of the stream */
+            virtual bool grab(unsigned char *buffer) = 0;
+    };
+
+    /** \brief Stand-in for a camera reading a series of raw 8 bits files
+        \ingroup graphic
+    */
+    class FileSerieSource : public FrameSource
+    {
+        public:
+            FileSerieSource(const FileSerie &serie, const size_t &width, const size_t &height, const size_t &headerSize=0);
+            size_t getWidth() const {return width;};
+            size_t getHeight() const {return height;};
+            bool grab(unsigned char *buffer);
+            /** \brief time step of the next frame */
+            size_t getTimeStep() const {return t;};
+
+        private:
+            FileSerie serie;
+            size_t width, height, headerSize, t;
+    };
+
+    /** \brief Receives the centers of each frame, on the thread that called LiveTracker2D::stream */
+    class LiveConsumer
+    {
+        public:
+            virtual ~LiveConsumer(){};
+            /** \brief the centers are only valid during the call */
+            virtual void operator()(const size_t &frame, const std::vector<LiveCenter> &centers) = 0;
+    };
+
+    /** \brief Allocation free tracker of a stream of 2D frames
+        \ingroup graphic
+    */
+    class LiveTracker2D : boost::noncopyable
+    {
+        public:
+            enum Filter {real_space=0, fourier=1};
+            struct Parameters
+            {
+                /** \brief real space radii of the band pass, in pixels */
+                double radiusMin, radiusMax;
+                /** \brief minimum filtered intensity of a center, in standard deviations above the mean of the filtered frame */
+                float threshold;
+                Filter filter;
+                /** \brief planning flags of the Fourier filter */
+                unsigned fftwFlags;
+
+                Parameters(const double &radius=5.0) :
+                    radiusMin(radius/2.0), radiusMax(4.0*radius), threshold(1.0f), filter(real_space), fftwFlags(FFTW_MEASURE) {};
+            };
+
+            LiveTracker2D(const size_t &height, const size_t &width, const Parameters &param=Parameters(), const size_t &nbWorkers=1);
+            ~LiveTracker2D();
+
+            size_t getWidth() const {return width;};
+            size_t getHeight() const {return height;};
+            size_t getNbWorkers() const {return workers.size();};
+            const Parameters& getParameters() const {return param;};
+
+            /** \brief track a single frame on the calling thread. The result is valid until the next call */
+            const std::vector<LiveCenter>& track(const unsigned char *frame);
+            size_t stream(FrameSource &source, LiveConsumer &consumer, const size_t &maxFrames=(size_t)-1);
+
+        private:
+            /** \brief buffers of a thread tracking frames */
+            struct Worker;
+
+            size_t height, width;
+            Parameters param;
+            /** \brief gaussian taps and half widths of the real space filter */
+            std::vector<float> taps;
+            size_t gaussHalf, boxHalf;
+            /** \brief kept columns [first, last) of each row of the half spectrum */
+            std::vector< std::pair<size_t, size_t> > spans;
+            fftwf_plan forward_plan, backward_plan;
+            boost::ptr_vector<Worker> workers;
+            /** \brief frames grabbed and being tracked, two per worker */
+            std::vector<unsigned char> ring;
+
+            void run(Worker &w, const unsigned char *frame) const;
+            void filterRealSpace(Worker &w, const unsigned char *frame) const;
+            void filterFourier(Worker &w, const unsigned char *frame) const;
+            void detect(Worker &w) const;
+    };
+}
+
+#endif
@@ -0,0 +1,129 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "liveTracker.hpp"
+#include "instrument.hpp"
+#include <boost/program_options.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <fstream>
+
+namespace po = boost::program_options;
+using namespace std;
+using namespace Colloids;
+using namespace boost::posix_time;
+
+/** \brief write the centers of each frame to a .dat file of a serie, and their number to a .nb file */
+struct LiveExporter : public LiveConsumer
+{
+    FileSerie outputFileName;
+    ofstream nbs;
+    const size_t width, height;
+
+    LiveExporter(const string &outputPath, const size_t &size, const size_t &width, const size_t &height) :
+        outputFileName(FileSerie::get0th(outputPath, size)+".dat", "_t", size, 0),
+        nbs((outputPath+".nb").c_str(), ios::out | ios::trunc), width(width), height(height) {};
+
+    void operator()(const size_t &frame, const vector<LiveCenter> &centers)
+    {
+        Instrument::Timer timer("live.output");
+        ofstream output((outputFileName % frame).c_str(), ios::out | ios::trunc);
+        if(!output)
+            throw invalid_argument("Cannot write on "+(outputFileName % frame));
+        //same format as Particles::exportToFile
+        output << "1\t" << centers.size() << "\t1" << "\n";
+        output << width << "\t" << height << "\t" << 1 << "\n";
+        for(vector<LiveCenter>::const_iterator c=centers.begin(); c!=centers.end(); ++c)
+            output << c->x << "\t" << c->y << "\t" << 0 << "\t\n";
+        nbs << centers.size() << endl;
+    }
+};
+
+int main(int ac, char* av[])
+{
+    Instrument::setToolName("liveTracker");
+    try
+    {
+        string input, token, outputPath;
+        size_t span, offset, width, height, headerSize, nbWorkers;
+        double radius;
+        LiveTracker2D::Parameters param;
+        po::options_description
+            compulsory_options("Compulsory options"),
+            additional_options("Additional options"),
+            cmdline_options("Command-line options");
+        compulsory_options.add_options()
+            ("input", po::value<string>(&input), "first file of a serie of raw 8 bits frames, for example frames_t000.raw")
+            ("width", po::value<size_t>(&width), "width of the frames in pixels")
+            ("height", po::value<size_t>(&height), "height of the frames in pixels")
+            ("span", po::value<size_t>(&span), "number of frames")
+            ;
+        po::positional_options_description pd;
+        pd.add("input", 1);
+        additional_options.add_options()
+            ("help", "produce help message")
+            ("output", po::value<string>(&outputPath), "output path and prefix (default: the input pattern without time step)")
+            ("token", po::value<string>(&token)->default_value("_t"), "token delimiting the time step number")
+            ("offset", po::value<size_t>(&offset)->default_value(0), "first time step")
+            ("header", po::value<size_t>(&headerSize)->default_value(0), "number of bytes before the pixels in each file")
+            ("radius", po::value<double>(&radius)->default_value(5.0), "radius of the particles in pixels. Sets radiusMin=radius/2 and radiusMax=4*radius")
+            ("radiusMin", po::value<double>(), "smallest real space radius kept by the band pass")
+            ("radiusMax", po::value<double>(), "largest real space radius kept by the band pass")
+            ("threshold", po::value<float>(&param.threshold)->default_value(1.0f), "minimum filtered intensity of a center, in standard deviations above the mean")
+            ("fourier", "band pass in Fourier space (as tracker) instead of real space")
+            ("workers", po::value<size_t>(&nbWorkers)->default_value(1), "number of threads tracking frames concurrently, in addition to the acquisition thread")
+            ;
+        cmdline_options.add(compulsory_options).add(additional_options);
+
+        po::variables_map vm;
+        po::store(po::command_line_parser(ac, av).options(cmdline_options).positional(pd).run(), vm);
+        if(vm.count("help") || !vm.count("input") || !vm.count("width") || !vm.count("height") || !vm.count("span"))
+        {
+            cout << "liveTracker input --width w --height h --span n [options]\n";
+            cout << "Track a stream of 2D frames with preallocated buffers, as for a live acquisition.\n";
+            cout << "The raw files of the serie stand in for a camera. The centers are exported to .dat files, their numbers to .nb\n";
+            cout << cmdline_options << "\n";
+            return EXIT_SUCCESS;
+        }
+        po::notify(vm);
+
+        const LiveTracker2D::Parameters defaults(radius);
+        param.radiusMin = vm.count("radiusMin") ? vm["radiusMin"].as<double>() : defaults.radiusMin;
+        param.radiusMax = vm.count("radiusMax") ? vm["radiusMax"].as<double>() : defaults.radiusMax;
+        if(vm.count("fourier"))
+            param.filter = LiveTracker2D::fourier;
+
+        FileSerie serie(input, token, span, offset);
+        if(outputPath.empty())
+            outputPath = serie.head();
+        FileSerieSource source(serie, width, height, headerSize);
+        LiveTracker2D tracker(height, width, param, nbWorkers);
+        LiveExporter exporter(outputPath, span, width, height);
+
+        const ptime start = microsec_clock::universal_time();
+        const size_t nbFrames = tracker.stream(source, exporter);
+        const double seconds = (microsec_clock::universal_time() - start).total_microseconds() * 1e-6;
+        cout << nbFrames << " frames in " << seconds << "s (" << (seconds>0 ? nbFrames/seconds : 0.0) << " fps)" << endl;
+    }
+    catch(const exception &e)
+    {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
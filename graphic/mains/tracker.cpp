@@ -50,6 +50,7 @@
 #include "radiiTracker.hpp"
 #include <boost/progress.hpp>
 #include <boost/format.hpp>
+#include "instrument.hpp"
 
 namespace po = boost::program_options;
 using namespace std;
@@ -137,6 +138,7 @@ struct ParticlesExporter : public unary_function<const Particles&, void>
     void operator()(const Particles& parts)
     {
         if(!show_progress) cout<<"export to "<<(*outputFileName % t)<<endl;
+        Instrument::Timer timer("tracker.output");
         parts.exportToFile(*outputFileName % (t++));
         (*nbs) << parts.size() << endl;
         if(show_progress)
@@ -183,6 +185,7 @@ struct RadiiExporter : public unary_function<const Particles&, void>
 
 int main(int ac, char* av[])
 {
+    Instrument::setToolName("tracker");
     try {
         string inputFile,outputPath;
         //double Zratio=1.0,displayRadius,radiusMin, radiusMax, zradiusMin, zradiusMax,threshold;
@@ -389,6 +392,7 @@ int main(int ac, char* av[])
                         FileSerie::get0th(outputPath, track.getLif().getNbTimeSteps())+".dat",
                         "_t", track.getLif().getNbTimeSteps(), 0
                     ) % onlyTimeStep;
+                    Instrument::Timer timer("tracker.output");
                     (*track).exportToFile(fileName);
                 }
 
@@ -33,6 +33,8 @@
 #include <boost/algorithm/minmax_element.hpp>
 #include "tracker.hpp"
 #include "particles.hpp"
+#include "instrument.hpp"
+#include "cpuDispatch.hpp"
 
 #ifndef TRACKER_N_THREADS
 #define TRACKER_N_THREADS 1
@@ -507,6 +509,7 @@ void Tracker::imageToFile(std::string &filename) const
 */
 void Tracker::FFTapplyMask()
 {
+    Instrument::Timer timer("tracker.filter");
     //boost::progress_timer ptimer;
     if(!quiet) cout << "FFT ... ";
     fftwf_execute(forward_plan);
@@ -540,6 +543,7 @@ template <class T> struct less_pointer : binary_function <T*,T*,bool> {
 */
 void Tracker::findPixelCenters(float threshold)
 {
+    Instrument::Timer timer("tracker.detect");
     //boost::progress_timer ptimer;
     const size_t margin = 6;
 	//We work only with unpadded, normalized images
@@ -630,6 +634,49 @@ struct compIntensities : public binary_function<const size_t&, const size_t&, fl
 	};
 };
 
+namespace {
+	/**
+		\brief Intensity centroid of a full 3x3x3 neighbourhood, relative to its central pixel.
+		\return false if the neighbourhood contains a negative pixel or if the central pixel is not a local maximum
+	*/
+	inline bool centroid27_impl(const float *ngb, double *c)
+	{
+		float mini = ngb[0], maxi = ngb[0];
+		for(int v=1; v<27; ++v)
+		{
+			mini = min(mini, ngb[v]);
+			maxi = max(maxi, ngb[v]);
+		}
+		if(mini < 0 || ngb[13] != maxi)
+			return false;
+		double c0 = 0.0, c1 = 0.0, c2 = 0.0, total_w = 0.0;
+		for(int v=0; v<27; ++v)
+		{
+			const int x = v/9 - 1, y = (v/3)%3 - 1, z = v%3 - 1;
+			const double weight = (double)(x*x) + (double)(y*y) + (double)(z*z) * (double)ngb[v];
+			c0 += x*weight;
+			c1 += y*weight;
+			c2 += z*weight;
+			total_w += weight;
+		}
+		const double norm = total_w/9.0;
+		c[0] = c0/norm;
+		c[1] = c1/norm;
+		c[2] = c2/norm;
+		return true;
+	}
+
+	COLLOIDS_DISPATCH_VARIANTS(bool, centroid27, centroid27_impl, (const float *ngb, double *c), (ngb, c))
+
+	typedef bool (*Centroid27)(const float *, double *);
+	bool centroid27(const float *ngb, double *c)
+	{
+		static const Centroid27 f = dispatch<Centroid27>(
+			centroid27_generic, centroid27_sse42, centroid27_avx2, centroid27_avx512);
+		return f(ngb, c);
+	}
+}
+
 /** \brief get the centroid of the neighbourhood of an image pixel given by it's offset */
 struct centroid : public std::unary_function<const size_t&, std::valarray<double> >
 {
@@ -678,6 +725,23 @@ valarray<double> centroid::operator()(const size_t& l) const
 		k = (l % image.strides()[0]) % image.strides()[1];
     //cout<<"l="<<l<<" -> i="<<i<<" j="<<j<<" k="<<k<<" ... ";
 
+	//most centers have a full neighbourhood: gather it without allocation and use the dispatched kernel
+	if(image.shape()[0]>=2*scope+1 && image.shape()[1]>=2*scope+1 && image.shape()[2]>=2*scope+1)
+	{
+		float px[27];
+		const float *o = image.origin() + l - image.strides()[0] - image.strides()[1] - 1;
+		for(int x=0; x<3; ++x)
+			for(int y=0; y<3; ++y)
+				copy(o + x*image.strides()[0] + y*image.strides()[1], o + x*image.strides()[0] + y*image.strides()[1] + 3, px + 9*x + 3*y);
+		valarray<double> c(3);
+		if(!centroid27(px, &c[0]))
+			return valarray<double>(-1.0, 3);
+		c[0] += i;
+		c[1] += j;
+		c[2] += k;
+		return c;
+	}
+
 	//the data of the neighbourhood view are copied together for the coder's sanity
 	boost::multi_array<float,3> ngb =
 		image[boost::indices
@@ -755,6 +819,7 @@ struct markedPositionRemover : public unary_function<Coordinates& ,bool>
   */
 Particles Tracker::getSubPixel(bool autoThreshold)
 {
+    Instrument::Timer timer("tracker.subpix");
     //boost::progress_timer ptimer;
 	//get the positions of the bright centers from flatten centersMap
 	if(!quiet) cout<<"get positions ... ";
@@ -795,7 +860,7 @@ Particles Tracker::getSubPixel(bool autoThreshold)
         while((*lowest)==0)
         {
             non_z = lowest;
-            lowest = min_element(lowest, peak);
+            lowest = min_element(lowest+1, peak);
             //cout<<"non_z="<<distance(hist.begin(),non_z)<<"\tlowest="<<distance(hist.begin(),lowest)<<endl;
         }
 
@@ -839,6 +904,7 @@ Particles Tracker::getSubPixel(bool autoThreshold)
 		//don't forget the bounding box
 		swap(centers.bb.edges[0].second, centers.bb.edges[2].second);
 	}
+    Instrument::gauge("tracker.centers", centers.size());
     if(!quiet) cout << "done!" << endl;
     if(view)
     {
@@ -37,6 +37,7 @@ extern "C" {
 //#include "lifFile.hpp"
 //#include "../files_series.hpp"
 #include "particles.hpp"
+#include "instrument.hpp"
 //#include <CImg.h>
 #include <boost/multi_array.hpp>
 namespace Colloids{
@@ -78,6 +79,7 @@ class Tracker
         void unsetRefBrightness(){hasRefBrightness=false;};*/
 
         Particles trackXYZ(const float &threshold=0.0f, bool autoThreshold=false);
+        Particles getSubPixel(bool autoThreshold=false);
         std::vector<float> getIntensities(const Particles &centers);
 
         //std::vector<Particles*> granulometry(const double &radiusMin, const double &radiusMax);
@@ -116,7 +118,7 @@ class Tracker
 
 		//void FFTapplyMask();
 		//void findPixelCenters(const float &threshold=0);
-		Particles getSubPixel(bool autoThreshold=false);
+		//Particles getSubPixel(bool autoThreshold=false);
 
 
 		//bool compIntensities(size_t i, size_t j);
@@ -185,6 +187,7 @@ class TrackerIterator : public std::iterator<std::input_iterator_tag, Particles>
 template <class InputIterator>
 InputIterator Tracker::fillImage(InputIterator first)
 {
+    Instrument::Timer timer("tracker.fill");
 	float *d = data;
 	long double sum;
 	for(size_t i=0; i<centersMap.shape()[0];++i)
@@ -218,6 +221,7 @@ InputIterator Tracker::fillImage(InputIterator first)
 template <class InputIterator>
 InputIterator Tracker::fillImage_charToUchar(InputIterator first)
 {
+    Instrument::Timer timer("tracker.fill");
     //using namespace boost::accumulators;
     //accumulator_set<long double, features<tag::min, tag::max, tag::mean> > acc;
 	float *d = data;
@@ -247,6 +251,7 @@ InputIterator Tracker::fillImage_charToUchar(InputIterator first)
 template <class InputIterator>
 InputIterator Tracker::fillSlice(const size_t slice, InputIterator first)
 {
+    Instrument::Timer timer("tracker.fill");
 	float *d = data + slice*FFTmask.strides()[0]*2;
     for(size_t j=0; j<centersMap.shape()[1];++j)
     {
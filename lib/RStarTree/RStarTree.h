@@ -319,6 +319,8 @@ public:
 
 
 	std::size_t GetSize() const { return m_size; }
+	// read only access to the structure of the tree, NULL if empty
+	const Node * GetRoot() const { return m_root; }
 	std::size_t GetDimensions() const { return dimensions; }
 
 	template <typename Visitor>
@@ -0,0 +1,179 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "ageing.hpp"
+#include "instrument.hpp"
+
+#include <boost/format.hpp>
+#include <boost/cstdint.hpp>
+#include <fstream>
+#include <stdexcept>
+#include <cmath>
+
+using namespace std;
+using namespace Colloids;
+
+/** @brief Constructor. Compute the dynamics of all the windows.
+  *
+  * \param parts The trajectories. The time steps of all the windows have to be in memory, and the drift removed if needed.
+  * \param windows The time windows
+  */
+AgeingDynamics::AgeingDynamics(const DynamicParticles &parts, const std::vector<AgeingWindow> &windows) :
+	windows(windows), dt(parts.dt)
+{
+	Instrument::Timer timer("ageing");
+	if(windows.empty())
+		throw invalid_argument("AgeingDynamics: no window");
+	size_t first = windows.front().start, last = 0;
+	for(size_t w=0; w<windows.size(); ++w)
+	{
+		if(windows[w].stop <= windows[w].start)
+			throw invalid_argument((boost::format("AgeingDynamics: empty window [%1%,%2%]") % windows[w].start % windows[w].stop).str());
+		first = min(first, windows[w].start);
+		last = max(last, windows[w].last());
+	}
+	if(first < parts.getLoadedFrames().first || last > parts.getLoadedFrames().second)
+		throw invalid_argument
+		(
+			(boost::format("[%1%,%2%] not included in the frames in memory [%3%,%4%]") % first % last % parts.getLoadedFrames().first % parts.getLoadedFrames().second).str()
+		);
+
+	//position of the sums of each window in the arrays of sums, and windows having a time origin at each time step
+	vector<size_t> base(windows.size()+1, 0);
+	vector< vector<size_t> > origins(last-first+1);
+	for(size_t w=0; w<windows.size(); ++w)
+	{
+		base[w+1] = base[w] + windows[w].stop - windows[w].start + 1;
+		const size_t nbOrigins = windows[w].av ? windows[w].av : windows[w].stop - windows[w].start;
+		for(size_t s=windows[w].start; s<windows[w].start+nbOrigins; ++s)
+			origins[s-first].push_back(w);
+	}
+	const double q = M_PI/parts.radius;
+	vector<double> sumSD(base.back(), 0.0), sumQD(base.back(), 0.0), sumISF(base.back(), 0.0), nb(base.back(), 0.0);
+	size_t nbDisplacements = 0;
+
+	#pragma omp parallel reduction(+:nbDisplacements)
+	{
+		vector<double> SD(base.back(), 0.0), QD(base.back(), 0.0), F(base.back(), 0.0), N(base.back(), 0.0);
+		vector<double> pos;
+		vector< pair<size_t, size_t> > active;
+		#pragma omp for schedule(dynamic, 64)
+		for(ptrdiff_t tr=0; tr<(ptrdiff_t)parts.trajectories.size(); ++tr)
+		{
+			const Traj &traj = parts.trajectories[tr];
+			const size_t from = max(first, traj.start_time), to = min(last, traj.last_time());
+			if(from >= to)
+				continue;
+			//positions of the trajectory in contiguous memory
+			pos.resize(3*(to-from+1));
+			for(size_t t=from; t<=to; ++t)
+			{
+				const Coord &c = parts(tr, t);
+				for(size_t d=0; d<3; ++d)
+					pos[3*(t-from)+d] = c[d];
+			}
+			for(size_t s=from; s<to; ++s)
+			{
+				//windows having s as a time origin, for which the trajectory is long enough, and their longest lag time
+				active.clear();
+				size_t maxLag = 0;
+				for(vector<size_t>::const_iterator w=origins[s-first].begin(); w!=origins[s-first].end(); ++w)
+				{
+					const AgeingWindow &win = windows[*w];
+					const size_t a = win.av ? s : win.start, b = win.av ? s + win.stop - win.start : win.stop;
+					if(traj.start_time <= a && b <= traj.last_time())
+					{
+						active.push_back(make_pair(*w, b - s));
+						maxLag = max(maxLag, b - s);
+					}
+				}
+				for(size_t lag=1; lag<=maxLag; ++lag)
+				{
+					const double *p0 = &pos[3*(s-from)], *p1 = p0 + 3*lag;
+					const double dx = p1[0]-p0[0], dy = p1[1]-p0[1], dz = p1[2]-p0[2];
+					const double sd = dx*dx + dy*dy + dz*dz,
+						f = (cos(q*dx) + cos(q*dy) + cos(q*dz))/3.0;
+					nbDisplacements++;
+					for(size_t i=0; i<active.size(); ++i)
+						if(lag <= active[i].second)
+						{
+							const size_t j = base[active[i].first] + lag;
+							SD[j] += sd;
+							QD[j] += sd*sd;
+							F[j] += f;
+							N[j] += 1.0;
+						}
+				}
+			}
+		}
+		#pragma omp critical(ageing_sums)
+		for(size_t j=0; j<base.back(); ++j)
+		{
+			sumSD[j] += SD[j];
+			sumQD[j] += QD[j];
+			sumISF[j] += F[j];
+			nb[j] += N[j];
+		}
+	}
+	Instrument::count("ageing.displacements", nbDisplacements);
+
+	//same normalisation as DynamicParticles::get_MSD_NGP
+	const double diameter2 = pow(2.0*parts.radius, 2.0);
+	MSD.resize(windows.size());
+	NGP.resize(windows.size());
+	ISF.resize(windows.size());
+	count.resize(windows.size());
+	for(size_t w=0; w<windows.size(); ++w)
+	{
+		const size_t n = base[w+1] - base[w];
+		MSD[w].assign(n, 0.0);
+		NGP[w].assign(n, 0.0);
+		ISF[w].assign(n, 1.0);
+		count[w].assign(nb.begin()+base[w], nb.begin()+base[w+1]);
+		for(size_t lag=1; lag<n; ++lag)
+		{
+			const size_t j = base[w] + lag;
+			NGP[w][lag] = nb[j] * sumQD[j] / (3.0 * sumSD[j] * sumSD[j]);
+			MSD[w][lag] = sumSD[j] / (nb[j] * diameter2);
+			ISF[w][lag] = sumISF[j] / nb[j];
+		}
+	}
+}
+
+/** @brief write all the windows to a binary file (layout in ageing.hpp) */
+void AgeingDynamics::exportBinary(const std::string &filename) const
+{
+	ofstream output(filename.c_str(), ios::out | ios::trunc | ios::binary);
+	if(!output.good())
+		throw invalid_argument(("Cannot write "+filename).c_str());
+	output.write("COLAGEIN", 8);
+	const boost::uint64_t nbWindows = windows.size();
+	output.write(reinterpret_cast<const char*>(&nbWindows), sizeof(boost::uint64_t));
+	output.write(reinterpret_cast<const char*>(&dt), sizeof(double));
+	for(size_t w=0; w<windows.size(); ++w)
+	{
+		const boost::uint64_t bounds[3] = {windows[w].start, windows[w].stop, windows[w].av};
+		output.write(reinterpret_cast<const char*>(bounds), sizeof(bounds));
+		for(size_t lag=0; lag<MSD[w].size(); ++lag)
+		{
+			const double row[5] = {lag*dt, MSD[w][lag], NGP[w][lag], ISF[w][lag], count[w][lag]};
+			output.write(reinterpret_cast<const char*>(row), sizeof(row));
+		}
+	}
+}
@@ -0,0 +1,78 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+
+ * \file ageing.hpp
+ * \brief Mean square displacement, non Gaussian parameter and self ISF of many time windows in a single pass
+ * \author Mathieu Leocmach
+ * \date 18 October 2026
+ *
+ * A window [start, stop] with av time origins averages the displacements over the lag times 0 to stop-start,
+ * starting from start, start+1, ..., start+av-1, for the trajectories spanning each [origin, origin+stop-start].
+ * With av=0, all the intervals included in [start, stop] are averaged, for the trajectories spanning [start, stop].
+ * These are the intervals of DynamicParticles::getMSD and getSelfISF.
+ *
+ * The windows of an ageing study overlap, so the displacement of a trajectory between two time steps is computed once
+ * and added to the sums of all the windows containing it. The trajectories are distributed between the threads.
+ *
+ * Binary file layout, in the byte order of the machine: the 8 characters "COLAGEIN", the number of windows (64 bits unsigned)
+ * and the time step (double); then for each window, start, stop and av (64 bits unsigned) followed by stop-start+1 rows
+ * of 5 doubles: lag time, MSD, NGP, self ISF and number of displacements averaged.
+ */
+
+#ifndef ageing_H
+#define ageing_H
+
+#include "dynamicParticles.hpp"
+
+namespace Colloids
+{
+    /** \brief Time window of an ageing study */
+    struct AgeingWindow
+    {
+        size_t start, stop, av;
+
+        AgeingWindow(const size_t &start=0, const size_t &stop=0, const size_t &av=0) : start(start), stop(stop), av(av) {};
+        /** \brief last time step used */
+        size_t last() const {return av ? stop+av-1 : stop;};
+    };
+
+    /** \brief Dynamics of many time windows */
+    class AgeingDynamics
+    {
+        public:
+            AgeingDynamics(const DynamicParticles &parts, const std::vector<AgeingWindow> &windows);
+
+            const std::vector<AgeingWindow>& getWindows() const {return windows;};
+            /** \brief functions of the lag time (0 to stop-start) of the window w. Same units and definitions as DynamicParticles::get_MSD_NGP */
+            const std::vector<double>& getMSD(const size_t &w) const {return MSD[w];};
+            const std::vector<double>& getNGP(const size_t &w) const {return NGP[w];};
+            /** \brief self ISF at the first peak of the structure factor, averaged over the three axis */
+            const std::vector<double>& getISF(const size_t &w) const {return ISF[w];};
+            /** \brief number of displacements averaged at each lag time */
+            const std::vector<double>& getCount(const size_t &w) const {return count[w];};
+
+            void exportBinary(const std::string &filename) const;
+
+        private:
+            const std::vector<AgeingWindow> windows;
+            const double dt;
+            std::vector< std::vector<double> > MSD, NGP, ISF, count;
+    };
+}
+
+#endif
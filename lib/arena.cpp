@@ -0,0 +1,134 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "arena.hpp"
+#include "instrument.hpp"
+#include <algorithm>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+using namespace Colloids;
+
+Arena::Arena(const size_t &firstChunk) : current(0), pos(0), used(0), peak(0), allocations(0), scopes(0)
+{
+    chunks.push_back(make_pair(new char[firstChunk], firstChunk));
+}
+
+Arena::~Arena()
+{
+    for(size_t c=0; c<chunks.size(); ++c)
+        delete[] chunks[c].first;
+}
+
+/** @brief Forget all allocations. If the memory was spread over several chunks, they are merged into a single one. */
+void Arena::reset()
+{
+    if(chunks.size()>1)
+    {
+        const size_t total = getCapacity();
+        for(size_t c=0; c<chunks.size(); ++c)
+            delete[] chunks[c].first;
+        chunks.assign(1, make_pair(new char[total], total));
+    }
+    current = 0;
+    pos = 0;
+    used = 0;
+}
+
+size_t Arena::getCapacity() const
+{
+    size_t total = 0;
+    for(size_t c=0; c<chunks.size(); ++c)
+        total += chunks[c].second;
+    return total;
+}
+
+/** @brief Move to the next chunk large enough, or get a new one from the heap, twice as large as the last one */
+void Arena::nextChunk(const size_t &minSize)
+{
+    size_t next = current + 1;
+    while(next < chunks.size() && chunks[next].second < minSize)
+        ++next;
+    if(next == chunks.size())
+    {
+        const size_t s = max(minSize, 2*chunks.back().second);
+        chunks.push_back(make_pair(new char[s], s));
+    }
+    current = next;
+    pos = 0;
+}
+
+namespace {
+    /** \brief maximum number of threads having their own arena. Other threads use the heap. */
+    const size_t nbArenas = 256;
+
+    /** \brief One arena per OpenMP thread, created on first use by the thread itself */
+    struct ArenaRegistry
+    {
+        vector<Arena*> arenas;
+        ArenaRegistry() : arenas(nbArenas, (Arena*)0) {};
+        ~ArenaRegistry()
+        {
+            for(size_t i=0; i<arenas.size(); ++i)
+                delete arenas[i];
+        }
+    };
+
+    ArenaRegistry& getRegistry()
+    {
+        static ArenaRegistry registry;
+        return registry;
+    }
+}
+
+Arena* Colloids::frameArena()
+{
+    ArenaRegistry &registry = getRegistry();
+#ifdef _OPENMP
+    if(omp_get_active_level() > 1)
+        return 0;
+    //the thread number in the active region: inside an inactive nested region, omp_get_thread_num() is 0 for all the threads
+    size_t id = 0;
+    for(int l=omp_get_level(); l>0; --l)
+        if(omp_get_team_size(l) > 1)
+        {
+            id = omp_get_ancestor_thread_num(l);
+            break;
+        }
+#else
+    const size_t id = 0;
+#endif
+    if(id >= nbArenas)
+        return 0;
+    Arena *&a = registry.arenas[id];
+    if(!a)
+    {
+        //the pointer of this arena is only ever written by this thread
+        a = new Arena();
+    }
+    return a;
+}
+
+void ArenaScope::report(const Arena &arena, const Arena::Mark &m)
+{
+    Instrument::count("arena.allocations", arena.getNbAllocations() - m.allocations);
+    Instrument::gauge("arena.peak_bytes", arena.getPeak());
+}
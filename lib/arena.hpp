@@ -0,0 +1,218 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+
+ * \file arena.hpp
+ * \brief Per-thread monotonic memory for the temporaries of per-frame analysis
+ * \author Mathieu Leocmach
+ * \date 18 October 2026
+ *
+ * Spatial queries, neighbour sorting and cluster growing allocate and free many small blocks.
+ * Containers using ArenaAllocator take their memory from the arena of the calling OpenMP thread
+ * by bumping a pointer, and never give it back individually. An ArenaScope rewinds the arena
+ * in O(1) when it goes out of scope, so the memory is reused by the next query or frame.
+ *
+ * Rules: a container drawing from an arena must be created and used by a single thread,
+ * and must be destroyed before the innermost ArenaScope that was open when it allocated.
+ * In nested parallel regions and beyond 256 threads, the allocator falls back to the heap.
+ *
+ * When the instrumentation is active, each outermost scope reports the counter "arena.allocations"
+ * and the gauge "arena.peak_bytes".
+ */
+
+#ifndef arena_H
+#define arena_H
+
+#include <vector>
+#include <list>
+#include <set>
+#include <map>
+#include <new>
+#include <limits>
+#include <cstddef>
+#include <boost/utility.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+
+namespace Colloids
+{
+    /** \brief Chunked monotonic buffer. Deallocation is a no-op, memory is reclaimed by rewinding. */
+    class Arena : boost::noncopyable
+    {
+        public:
+            /** \brief Position in the arena, to rewind to */
+            struct Mark
+            {
+                size_t chunk, offset, used, allocations;
+            };
+
+            explicit Arena(const size_t &firstChunk = 64*1024);
+            ~Arena();
+
+            /** \brief get bytes of memory aligned on align (a power of two) */
+            void* allocate(const size_t &bytes, const size_t &align)
+            {
+                size_t offset = (pos + align - 1) & ~(align - 1);
+                if(current >= chunks.size() || offset + bytes > chunks[current].second)
+                {
+                    nextChunk(bytes + align);
+                    offset = (pos + align - 1) & ~(align - 1);
+                }
+                used += offset + bytes - pos;
+                pos = offset + bytes;
+                if(used > peak)
+                    peak = used;
+                ++allocations;
+                return chunks[current].first + offset;
+            };
+
+            Mark mark() const
+            {
+                Mark m = {current, pos, used, allocations};
+                return m;
+            };
+            void rewind(const Mark &m)
+            {
+                current = m.chunk;
+                pos = m.offset;
+                used = m.used;
+            };
+            void reset();
+
+            /** \brief count an ArenaScope opening on this arena. Returns the number of scopes already open. */
+            size_t openScope() {return scopes++;};
+            void closeScope() {--scopes;};
+
+            /** \brief number of allocations since the creation of the arena */
+            size_t getNbAllocations() const {return allocations;};
+            /** \brief bytes presently in use */
+            size_t getUsed() const {return used;};
+            /** \brief maximum number of bytes ever in use */
+            size_t getPeak() const {return peak;};
+            /** \brief bytes reserved from the heap */
+            size_t getCapacity() const;
+
+        private:
+            std::vector< std::pair<char*, size_t> > chunks;
+            size_t current, pos, used, peak, allocations, scopes;
+
+            void nextChunk(const size_t &minSize);
+    };
+
+    /** \brief arena of the calling thread, or 0 if it has none (nested parallelism, too many threads) */
+    Arena* frameArena();
+
+    /**
+        \brief Rewind the arena of the calling thread to its state at construction
+
+        Scopes can be nested. Place one around a per-frame (or per-query) computation.
+    */
+    class ArenaScope : boost::noncopyable
+    {
+        public:
+            ArenaScope() : arena(frameArena())
+            {
+                if(arena)
+                {
+                    m = arena->mark();
+                    outermost = (arena->openScope() == 0);
+                }
+            };
+            ~ArenaScope()
+            {
+                if(!arena)
+                    return;
+                arena->closeScope();
+                if(outermost)
+                    report(*arena, m);
+                arena->rewind(m);
+            };
+
+        private:
+            Arena *arena;
+            Arena::Mark m;
+            bool outermost;
+            static void report(const Arena &arena, const Arena::Mark &m);
+    };
+
+    /**
+        \brief Standard allocator drawing from the arena of the thread that constructed it
+
+        A default constructed allocator binds to the arena of the calling thread.
+        Copies share the arena, so that a container and its copies draw from the same memory.
+    */
+    template<class T>
+    class ArenaAllocator
+    {
+        public:
+            typedef T value_type;
+            typedef T* pointer;
+            typedef const T* const_pointer;
+            typedef T& reference;
+            typedef const T& const_reference;
+            typedef size_t size_type;
+            typedef std::ptrdiff_t difference_type;
+            template<class U> struct rebind {typedef ArenaAllocator<U> other;};
+
+            ArenaAllocator() : arena(frameArena()) {};
+            explicit ArenaAllocator(Arena *a) : arena(a) {};
+            template<class U> ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.getArena()) {};
+
+            pointer address(reference x) const {return &x;};
+            const_pointer address(const_reference x) const {return &x;};
+            pointer allocate(size_type n, const void* =0)
+            {
+                if(arena)
+                    return static_cast<pointer>(arena->allocate(n*sizeof(T), alignment()));
+                return static_cast<pointer>(::operator new(n*sizeof(T)));
+            };
+            void deallocate(pointer p, size_type)
+            {
+                if(!arena)
+                    ::operator delete(p);
+            };
+            size_type max_size() const {return std::numeric_limits<size_type>::max()/sizeof(T);};
+            void construct(pointer p, const T& val) {new(static_cast<void*>(p)) T(val);};
+            void destroy(pointer p) {p->~T();};
+
+            Arena* getArena() const {return arena;};
+
+        private:
+            Arena *arena;
+            static size_t alignment() {return boost::alignment_of<T>::value;};
+    };
+
+    template<class T, class U>
+    inline bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {return a.getArena() == b.getArena();}
+    template<class T, class U>
+    inline bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {return a.getArena() != b.getArena();}
+
+    /** \brief Containers drawing from the arena of the calling thread */
+    template<class T>
+    struct Scratch
+    {
+        typedef std::vector<T, ArenaAllocator<T> > vector;
+        typedef std::list<T, ArenaAllocator<T> > list;
+        typedef std::set<T, std::less<T>, ArenaAllocator<T> > set;
+    };
+    template<class K, class V>
+    struct ScratchMap
+    {
+        typedef std::multimap<K, V, std::less<K>, ArenaAllocator<std::pair<const K, V> > > multimap;
+    };
+}
+
+#endif
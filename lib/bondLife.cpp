@@ -0,0 +1,132 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "bondLife.hpp"
+
+using namespace std;
+using namespace Colloids;
+
+/** @brief Constructor. The log stream, if any, has to be opened in binary mode. */
+BondLife::BondLife(const TrajIndex &trajectories, std::ostream *log) :
+    trajectories(trajectories), log(log), t(0), nbReformed(0)
+{
+    if(trajectories.nbFrames()==0)
+        throw invalid_argument("BondLife: make the inverse of the trajectory index first");
+}
+
+/** @brief Process the bonds of the next frame.
+  *
+  * \param bonds The bonds of the frame, in position indices
+  */
+void BondLife::push_back(const BondSet &bonds)
+{
+    if(t >= trajectories.nbFrames())
+        throw out_of_range("BondLife: more frames than in the trajectory index");
+    const vector<size_t> &inverse = trajectories.getInverse(t);
+    nbBirths.push_back(0);
+    nbDeaths.push_back(0);
+
+    //mark the bonds existing at t, and create the new ones
+    for(BondSet::const_iterator b=bonds.begin(); b!=bonds.end(); ++b)
+    {
+        const Bond tb(inverse.at(b->low()), inverse.at(b->high()));
+        OpenMap::iterator it = open.find(tb);
+        if(it != open.end())
+        {
+            it->second.last = t;
+            continue;
+        }
+        //the bond may have formed before we could see it
+        const bool unknownBirth = t==0 || !trajectories[tb.low()].exist(t-1) || !trajectories[tb.high()].exist(t-1);
+        open.insert(make_pair(tb, Life(t, unknownBirth)));
+        if(unknownBirth)
+        {
+            record(t, tb, leftCensored);
+            continue;
+        }
+        nbBirths.back()++;
+        record(t, tb, birth);
+        BrokenMap::iterator br = broken.find(tb);
+        if(br != broken.end())
+        {
+            nbReformed++;
+            broken.erase(br);
+        }
+    }
+
+    //close the bonds that were not seen at t
+    OpenMap::iterator it = open.begin();
+    while(it != open.end())
+    {
+        if(it->second.last == t)
+        {
+            ++it;
+            continue;
+        }
+        const bool isCensored = !trajectories[it->first.low()].exist(t) || !trajectories[it->first.high()].exist(t);
+        close(it->first, it->second, t, isCensored);
+        if(!isCensored)
+            nbDeaths.back()++;
+        it = open.erase(it);
+    }
+    t++;
+}
+
+/** @brief Censor all the bonds still open after the last frame */
+void BondLife::finish()
+{
+    for(OpenMap::const_iterator it=open.begin(); it!=open.end(); ++it)
+        close(it->first, it->second, t, true);
+    open.clear();
+    if(log)
+        log->flush();
+}
+
+/** @brief The broken bonds that did not reform (yet), with the time of their breaking, sorted by bond */
+vector< pair<Bond, size_t> > BondLife::getNeverReformed() const
+{
+    vector< pair<Bond, size_t> > nr(broken.begin(), broken.end());
+    sort(nr.begin(), nr.end());
+    return nr;
+}
+
+void BondLife::close(const Bond &b, const Life &life, const size_t &time, const bool isCensored)
+{
+    const size_t lifetime = time - life.birth;
+    vector<size_t> &hist = (isCensored || life.leftCensored) ? censoredLifetimes : lifetimes;
+    if(hist.size() <= lifetime)
+        hist.resize(lifetime+1, 0);
+    hist[lifetime]++;
+    if(!isCensored && !life.leftCensored)
+        broken[b] = time;
+    record(time, b, isCensored ? censored : death);
+}
+
+void BondLife::record(const size_t &time, const Bond &b, const EventType type)
+{
+    if(!log)
+        return;
+    const Event e = {
+        static_cast<boost::uint32_t>(time),
+        static_cast<boost::uint32_t>(b.low()),
+        static_cast<boost::uint32_t>(b.high()),
+        static_cast<boost::uint32_t>(type)
+    };
+    log->write(reinterpret_cast<const char*>(&e), sizeof(Event));
+}
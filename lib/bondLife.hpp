@@ -0,0 +1,116 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+
+ * \file bondLife.hpp
+ * \brief Defines classes to follow the history of the bonds along a trajectory
+ * \author Mathieu Leocmach
+ * \date 18 October 2026
+ *
+ */
+
+#ifndef bond_life_H
+#define bond_life_H
+
+#include "particles.hpp"
+#include "traj.hpp"
+
+#include <boost/unordered_map.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/cstdint.hpp>
+
+namespace Colloids
+{
+    /** \brief hash function for a bond, to be used in boost::unordered containers */
+    inline std::size_t hash_value(const Bond &b)
+    {
+        std::size_t seed = 0;
+        boost::hash_combine(seed, b.low());
+        boost::hash_combine(seed, b.high());
+        return seed;
+    }
+
+    /**
+        \brief Follow the bonds between trajectories frame after frame.
+
+        Each frame's BondSet (in position indices) is mapped to trajectory pairs.
+        The open bonds are kept in a hash map keyed by trajectory pair, so a frame is processed in O(number of bonds).
+        Births and deaths are streamed to an optional binary event log as they are detected.
+
+        A bond already formed when first seen (in the first frame, or when one of its trajectories starts)
+        has an unknown birth: it is left censored. It is neither a birth nor, once broken, a broken bond,
+        and its lifetime is only a lower bound, as for the bonds censored when a trajectory ends.
+    */
+    class BondLife
+    {
+        public:
+            /** \brief Kind of event in the log */
+            enum EventType {birth=0, death=1, censored=2, leftCensored=3};
+
+            /**
+                \brief A record of the binary event log: 4 little unsigned integers (time, low trajectory, high trajectory, type).
+                A bond is censored when one of its trajectories ends or when the last frame is reached.
+                It is left censored when first seen already formed.
+            */
+            struct Event
+            {
+                boost::uint32_t time, low, high, type;
+            };
+
+            explicit BondLife(const TrajIndex &trajectories, std::ostream *log=0);
+
+            void push_back(const BondSet &bonds);
+            void finish();
+
+            /** \brief number of frames already processed */
+            size_t size() const {return t;};
+            size_t nbOpen() const {return open.size();};
+            /** \brief number of bonds broken between t-1 and t whose both trajectories exist at t */
+            const std::vector<size_t>& getNbDeaths() const {return nbDeaths;};
+            const std::vector<size_t>& getNbBirths() const {return nbBirths;};
+            /** \brief histogram of the lifetimes (in frames) of the bonds born and broken while followed */
+            const std::vector<size_t>& getLifetimes() const {return lifetimes;};
+            /** \brief histogram of the lower bounds of the lifetimes (in frames) of the bonds censored at either end */
+            const std::vector<size_t>& getCensoredLifetimes() const {return censoredLifetimes;};
+            size_t getNbReformed() const {return nbReformed;};
+            std::vector< std::pair<Bond, size_t> > getNeverReformed() const;
+
+        private:
+            /** \brief birth (or first seen) time and last time seen of an open bond */
+            struct Life
+            {
+                size_t birth, last;
+                bool leftCensored;
+                Life(const size_t &birth, const bool leftCensored) : birth(birth), last(birth), leftCensored(leftCensored) {};
+            };
+            typedef boost::unordered_map<Bond, Life> OpenMap;
+            /** \brief time of the last breaking of a bond */
+            typedef boost::unordered_map<Bond, size_t> BrokenMap;
+
+            const TrajIndex &trajectories;
+            std::ostream *log;
+            size_t t, nbReformed;
+            OpenMap open;
+            BrokenMap broken;
+            std::vector<size_t> nbDeaths, nbBirths, lifetimes, censoredLifetimes;
+
+            void close(const Bond &b, const Life &life, const size_t &time, const bool isCensored);
+            void record(const size_t &time, const Bond &b, const EventType type);
+    };
+}
+
+#endif
@@ -0,0 +1,158 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "config.h"
+#include "bonds.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <boost/static_assert.hpp>
+
+using namespace std;
+using namespace Colloids;
+
+namespace {
+	const char bondsMagic[8] = {'C','O','L','B','O','N','D','S'};
+	const boost::uint32_t bondsVersion = 1;
+	//the pairs are written and read as they are in memory
+	BOOST_STATIC_ASSERT(sizeof(Bond) == 2*sizeof(boost::uint32_t));
+
+	/** \brief format selected at build time and by the COLLOIDS_BONDS environment variable */
+	BondsFormat selectBondsFormat()
+	{
+#ifdef COLLOIDS_BINARY_BONDS
+		const BondsFormat def = binary_bonds;
+#else
+		const BondsFormat def = text_bonds;
+#endif
+		const char* env = getenv("COLLOIDS_BONDS");
+		if(!env || !*env)
+			return def;
+		if(!strcmp(env, "binary"))
+			return binary_bonds;
+		if(!strcmp(env, "text"))
+			return text_bonds;
+		cerr<<"COLLOIDS_BONDS="<<env<<" is not one of binary, text. Using "<<(def==binary_bonds?"binary":"text")<<endl;
+		return def;
+	}
+}
+
+/** @brief sort the bonds after the first ones (already sorted), merge them with the first ones and remove the duplicates */
+void BondSet::normalize(const size_type &sorted)
+{
+	vector<Bond>::iterator middle = bonds.begin() + sorted;
+	bool ordered = true;
+	for(vector<Bond>::const_iterator b = middle; ordered && b+1 < bonds.end(); ++b)
+		ordered = *b < *(b+1);
+	if(!ordered)
+		sort(middle, bonds.end());
+	if(sorted && middle != bonds.end() && !(*(middle-1) < *middle))
+		inplace_merge(bonds.begin(), middle, bonds.end());
+	bonds.erase(unique(bonds.begin(), bonds.end()), bonds.end());
+}
+
+/** @brief remove a bond. Return the number of bonds removed (0 or 1) */
+BondSet::size_type BondSet::erase(const Bond &b)
+{
+	vector<Bond>::iterator it = lower_bound(bonds.begin(), bonds.end(), b);
+	if(it == bonds.end() || !(*it == b))
+		return 0;
+	bonds.erase(it);
+	return 1;
+}
+
+/** @brief on disk format used by saveBonds during the whole run */
+BondsFormat Colloids::getBondsFormat()
+{
+	static const BondsFormat f = selectBondsFormat();
+	return f;
+}
+
+/** @brief load bonds from a file in text or binary format */
+BondSet Colloids::loadBonds(const std::string &filename)
+{
+	ifstream f(filename.c_str(), ios::in | ios::binary);
+	if(!f)
+		throw invalid_argument("no such file as "+filename);
+	char magic[8];
+	if(f.read(magic, 8) && equal(magic, magic+8, bondsMagic))
+	{
+		boost::uint32_t header[2];
+		f.read(reinterpret_cast<char*>(header), sizeof(header));
+		if(!f || header[0] != bondsVersion)
+			throw invalid_argument(filename+" is not a valid binary bond file");
+		//the number of bonds must match the size of the file
+		const streampos start = f.tellg();
+		f.seekg(0, ios::end);
+		if((boost::uint64_t)(f.tellg() - start) != 2*sizeof(boost::uint32_t)*(boost::uint64_t)header[1])
+			throw invalid_argument(filename+" is truncated or corrupted");
+		f.seekg(start);
+		vector<boost::uint32_t> pairs(2*(size_t)header[1]);
+		if(!pairs.empty())
+			f.read(reinterpret_cast<char*>(&pairs[0]), pairs.size()*sizeof(boost::uint32_t));
+		if(!f)
+			throw invalid_argument(filename+" is truncated");
+		BondSet bonds;
+		bonds.reserve(header[1]);
+		for(size_t i=0; i<pairs.size(); i+=2)
+			bonds.insert(bonds.end(), Bond(pairs[i], pairs[i+1]));
+		return bonds;
+	}
+	//text fallback
+	f.clear();
+	f.seekg(0);
+	return BondSet(istream_iterator<Bond>(f), istream_iterator<Bond>());
+}
+
+/** @brief save bonds to file, in text (one bond per line) or binary format */
+void Colloids::saveBonds(const std::string &filename, const BondSet &bonds, const BondsFormat format)
+{
+	if(format == binary_bonds)
+	{
+		if(bonds.size() > numeric_limits<boost::uint32_t>::max())
+			throw invalid_argument("too many bonds for the binary format");
+		ofstream f(filename.c_str(), ios::out | ios::trunc | ios::binary);
+		if(!f)
+			throw invalid_argument("cannot open "+filename);
+		const boost::uint32_t header[2] = {bondsVersion, static_cast<boost::uint32_t>(bonds.size())};
+		f.write(bondsMagic, 8);
+		f.write(reinterpret_cast<const char*>(header), sizeof(header));
+		//Bond is a pair of 32 bits integers
+		if(!bonds.empty())
+			f.write(reinterpret_cast<const char*>(&bonds[0]), bonds.size()*sizeof(Bond));
+		return;
+	}
+	ofstream f(filename.c_str(), ios::out | ios::trunc);
+	if(!f)
+		throw invalid_argument("cannot open "+filename);
+	copy(bonds.begin(), bonds.end(), ostream_iterator<Bond>(f, "\n"));
+}
+
+/** @brief export a bondset to a stream in VTK format (heavier than saveBond)  */
+ostream & Colloids::toVTKstream(std::ostream &out, const BondSet &bonds)
+{
+	out << "LINES "<<bonds.size()<<" "<<bonds.size()*3<<endl;
+	for(BondSet::const_iterator b= bonds.begin();b!=bonds.end();++b)
+		out<<"2 "<< *b <<"\n";
+    return out;
+}
@@ -0,0 +1,182 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+
+ * \file bonds.hpp
+ * \brief Defines bonds between particles, sets of bonds and their files
+ * \author Mathieu Leocmach
+ * \date 18 October 2026
+ *
+ * A BondSet is a sorted array of pairs of 32 bits particle indices (8 bytes per bond).
+ * It is built in linear time from a sorted neighbour list, and the standard set algorithms
+ * (set_union, set_intersection, ...) work on it by merging.
+ *
+ * A .bonds file is either text (one "low high" pair per line) or binary:
+ * the 8 characters "COLBONDS", the format version and the number of bonds as 32 bits unsigned integers,
+ * then the pairs as 32 bits unsigned integers, all in the byte order of the machine.
+ * The pairs start at byte 16, so the file can be mapped in memory.
+ * loadBonds recognises both. saveBonds writes text unless the environment variable COLLOIDS_BONDS is set to binary,
+ * or the library was configured with --enable-binary-bonds.
+ */
+
+#ifndef bonds_H
+#define bonds_H
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <algorithm>
+#include <utility>
+#include <stdexcept>
+#include <limits>
+#include <boost/cstdint.hpp>
+
+namespace Colloids
+{
+    /** \brief An unordered pair of particle indices, stored as (low, high) */
+    struct Bond : private std::pair<boost::uint32_t, boost::uint32_t>
+	{
+		explicit Bond(const size_t &x, const size_t &y){this->assign(x,y);}
+		Bond(std::pair<size_t, size_t> p){this->assign(p.first, p.second);};
+		Bond(){first=static_cast<boost::uint32_t>(-2); second=static_cast<boost::uint32_t>(-1);}
+
+		void assign(const size_t &x, const size_t &y)
+		{
+			if(std::max(x, y) > std::numeric_limits<boost::uint32_t>::max())
+				throw std::length_error("Bond: particle index too large for 32 bits indices");
+			if(x<y)
+			{
+				this->first=x;
+				this->second=y;
+			}
+			else
+			{
+				this->first=y;
+				this->second=x;
+			}
+		};
+		size_t low() const {return this->first;}
+		size_t high() const {return this->second;}
+		bool operator<(const Bond &rhs) const
+		{
+			return (this->first < rhs.first) || (this->first == rhs.first && this->second < rhs.second);
+		}
+		bool operator==(const Bond &rhs) const
+		{
+			return this->first == rhs.first && this->second == rhs.second;
+		}
+	};
+
+    /**
+        \brief Sorted set of bonds in a contiguous array
+
+        Inserting in increasing order (as when converting a neighbour list) is amortized O(1).
+        Inserting a bond in the middle moves the bonds after it, so unordered bonds should be given as a range.
+    */
+    class BondSet
+    {
+        public:
+            typedef Bond value_type;
+            typedef const Bond& reference;
+            typedef const Bond& const_reference;
+            typedef std::vector<Bond>::const_iterator const_iterator;
+            typedef const_iterator iterator;
+            typedef std::vector<Bond>::size_type size_type;
+            typedef std::vector<Bond>::difference_type difference_type;
+
+            BondSet() {};
+            /** \brief constructor from any range of bonds, sorted or not, with or without duplicates */
+            template<class InputIterator>
+            BondSet(InputIterator first, InputIterator last) : bonds(first, last) {normalize(0);};
+
+            const_iterator begin() const {return bonds.begin();};
+            const_iterator end() const {return bonds.end();};
+            size_type size() const {return bonds.size();};
+            bool empty() const {return bonds.empty();};
+            const Bond& operator[](const size_type &i) const {return bonds[i];};
+            void clear() {bonds.clear();};
+            void reserve(const size_type &n) {bonds.reserve(n);};
+            void swap(BondSet &other) {bonds.swap(other.bonds);};
+
+            std::pair<const_iterator, bool> insert(const Bond &b);
+            /** \brief the hint is ignored, but makes std::inserter usable */
+            const_iterator insert(const_iterator, const Bond &b) {return insert(b).first;};
+            /** \brief insert a range of bonds by merging it with the present ones */
+            template<class InputIterator>
+            void insert(InputIterator first, InputIterator last)
+            {
+                const size_type old = bonds.size();
+                bonds.insert(bonds.end(), first, last);
+                normalize(old);
+            };
+            void push_back(const Bond &b) {insert(b);};
+
+            const_iterator find(const Bond &b) const
+            {
+                const_iterator it = std::lower_bound(begin(), end(), b);
+                return (it!=end() && *it==b) ? it : end();
+            };
+            size_type count(const Bond &b) const {return find(b)!=end();};
+            size_type erase(const Bond &b);
+
+            bool operator==(const BondSet &rhs) const {return bonds == rhs.bonds;};
+            bool operator!=(const BondSet &rhs) const {return bonds != rhs.bonds;};
+
+        private:
+            std::vector<Bond> bonds;
+
+            void normalize(const size_type &sorted);
+    };
+
+    /** \brief on disk format of the bonds */
+    enum BondsFormat {text_bonds=0, binary_bonds=1};
+    BondsFormat getBondsFormat();
+
+    BondSet loadBonds(const std::string &filename);
+    void saveBonds(const std::string &filename, const BondSet &bonds, const BondsFormat format=getBondsFormat());
+    std::ostream &toVTKstream(std::ostream &out, const BondSet &bonds);
+
+    inline std::ostream & operator<<(std::ostream& out, const Bond& b)
+    {
+    	out<<b.low()<<" "<<b.high();
+    	return out;
+    }
+    inline std::istream & operator>>(std::istream& in, Bond& b)
+    {
+    	size_t x,y;
+    	in>>x>>y;
+    	b = Bond(x,y);
+    	return in;
+    }
+
+    /** \brief insert a bond at its place. O(1) if it is larger than all the present bonds */
+    inline std::pair<BondSet::const_iterator, bool> BondSet::insert(const Bond &b)
+    {
+        if(bonds.empty() || bonds.back() < b)
+        {
+            bonds.push_back(b);
+            return std::make_pair(end()-1, true);
+        }
+        std::vector<Bond>::iterator it = std::lower_bound(bonds.begin(), bonds.end(), b);
+        if(*it == b)
+            return std::make_pair(const_iterator(it), false);
+        it = bonds.insert(it, b);
+        return std::make_pair(const_iterator(it), true);
+    }
+}
+
+#endif
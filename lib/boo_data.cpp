@@ -28,6 +28,7 @@
 #include <boost/math/special_functions/factorials.hpp>
 #include <boost/bind.hpp>
 #include "boo_data.hpp"
+#include "cpuDispatch.hpp"
 
 //double wigner3j( int l, int m1, int m2, int m3);
 
@@ -137,14 +138,133 @@ Coord cartesian2spherical(const Coord &cartesian)
 }
 
 
+namespace {
+	/** \brief Coefficients of the recurrence on l of the normalized associated Legendre functions */
+	struct LegendreCoefficients
+	{
+		double a[11][11], b[11][11], diag[11], subdiag[11];
+		LegendreCoefficients()
+		{
+			for(int m=0; m<11; ++m)
+			{
+				diag[m] = (m==0) ? sqrt(0.25/M_PI) : -sqrt((2.0*m+1.0)/(2.0*m));
+				subdiag[m] = sqrt(2.0*m+3.0);
+				for(int l=m+2; l<11; ++l)
+				{
+					a[l][m] = sqrt((4.0*l*l-1.0)/(l*l-m*m));
+					b[l][m] = sqrt(((l-1.0)*(l-1.0)-m*m)/(4.0*(l-1.0)*(l-1.0)-1.0));
+				}
+			}
+		}
+	};
+	const LegendreCoefficients legendre;
+
+	/** \brief Number of bonds processed together. The innermost loops run over a block and are vectorized. */
+	const int harmonicsBlock = 8;
+
+	/**
+		\brief Sum the spherical harmonics of even l<=10 and m>=0 of n bonds into the real and imaginary accumulators.
+		The associated Legendre functions are obtained by recurrence on l and the e^{im phi} by recurrence on m,
+		so no trigonometric function is evaluated.
+	*/
+	inline void sumHarmonics_impl(const double *bonds, const size_t n, double *re, double *im)
+	{
+		double accRe[36][harmonicsBlock], accIm[36][harmonicsBlock];
+		for(int i=0; i<36; ++i)
+			for(int b=0; b<harmonicsBlock; ++b)
+				accRe[i][b] = accIm[i][b] = 0.0;
+		for(size_t start=0; start<n; start+=harmonicsBlock)
+		{
+			double ct[harmonicsBlock], st[harmonicsBlock], w[harmonicsBlock],
+				cm[11][harmonicsBlock], sm[11][harmonicsBlock],
+				qmm[harmonicsBlock], q0[harmonicsBlock], q1[harmonicsBlock];
+			for(int b=0; b<harmonicsBlock; ++b)
+			{
+				const bool inside = start+b < n;
+				const double *r = bonds + 3*(inside ? start+b : 0);
+				const double rho2 = r[0]*r[0] + r[1]*r[1], r2 = rho2 + r[2]*r[2];
+				const double rho = sqrt(rho2), norm = sqrt(r2);
+				const bool axis = rho2 + 1.0 == 1.0 || r2 + 1.0 == 1.0;
+				ct[b] = axis ? 1.0 : r[2]/norm;
+				st[b] = axis ? 0.0 : rho/norm;
+				cm[1][b] = axis ? 1.0 : r[0]/rho;
+				sm[1][b] = axis ? 0.0 : r[1]/rho;
+				cm[0][b] = 1.0;
+				sm[0][b] = 0.0;
+				w[b] = inside ? 1.0 : 0.0;
+				qmm[b] = legendre.diag[0] * w[b];
+			}
+			for(int m=2; m<11; ++m)
+				for(int b=0; b<harmonicsBlock; ++b)
+				{
+					cm[m][b] = cm[m-1][b]*cm[1][b] - sm[m-1][b]*sm[1][b];
+					sm[m][b] = sm[m-1][b]*cm[1][b] + cm[m-1][b]*sm[1][b];
+				}
+			for(int m=0; m<11; ++m)
+			{
+				if(m>0)
+					for(int b=0; b<harmonicsBlock; ++b)
+						qmm[b] *= legendre.diag[m] * st[b];
+				for(int b=0; b<harmonicsBlock; ++b)
+				{
+					q0[b] = qmm[b];
+					q1[b] = legendre.subdiag[m] * ct[b] * qmm[b];
+				}
+				for(int l=m; l<11; ++l)
+				{
+					if(l >= m+2)
+						for(int b=0; b<harmonicsBlock; ++b)
+						{
+							const double q = legendre.a[l][m] * (ct[b] * q1[b] - legendre.b[l][m] * q0[b]);
+							q0[b] = q1[b];
+							q1[b] = q;
+						}
+					if(l%2)
+						continue;
+					const int i = m + l*l/4;
+					const double *q = (l == m) ? q0 : q1;
+					for(int b=0; b<harmonicsBlock; ++b)
+					{
+						accRe[i][b] += q[b] * cm[m][b];
+						accIm[i][b] += q[b] * sm[m][b];
+					}
+				}
+			}
+		}
+		for(int i=0; i<36; ++i)
+			for(int b=0; b<harmonicsBlock; ++b)
+			{
+				re[i] += accRe[i][b];
+				im[i] += accIm[i][b];
+			}
+	}
+
+	COLLOIDS_DISPATCH_VARIANTS(void, sumHarmonics, sumHarmonics_impl,
+		(const double *bonds, const size_t n, double *re, double *im), (bonds, n, re, im))
+
+	typedef void (*SumHarmonics)(const double *, const size_t, double *, double *);
+	const SumHarmonics sumHarmonics = dispatch<SumHarmonics>(
+		sumHarmonics_generic, sumHarmonics_sse42, sumHarmonics_avx2, sumHarmonics_avx512);
+}
+
 /** \brief constructor from one bond */
 BooData::BooData(const Coord &rij): valarray< complex <double> >(36)
 {
-    Coord spherical = cartesian2spherical(rij);
+    const double bond[3] = {rij[0], rij[1], rij[2]};
+    double re[36] = {0}, im[36] = {0};
+    sumHarmonics(bond, 1, re, im);
+	for(int i=0; i<36; ++i)
+        (*this)[i] = complex<double>(re[i], im[i]);
+    return;
+}
 
-	//fill in with spherical harmonics
-	for(int i=0; i<36; ++i)
-        (*this)[i] = boost::math::spherical_harmonic(i2l[i], i2m[i], spherical[1], spherical[2]);
+/** \brief constructor from the sum of the spherical harmonics of n bonds, given as 3n contiguous coordinates */
+BooData::BooData(const double *bonds, const size_t &n): valarray< complex <double> >(36)
+{
+    double re[36] = {0}, im[36] = {0};
+    sumHarmonics(bonds, n, re, im);
+	for(int i=0; i<36; ++i)
+        (*this)[i] = complex<double>(re[i], im[i]);
     return;
 }
 
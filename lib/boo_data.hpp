@@ -60,6 +60,7 @@ namespace Colloids
             /** \brief default constructor */
             BooData() : std::valarray< std::complex <double> >(std::complex <double>(0.0,0.0),36){return;};
             explicit BooData(const Coord &rij);
+            BooData(const double *bonds, const size_t &n);
             explicit BooData(const std::string &str);
             explicit BooData(const double* buff);
 
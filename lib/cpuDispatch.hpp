@@ -0,0 +1,121 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+
+ * \file cpuDispatch.hpp
+ * \brief Runtime selection of the instruction set used by the numeric kernels
+ * \author Mathieu Leocmach
+ * \date 18 October 2026
+ *
+ * The binaries are compiled for a generic target. The few kernels that matter are compiled
+ * several times with GCC target attributes and the best variant is chosen at runtime from CPUID.
+ * The environment variable COLLOIDS_ISA (generic, sse4.2, avx2 or avx512) forces a given variant,
+ * capped to what the processor supports.
+ *
+ * Header only, so that it can be shared with the multiscale project.
+ */
+
+#ifndef cpu_dispatch_H
+#define cpu_dispatch_H
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(__GNUC__) && !defined(__clang__) && (defined(__x86_64__) || defined(__i386__))
+    #define COLLOIDS_MULTIVERSION 1
+    /** \brief compile the following function for a given instruction set, inlining its callees */
+    #define COLLOIDS_TARGET(isa) __attribute__((target(isa), flatten))
+#else
+    #define COLLOIDS_TARGET(isa)
+#endif
+
+/** \brief define the four variants of a kernel whose generic body is the inline function IMPL */
+#define COLLOIDS_DISPATCH_VARIANTS(RET, NAME, IMPL, PARAMS, ARGS) \
+    RET NAME##_generic PARAMS {return IMPL ARGS;} \
+    COLLOIDS_TARGET("sse4.2") RET NAME##_sse42 PARAMS {return IMPL ARGS;} \
+    COLLOIDS_TARGET("avx2,fma") RET NAME##_avx2 PARAMS {return IMPL ARGS;} \
+    COLLOIDS_TARGET("avx512f,avx512dq,avx2,fma") RET NAME##_avx512 PARAMS {return IMPL ARGS;}
+
+namespace Colloids
+{
+    /** \brief Instruction sets for which the kernels are compiled, in increasing order */
+    enum Isa {isa_generic=0, isa_sse42=1, isa_avx2=2, isa_avx512=3};
+
+    /** \brief name of an instruction set, as accepted by COLLOIDS_ISA */
+    inline const char* isaName(const Isa isa)
+    {
+        static const char* names[4] = {"generic", "sse4.2", "avx2", "avx512"};
+        return names[isa];
+    }
+
+    /** \brief best instruction set supported by the processor */
+    inline Isa detectIsa()
+    {
+#ifdef COLLOIDS_MULTIVERSION
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq"))
+            return isa_avx512;
+        if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            return isa_avx2;
+        if(__builtin_cpu_supports("sse4.2"))
+            return isa_sse42;
+#endif
+        return isa_generic;
+    }
+
+    /** \brief instruction set selected from the processor and the COLLOIDS_ISA environment variable */
+    inline Isa selectIsa()
+    {
+        const Isa best = detectIsa();
+        const char* env = std::getenv("COLLOIDS_ISA");
+        if(!env || !*env)
+            return best;
+        for(int i=0; i<4; ++i)
+            if(!std::strcmp(env, isaName((Isa)i)))
+            {
+                if(i <= best)
+                    return (Isa)i;
+                std::cerr<<"COLLOIDS_ISA="<<env<<" is not supported by this processor, using "<<isaName(best)<<std::endl;
+                return best;
+            }
+        std::cerr<<"COLLOIDS_ISA="<<env<<" is not one of generic, sse4.2, avx2, avx512. Using "<<isaName(best)<<std::endl;
+        return best;
+    }
+
+    /** \brief instruction set used by the kernels during the whole run */
+    inline Isa getIsa()
+    {
+        static const Isa isa = selectIsa();
+        return isa;
+    }
+
+    /** \brief pick the variant of a kernel corresponding to the selected instruction set */
+    template<class F>
+    inline F dispatch(F gen, F sse, F avx, F avx5)
+    {
+        switch(getIsa())
+        {
+            case isa_avx512: return avx5;
+            case isa_avx2: return avx;
+            case isa_sse42: return sse;
+            default: return gen;
+        }
+    }
+}
+
+#endif
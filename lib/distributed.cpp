@@ -0,0 +1,473 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "distributed.hpp"
+#include "instrument.hpp"
+
+#include <fstream>
+#include <limits>
+#include <map>
+#include <cmath>
+
+using namespace std;
+using namespace Colloids;
+
+namespace {
+	/** \brief number of particles read by the root before being scattered */
+	const size_t loadBlock = 1<<20;
+	const size_t noCluster = numeric_limits<size_t>::max();
+
+	/** \brief address of the i-th element, valid for empty vectors (messages of zero length) */
+	template<typename T>
+	T* address(vector<T> &v, const size_t &i) {return v.empty() ? 0 : &v[0]+i;}
+
+	size_t findRoot(vector<size_t> &root, size_t p)
+	{
+		while(root[p] != p)
+		{
+			root[p] = root[root[p]];
+			p = root[p];
+		}
+		return p;
+	}
+}
+
+/**
+    @brief Constructor. Reads the frame on the root process and distributes it.
+
+    \param comm The processes sharing the frame. A cartesian communicator is derived from it.
+    \param filename A .dat file, read by the process of rank 0 only
+*/
+DistributedFrame::DistributedFrame(MPI_Comm comm, const std::string &filename, const double &radius, const Options &options) :
+	comm(MPI_COMM_NULL), options(options), globalSize(0), nbOwned(0), halo(0.0), parts(radius)
+{
+	Instrument::Timer timer("distributed.setup");
+	MPI_Comm_size(comm, &nbProcesses);
+	fill(dims, dims+3, 0);
+	MPI_Dims_create(nbProcesses, 3, dims);
+	int periods[3];
+	fill(periods, periods+3, options.periodic ? 1 : 0);
+	MPI_Cart_create(comm, 3, dims, periods, 1, &this->comm);
+	MPI_Comm_rank(this->comm, &rank);
+	MPI_Cart_coords(this->comm, rank, 3, coords);
+	try
+	{
+		load(filename);
+
+		//the ghosts must be within reach of the owned particles of the next domain
+		halo = 2.0 * radius * max(options.bondLength, options.rdfBins ? options.rdfRange : 0.0);
+		for(int d=0; d<3; ++d)
+			if((dims[d]>1 || options.periodic) && halo > domain.edges[d].second - domain.edges[d].first)
+				throw invalid_argument("The halo is wider than a domain. Use less processes or a shorter range.");
+		exchangeHalo();
+		Instrument::gauge("distributed.ghosts", getNbGhosts());
+
+		parts.makeRTreeIndex();
+		parts.makeNgbList(options.bondLength);
+	}
+	catch(...)
+	{
+		MPI_Comm_free(&this->comm);
+		throw;
+	}
+}
+
+DistributedFrame::~DistributedFrame()
+{
+	MPI_Comm_free(&comm);
+}
+
+/** @brief read the frame by blocks on the root process and send each particle to the process owning its domain */
+void DistributedFrame::load(const std::string &filename)
+{
+	Instrument::Timer timer("distributed.load");
+	ifstream file;
+	//same format as Particles(filename): header, upper edges of the box (the lower edges are 0), coordinates
+	double header[4] = {-1.0, 0.0, 0.0, 0.0};
+	if(!rank)
+	{
+		file.open(filename.c_str(), ios::in);
+		size_t trash, n = 0;
+		if(file >> trash >> n >> trash >> header[1] >> header[2] >> header[3])
+			header[0] = n;
+	}
+	MPI_Bcast(header, 4, MPI_DOUBLE, 0, comm);
+	if(header[0] < 0.0)
+		throw invalid_argument("No such file as "+filename);
+	globalSize = (size_t)header[0];
+	for(int d=0; d<3; ++d)
+	{
+		box.edges[d].first = 0.0;
+		box.edges[d].second = header[d+1];
+		const double width = header[d+1] / dims[d];
+		domain.edges[d].first = coords[d] * width;
+		domain.edges[d].second = (coords[d]+1) * width;
+	}
+	parts.bb = box;
+
+	vector<int> counts(nbProcesses), displs(nbProcesses), counts3(nbProcesses), displs3(nbProcesses);
+	vector<double> xyz, sendPos, recvPos;
+	vector<size_t> owner, sendIds, recvIds;
+	for(size_t start=0; start<globalSize; start+=loadBlock)
+	{
+		const size_t nb = min(loadBlock, globalSize-start);
+		int status = 1;
+		if(!rank)
+		{
+			xyz.resize(3*nb);
+			for(size_t i=0; i<3*nb; ++i)
+				file >> xyz[i];
+			if(!file)
+				status = 0;
+			//domain of each particle. The particles outside the box belong to the domains at its boundaries
+			owner.resize(nb);
+			fill(counts.begin(), counts.end(), 0);
+			for(size_t i=0; i<nb; ++i)
+			{
+				int c[3];
+				for(int d=0; d<3; ++d)
+				{
+					double &x = xyz[3*i+d];
+					const double period = box.edges[d].second;
+					if(options.periodic && period > 0.0)
+						x -= period * floor(x / period);
+					c[d] = period > 0.0 ? (int)floor(x / period * dims[d]) : 0;
+					c[d] = max(0, min(dims[d]-1, c[d]));
+				}
+				int r;
+				MPI_Cart_rank(comm, c, &r);
+				owner[i] = r;
+				counts[r]++;
+			}
+			for(int r=1; r<nbProcesses; ++r)
+				displs[r] = displs[r-1] + counts[r-1];
+			sendPos.resize(3*nb);
+			sendIds.resize(nb);
+			vector<int> next(displs);
+			for(size_t i=0; i<nb; ++i)
+			{
+				const int j = next[owner[i]]++;
+				copy(xyz.begin()+3*i, xyz.begin()+3*i+3, sendPos.begin()+3*j);
+				sendIds[j] = start + i;
+			}
+			for(int r=0; r<nbProcesses; ++r)
+			{
+				counts3[r] = 3*counts[r];
+				displs3[r] = 3*displs[r];
+			}
+		}
+		MPI_Bcast(&status, 1, MPI_INT, 0, comm);
+		if(!status)
+			throw invalid_argument(filename+" has less particles than announced in its header");
+
+		int nbMine = 0;
+		MPI_Scatter(&counts[0], 1, MPI_INT, &nbMine, 1, MPI_INT, 0, comm);
+		recvPos.resize(3*nbMine);
+		recvIds.resize(nbMine);
+		MPI_Scatterv(address(sendPos, 0), &counts3[0], &displs3[0], MPI_DOUBLE, address(recvPos, 0), 3*nbMine, MPI_DOUBLE, 0, comm);
+		MPI_Scatterv(address(sendIds, 0), &counts[0], &displs[0], mpiType(address(sendIds, 0)), address(recvIds, 0), nbMine, mpiType(address(recvIds, 0)), 0, comm);
+		Coord c(0.0, 3);
+		for(int i=0; i<nbMine; ++i)
+		{
+			copy(recvPos.begin()+3*i, recvPos.begin()+3*i+3, &c[0]);
+			parts.push_back(c);
+		}
+		ids.insert(ids.end(), recvIds.begin(), recvIds.end());
+	}
+	nbOwned = parts.size();
+	Instrument::gauge("distributed.owned", nbOwned);
+
+	//extent of all the particles, and number density of the frame
+	double mini[3], maxi[3];
+	fill(mini, mini+3, numeric_limits<double>::max());
+	fill(maxi, maxi+3, -numeric_limits<double>::max());
+	for(size_t p=0; p<nbOwned; ++p)
+		for(int d=0; d<3; ++d)
+		{
+			mini[d] = min(mini[d], parts[p][d]);
+			maxi[d] = max(maxi[d], parts[p][d]);
+		}
+	MPI_Allreduce(MPI_IN_PLACE, mini, 3, MPI_DOUBLE, MPI_MIN, comm);
+	MPI_Allreduce(MPI_IN_PLACE, maxi, 3, MPI_DOUBLE, MPI_MAX, comm);
+	for(int d=0; d<3; ++d)
+	{
+		extent.edges[d].first = mini[d];
+		extent.edges[d].second = maxi[d];
+	}
+	parts.density = globalSize / (options.periodic ? box : extent).area();
+}
+
+/**
+    @brief Receive the ghosts from the neighbouring domains, and record the messages for the later refreshes.
+
+    Along each dimension, the particles closer than the halo to the lower boundary are sent to the lower domain,
+    and the particles closer to the upper boundary to the upper domain. The ghosts received along the previous dimensions
+    are sent too.
+*/
+void DistributedFrame::exchangeHalo()
+{
+	Instrument::Timer timer("distributed.halo");
+	for(int d=0; d<3; ++d)
+	{
+		const double period = box.edges[d].second - box.edges[d].first;
+		//owned particles and ghosts of the previous dimensions
+		const size_t n = parts.size();
+		int lower, upper;
+		MPI_Cart_shift(comm, d, 1, &lower, &upper);
+		for(int side=0; side<2; ++side)
+		{
+			HaloStep step;
+			step.to = side ? upper : lower;
+			step.from = side ? lower : upper;
+			double shift = 0.0;
+			if(step.to != MPI_PROC_NULL)
+			{
+				for(size_t p=0; p<n; ++p)
+					if(side ? parts[p][d] >= domain.edges[d].second - halo : parts[p][d] < domain.edges[d].first + halo)
+						step.sent.push_back(p);
+				//the ghosts crossing the periodic boundaries are seen from the other side
+				if(!side && coords[d]==0)
+					shift = period;
+				if(side && coords[d]==dims[d]-1)
+					shift = -period;
+			}
+			const int tag = 2*d+side;
+			int nbSent = step.sent.size(), nbReceived = 0;
+			MPI_Sendrecv(&nbSent, 1, MPI_INT, step.to, tag, &nbReceived, 1, MPI_INT, step.from, tag, comm, MPI_STATUS_IGNORE);
+
+			vector<double> sendPos(3*nbSent), recvPos(3*nbReceived);
+			vector<size_t> sendIds(nbSent), recvIds(nbReceived);
+			for(int i=0; i<nbSent; ++i)
+			{
+				const Coord &c = parts[step.sent[i]];
+				copy(&c[0], &c[0]+3, sendPos.begin()+3*i);
+				sendPos[3*i+d] += shift;
+				sendIds[i] = ids[step.sent[i]];
+			}
+			MPI_Sendrecv(address(sendPos, 0), 3*nbSent, MPI_DOUBLE, step.to, tag, address(recvPos, 0), 3*nbReceived, MPI_DOUBLE, step.from, tag, comm, MPI_STATUS_IGNORE);
+			MPI_Sendrecv(address(sendIds, 0), nbSent, mpiType(address(sendIds, 0)), step.to, tag, address(recvIds, 0), nbReceived, mpiType(address(recvIds, 0)), step.from, tag, comm, MPI_STATUS_IGNORE);
+
+			step.first = parts.size();
+			step.count = nbReceived;
+			Coord c(0.0, 3);
+			for(int i=0; i<nbReceived; ++i)
+			{
+				copy(recvPos.begin()+3*i, recvPos.begin()+3*i+3, &c[0]);
+				parts.push_back(c);
+			}
+			ids.insert(ids.end(), recvIds.begin(), recvIds.end());
+			plan.push_back(step);
+		}
+	}
+}
+
+/** @brief replay the halo exchange on values, width per particle */
+template<typename T>
+void DistributedFrame::refresh(std::vector<T> &values, const size_t &width, MPI_Datatype type) const
+{
+	if(values.size() < width*parts.size())
+		throw invalid_argument("DistributedFrame: a value per local particle is needed");
+	vector<T> buffer;
+	for(size_t s=0; s<plan.size(); ++s)
+	{
+		const HaloStep &step = plan[s];
+		buffer.resize(width*step.sent.size());
+		for(size_t i=0; i<step.sent.size(); ++i)
+			copy(values.begin()+width*step.sent[i], values.begin()+width*(step.sent[i]+1), buffer.begin()+width*i);
+		MPI_Sendrecv(
+			address(buffer, 0), width*step.sent.size(), type, step.to, (int)s,
+			address(values, width*step.first), width*step.count, type, step.from, (int)s,
+			comm, MPI_STATUS_IGNORE);
+	}
+}
+
+void DistributedFrame::refreshGhosts(std::vector<double> &values, const size_t &width) const
+{
+	refresh(values, width, MPI_DOUBLE);
+}
+
+void DistributedFrame::refreshGhosts(std::vector<size_t> &values, const size_t &width) const
+{
+	refresh(values, width, mpiType(address(values, 0)));
+}
+
+/** @brief replay the halo exchange backward, the owners keeping the minimum of their value and of the values of their ghosts */
+void DistributedFrame::minGhosts(std::vector<size_t> &values) const
+{
+	if(values.size() < parts.size())
+		throw invalid_argument("DistributedFrame: a value per local particle is needed");
+	vector<size_t> buffer;
+	for(size_t s=plan.size(); s>0; --s)
+	{
+		const HaloStep &step = plan[s-1];
+		buffer.resize(step.sent.size());
+		MPI_Sendrecv(
+			address(values, step.first), step.count, mpiType(address(values, 0)), step.from, (int)s,
+			address(buffer, 0), buffer.size(), mpiType(address(buffer, 0)), step.to, (int)s,
+			comm, MPI_STATUS_IGNORE);
+		for(size_t i=0; i<buffer.size(); ++i)
+			values[step.sent[i]] = min(values[step.sent[i]], buffer[i]);
+	}
+}
+
+/** @brief owned particles inside a reduction of the extent of the frame. All the owned particles with periodic boundary conditions */
+std::vector<size_t> DistributedFrame::selectInside(const double &margin) const
+{
+	const BoundingBox inside = options.periodic ? extent : shrink(extent, margin, options.noZ);
+	vector<size_t> selection;
+	selection.reserve(nbOwned);
+	for(size_t p=0; p<nbOwned; ++p)
+	{
+		bool in = true;
+		for(int d=0; d<3 && in; ++d)
+			in = parts[p][d] >= inside.edges[d].first && parts[p][d] <= inside.edges[d].second;
+		if(in || options.periodic)
+			selection.push_back(p);
+	}
+	return selection;
+}
+
+/** @brief g(r) of the frame, the same on all the processes */
+std::vector<double> DistributedFrame::getRdf() const
+{
+	Instrument::Timer timer("distributed.rdf");
+	const vector<size_t> selection = selectInside(2.0*parts.radius*options.rdfRange);
+	Particles::RdfBinner b(parts, options.rdfBins, options.rdfRange);
+	b.fill(selection);
+	size_t n = selection.size();
+	MPI_Allreduce(MPI_IN_PLACE, address(b.g, 0), b.g.size(), MPI_DOUBLE, MPI_SUM, comm);
+	MPI_Allreduce(MPI_IN_PLACE, &n, 1, mpiType(&n), MPI_SUM, comm);
+	b.normalize(n);
+	return b.g;
+}
+
+/**
+    @brief BOO and coarse grained BOO, as FrameAnalysis.
+
+    The BOO of the owned particles are computed from their neighbours, then copied to their ghosts.
+    The coarse grained BOO of the ghosts are not computed.
+*/
+void DistributedFrame::computeBOOs()
+{
+	Instrument::Timer timer("distributed.boo");
+	const double margin = options.bondLength*parts.radius;
+	parts.getBOOs(selectInside(margin), qlm);
+	vector<double> buffer(72*parts.size());
+	for(size_t p=0; p<nbOwned; ++p)
+		qlm[p].toBinary(&buffer[72*p]);
+	refreshGhosts(buffer, 72);
+	for(size_t p=nbOwned; p<parts.size(); ++p)
+		qlm[p] = BooData(&buffer[72*p]);
+	parts.getCgBOOs(selectInside(2.0*margin), qlm, qlm_cg);
+}
+
+/** @brief histogram of the (coarse grained) Ql of the frame in [0,1], the same on all the processes */
+std::vector<size_t> DistributedFrame::getQlHistogram(const size_t &l, const bool coarse, const size_t &nbBins) const
+{
+	const vector<BooData> &boo = coarse ? qlm_cg : qlm;
+	vector<size_t> hist(nbBins, 0);
+	for(size_t p=0; p<min(nbOwned, boo.size()); ++p)
+		if(!boo[p].isnull())
+			hist[min(nbBins-1, (size_t)(boo[p].getQl(l) * nbBins))]++;
+	MPI_Allreduce(MPI_IN_PLACE, address(hist, 0), nbBins, mpiType(address(hist, 0)), MPI_SUM, comm);
+	return hist;
+}
+
+/**
+    @brief Label the clusters of bonded particles having a coarse grained Q6 above the threshold.
+
+    \return the label of each local particle: the smallest position in the file of the members of its cluster,
+    or the largest size_t if the particle does not belong to a cluster.
+    The local clusters are labelled, then the owners keep the smallest label of their ghosts and the ghosts
+    are refreshed, until no label changes anywhere.
+*/
+std::vector<size_t> DistributedFrame::getClusterLabels() const
+{
+	Instrument::Timer timer("distributed.clusters");
+	vector<size_t> labels(parts.size(), noCluster), before, root(parts.size()), smallest(parts.size());
+	for(size_t p=0; p<min(nbOwned, qlm_cg.size()); ++p)
+		if(!qlm_cg[p].isnull() && qlm_cg[p].getQl(6) > options.clusterQ6)
+			labels[p] = ids[p];
+	refreshGhosts(labels);
+
+	const NgbList &ngb = parts.getNgbList();
+	int changed = 1;
+	size_t iterations = 0;
+	while(changed)
+	{
+		before.assign(labels.begin(), labels.begin()+nbOwned);
+		//connected components of the local members, each taking the smallest label of its members
+		for(size_t p=0; p<parts.size(); ++p)
+			root[p] = p;
+		for(size_t p=0; p<parts.size(); ++p)
+			if(labels[p] != noCluster)
+				for(vector<size_t>::const_iterator q=ngb[p].begin(); q!=ngb[p].end(); ++q)
+					if(*q > p && labels[*q] != noCluster)
+					{
+						const size_t a = findRoot(root, p), b = findRoot(root, *q);
+						root[max(a, b)] = min(a, b);
+					}
+		fill(smallest.begin(), smallest.end(), noCluster);
+		for(size_t p=0; p<parts.size(); ++p)
+			if(labels[p] != noCluster)
+			{
+				size_t &s = smallest[findRoot(root, p)];
+				s = min(s, labels[p]);
+			}
+		for(size_t p=0; p<parts.size(); ++p)
+			if(labels[p] != noCluster)
+				labels[p] = smallest[findRoot(root, p)];
+
+		minGhosts(labels);
+		refreshGhosts(labels);
+		changed = !equal(before.begin(), before.end(), labels.begin());
+		MPI_Allreduce(MPI_IN_PLACE, &changed, 1, MPI_INT, MPI_LOR, comm);
+		iterations++;
+	}
+	Instrument::count("distributed.cluster_iterations", iterations);
+	return labels;
+}
+
+/** @brief (label, number of members) of each cluster, on the root process only. The other processes get an empty list */
+std::vector< std::pair<size_t, size_t> > DistributedFrame::getClusterSizes(const std::vector<size_t> &labels) const
+{
+	map<size_t, size_t> sizes;
+	for(size_t p=0; p<nbOwned; ++p)
+		if(labels[p] != noCluster)
+			sizes[labels[p]]++;
+	vector<size_t> local;
+	local.reserve(2*sizes.size());
+	for(map<size_t, size_t>::const_iterator s=sizes.begin(); s!=sizes.end(); ++s)
+	{
+		local.push_back(s->first);
+		local.push_back(s->second);
+	}
+	int n = local.size();
+	vector<int> counts(nbProcesses), displs(nbProcesses, 0);
+	MPI_Gather(&n, 1, MPI_INT, &counts[0], 1, MPI_INT, 0, comm);
+	for(int r=1; r<nbProcesses; ++r)
+		displs[r] = displs[r-1] + counts[r-1];
+	vector<size_t> all(rank ? 0 : displs.back()+counts.back());
+	MPI_Gatherv(address(local, 0), n, mpiType(address(local, 0)), address(all, 0), &counts[0], &displs[0], mpiType(address(all, 0)), 0, comm);
+
+	sizes.clear();
+	for(size_t i=0; i+1<all.size(); i+=2)
+		sizes[all[i]] += all[i+1];
+	return vector< pair<size_t, size_t> >(sizes.begin(), sizes.end());
+}
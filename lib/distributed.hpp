@@ -0,0 +1,130 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+
+ * \file distributed.hpp
+ * \brief Analysis of a single frame too large for one node, by spatial domain decomposition over MPI processes
+ * \author Mathieu Leocmach
+ * \date 18 October 2026
+ *
+ * The box is split into a cartesian grid of domains, one per process. Each process owns the particles of its domain
+ * and receives copies (ghosts) of the particles of the neighbouring domains closer than the halo width to its boundaries.
+ * The ghosts are exchanged dimension by dimension, forwarding the ghosts already received, so that the edges and corners
+ * of the domain are covered with six messages. With periodic boundary conditions, the ghosts crossing the box boundaries
+ * are shifted by the period: distances are then plain differences, and the local particles are not periodic.
+ *
+ * The neighbour lists and the BOO of the owned particles are computed locally. The BOO of the ghosts are then copied from
+ * their owners, so a halo of one bond length is enough for the coarse grained BOO. The g(r), the Ql histograms and the
+ * cluster labels are reduced over all the processes.
+ *
+ * All the member functions are collective: they must be called by all the processes of the communicator, in the same order.
+ */
+
+#ifndef distributed_frame_H
+#define distributed_frame_H
+
+#include "particles.hpp"
+
+#include <mpi.h>
+#include <boost/utility.hpp>
+
+namespace Colloids
+{
+    /** \brief MPI type of size_t, for the messages of counts and indices */
+    inline MPI_Datatype mpiType(const size_t*) {return sizeof(size_t)==8 ? MPI_UINT64_T : MPI_UINT32_T;}
+
+    /** \brief A frame distributed over the processes of a MPI communicator */
+    class DistributedFrame : boost::noncopyable
+    {
+        public:
+            /** \brief Parameters of the analyses, in units of the diameter */
+            struct Options
+            {
+                /** \brief maximum bond length */
+                double bondLength;
+                /** \brief number of bins and range of the g(r). The halo is at least as wide as the range */
+                size_t rdfBins;
+                double rdfRange;
+                /** \brief coarse grained Q6 above which a particle belongs to a cluster */
+                double clusterQ6;
+                /** \brief periodic boundary conditions, the period being the box of the file */
+                bool periodic;
+                /** \brief do not consider the boundaries perpendicular to z as walls (without periodic boundary conditions) */
+                bool noZ;
+
+                Options() : bondLength(1.3), rdfBins(200), rdfRange(15.0), clusterQ6(0.25), periodic(false), noZ(false) {};
+            };
+
+            DistributedFrame(MPI_Comm comm, const std::string &filename, const double &radius, const Options &options=Options());
+            ~DistributedFrame();
+
+            int getRank() const {return rank;};
+            int getNbProcesses() const {return nbProcesses;};
+            size_t getGlobalSize() const {return globalSize;};
+            size_t getNbOwned() const {return nbOwned;};
+            size_t getNbGhosts() const {return parts.size() - nbOwned;};
+            double getHalo() const {return halo;};
+            /** \brief owned particles [0, getNbOwned()) followed by the ghosts */
+            const Particles& getParticles() const {return parts;};
+            /** \brief position of each local particle in the file */
+            const std::vector<size_t>& getGlobalIds() const {return ids;};
+
+            std::vector<double> getRdf() const;
+            void computeBOOs();
+            /** \brief BOO of the local particles, null near the walls. Available after computeBOOs */
+            const std::vector<BooData>& getQlm() const {return qlm;};
+            const std::vector<BooData>& getCgQlm() const {return qlm_cg;};
+            std::vector<size_t> getQlHistogram(const size_t &l, const bool coarse, const size_t &nbBins) const;
+            std::vector<size_t> getClusterLabels() const;
+            std::vector< std::pair<size_t, size_t> > getClusterSizes(const std::vector<size_t> &labels) const;
+
+            /** \brief copy the values of the owned particles to their ghosts, width values per particle */
+            void refreshGhosts(std::vector<double> &values, const size_t &width=1) const;
+            void refreshGhosts(std::vector<size_t> &values, const size_t &width=1) const;
+            /** \brief reduce to the minimum the values of the ghosts with the values of their owners */
+            void minGhosts(std::vector<size_t> &values) const;
+
+        private:
+            /** \brief one message of the halo exchange */
+            struct HaloStep
+            {
+                int to, from;
+                std::vector<size_t> sent;
+                size_t first, count;
+            };
+
+            MPI_Comm comm;
+            int rank, nbProcesses, dims[3], coords[3];
+            const Options options;
+            size_t globalSize, nbOwned;
+            double halo;
+            /** \brief the box of the file, the extent of all the particles, and the box of the domain */
+            BoundingBox box, extent, domain;
+            DomainParticles parts;
+            std::vector<size_t> ids;
+            std::vector<HaloStep> plan;
+            std::vector<BooData> qlm, qlm_cg;
+
+            void load(const std::string &filename);
+            void exchangeHalo();
+            std::vector<size_t> selectInside(const double &margin) const;
+            template<typename T>
+            void refresh(std::vector<T> &values, const size_t &width, MPI_Datatype type) const;
+    };
+}
+
+#endif
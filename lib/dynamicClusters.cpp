@@ -24,6 +24,43 @@
 using namespace std;
 using namespace Colloids;
 
+namespace {
+    /** \brief growCluster for any kind of set as population */
+    template<class Population>
+    void grow(Population &population, std::set<size_t> &cluster, size_t center, const NgbList &ngbs)
+    {
+        for(size_t n=0;n<ngbs[center].size();++n)
+        {
+            //are we able to use this particle ?
+            typename Population::iterator toBeRemoved = population.find(ngbs[center][n]);
+            if(toBeRemoved != population.end())
+            {
+                cluster.insert(cluster.end(),ngbs[center][n]);
+                //this particle will be used now so it must be removed from the population
+                // to prevent infinite recursion
+                population.erase(toBeRemoved);
+                //recursion
+                grow(population,cluster,ngbs[center][n],ngbs);
+            }
+        }
+    }
+
+    /** \brief segregate for any kind of set as population */
+    template<class Population>
+    void segregateSet(Population &population, std::vector< std::set<size_t> > &clusters, const NgbList &ngbs)
+    {
+        size_t center = 0;
+        while(!population.empty())
+        {
+            center = *population.begin();
+            clusters.push_back(set<size_t>());
+            clusters.back().insert(center);
+            population.erase(population.begin());
+            grow(population,clusters.back(),center,ngbs);
+        }
+    }
+}
+
 /** @brief Grows recursively a cluster of neighbouring particles
   * \param population The indicies of the particles than can be added to the cluster
   * \param cluster Collecting the indicies of the particles belonging to the cluster
@@ -32,20 +69,7 @@ using namespace Colloids;
   */
 void Colloids::growCluster(std::set<size_t> &population, std::set<size_t> &cluster, size_t center, const NgbList &ngbs)
 {
-    for(size_t n=0;n<ngbs[center].size();++n)
-    {
-        //are we able to use this particle ?
-        set<size_t>::iterator toBeRemoved = population.find(ngbs[center][n]);
-        if(toBeRemoved != population.end())
-        {
-            cluster.insert(cluster.end(),ngbs[center][n]);
-            //this particle will be used now so it must be removed from the population
-            // to prevent infinite recursion
-            population.erase(toBeRemoved);
-            //recursion
-            growCluster(population,cluster,ngbs[center][n],ngbs);
-        }
-    }
+    grow(population, cluster, center, ngbs);
 }
 
 /** @brief Segregate a population of particles into clusters of recursively neighbouring particles
@@ -55,24 +79,19 @@ void Colloids::growCluster(std::set<size_t> &population, std::set<size_t> &clust
   */
 void Colloids::segregate(std::set<size_t> &population, std::vector< std::set<size_t> > &clusters, const NgbList &ngbs)
 {
-    size_t center = 0;
-    while(!population.empty())
-    {
-        center = *population.begin();
-        clusters.push_back(set<size_t>());
-        clusters.back().insert(center);
-        population.erase(population.begin());
-        growCluster(population,clusters.back(),center,ngbs);
-    }
+    segregateSet(population, clusters, ngbs);
 }
 
-/** @brief Segregate all particles into clusters of recursively neighbouring particles */
+/** @brief Segregate all particles into clusters of recursively neighbouring particles.
+  * The population is consumed during the call, so its nodes are taken from the arena.
+  */
 void Colloids::segregateAll(std::vector< std::set<size_t> > &clusters, const Particles& parts)
 {
-    set<size_t> all;
+    ArenaScope scope;
+    Scratch<size_t>::set all;
     for(size_t p=0;p<parts.size();++p)
         all.insert(all.end(),p);
-    segregate(all, clusters, parts.getNgbList());
+    segregateSet(all, clusters, parts.getNgbList());
 }
 
 /** @brief segregate at each time step a population of trajectories into clusters of recursively neighbouring particles
@@ -101,12 +120,13 @@ DynamicClusters& DynamicClusters::assign(DynamicParticles &dynParts, std::set<si
     vector< vector< set<size_t> > > unsorted_clusters(parts->getNbTimeSteps());
     for(size_t t=0;t<parts->getNbTimeSteps();++t)
     {
-        set<size_t> popul_t;
+        ArenaScope scope;
+        Scratch<size_t>::set popul_t;
         for(set<size_t>::const_iterator tr=population.begin();tr!=population.end();++tr)
 			if(parts->trajectories[*tr].exist(t))
 				popul_t.insert(popul_t.end(),parts->trajectories[*tr][t]);
 
-        segregate(popul_t, unsorted_clusters[t], parts->positions[t].getNgbList());
+        segregateSet(popul_t, unsorted_clusters[t], parts->positions[t].getNgbList());
     }
 
     //translate in terms of trajectories, removing single particle clusters
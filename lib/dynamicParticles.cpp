@@ -19,12 +19,14 @@
 
 #include "dynamicParticles.hpp"
 #include "files_series.hpp"
+#include "instrument.hpp"
 
 #include <boost/progress.hpp>
 #include <boost/bind.hpp>
 
 #include <ctime>
 #include <numeric>
+#include <limits>
 
 
 
@@ -38,28 +40,30 @@ DynamicParticles::DynamicParticles(const TrajMap &trajs, boost::ptr_vector<Parti
     trajectories(trajs), dt(time_step), radius(rad)
 {
     this->positions.swap(positions);
+    loaded = Interval(0, this->positions.size()-1);
 }
 
 /** @brief Constructor from data. Take the ownership of the positions and link them into trajectories.  */
 DynamicParticles::DynamicParticles(boost::ptr_vector<Particles>& positions, const double &rad,const double &time_step, const string &displFile, const size_t &offset) :
-    dt(time_step), radius(rad)
-{
+    dt(time_step), radius(rad)
+{
     this->positions.swap(positions);
-    removeDrift(displFile, offset);
+    loaded = Interval(0, this->positions.size()-1);
+    removeDrift(displFile, offset);
     link();
 }
 
 /** @brief Constructor from files. Load the positions. No linking necessary  */
 DynamicParticles::DynamicParticles(const TrajMap &trajs, FileSerie &files, const double &rad,const double &time_step) :
-    trajectories(trajs), dt(time_step), radius(rad)
+    trajectories(trajs), dt(time_step), radius(rad), frameFiles(new FileSerie(files))
 {
     fill(files);
 }
 
 /** @brief Constructor from files. Load the positions and link them into trajectories.  */
 DynamicParticles::DynamicParticles(FileSerie &files, const double &rad,const double &time_step) :
-    dt(time_step), radius(rad)
-{
+    dt(time_step), radius(rad), frameFiles(new FileSerie(files))
+{
     fill(files);
     removeDrift(files.head()+".displ", files.get_offset());
     link();
@@ -68,33 +72,19 @@ DynamicParticles::DynamicParticles(FileSerie &files, const double &rad,const dou
 /** \brief constructor from file */
 DynamicParticles::DynamicParticles(const string &filename)
 {
-    //extract the path from the filename
-    const size_t endfolder = filename.find_last_of("/\\");
-    const string folder = filename.substr(0,endfolder+1);
-    size_t t_offset, t_size;
-
-    ifstream input(filename.c_str(), ios::in);
-    if(!input.good())
-        throw invalid_argument((filename+" doesn't exist").c_str() );
-
-    //header
-    input >> radius >> dt;
-    input.get(); //escape the endl
-
-    //data of the file serie containing the positions
-    string base_name,token;
-    getline(input,base_name);
-    getline(input,token);
-    input >> t_offset >> t_size;
-
-    FileSerie files(folder+base_name, token, t_size, t_offset);
-    this->fill(files);
+    open(filename, Interval(0, numeric_limits<size_t>::max()));
+}
 
-    //construct the TrajIndex from file stream
-    input >> trajectories;
-    trajectories.makeInverse(this->getFrameSizes());
+/** \brief constructor from file, keeping in memory only the positions of the time steps in frames and the parts of the trajectories inside
+  *
+  * The time steps are the ones of the file, but the positions outside of frames are empty.
+  * Trajectories that do not overlap frames are not loaded, so the trajectory indices differ from the full file.
+  */
+DynamicParticles::DynamicParticles(const string &filename, const Interval &frames)
+{
+    open(filename, frames);
 }
-
+
 /**
     \brief Makes the smallest bounding box enclosing all positions of the trajectory
 */
@@ -539,8 +529,11 @@ void DynamicParticles::removeDrift()
     vector<Coord> relative_drifts(positions.size(), Coord(0.0,3)),
             drifts(positions.size(), Coord(0.0,3));
 
+    //only the time steps in memory can be corrected
+    const ssize_t first = loaded.first, end = min(loaded.second+1, getNbTimeSteps());
+
     //#pragma omp parallel for shared(relative_drifts)
-    for(ssize_t t=1;t<(ssize_t)getNbTimeSteps();++t)
+    for(ssize_t t=first+1;t<end;++t)
         relative_drifts[t] = - getDrift(t-1, t);
 
     partial_sum(
@@ -550,14 +543,14 @@ void DynamicParticles::removeDrift()
 
     Coord maxNegativeDrift(0.0,3);
     //#pragma omp parallel for shared(drifts, maxNegativeDrift)
-    for(ssize_t t=1;t<(ssize_t)getNbTimeSteps();++t)
+    for(ssize_t t=first+1;t<end;++t)
         for(size_t i=0;i<3;++i)
             if(drifts[t][i] < maxNegativeDrift[i])
                 maxNegativeDrift[i] = drifts[t][i];
 
     //the smallest value for origin coordinates is set to 0
     //#pragma omp parallel for shared(drifts, maxNegativeDrift)
-    for(ssize_t t0=0;t0<(ssize_t)positions.size();++t0)
+    for(ssize_t t0=first;t0<end;++t0)
     {
         Coord dr(3);
         dr = drifts[t0] - maxNegativeDrift;
@@ -629,18 +622,14 @@ double DynamicParticles::getSD(const vector<size_t>&selection,const size_t &t0,c
   */
 vector<double> DynamicParticles::getSD(const size_t &t, const size_t &halfInterval) const
 {
-	vector<Coord> vel = velocities(t, halfInterval);
-	vector<double> sd(vel.size());
-	transform(
-		vel.begin(), vel.end(),
-		vel.begin(), sd.begin(),
-		dot
-		);
-	transform(
-		sd.begin(), sd.end(), sd.begin(),
-		bind2nd(multiplies<double>(), halfInterval*2+1)
-		);
-	return sd;
+	vector<double> vel(3*getNbPositions(t, t+1));
+	if(vel.empty())
+		return vector<double>();
+	displacements(&vel[0], t, t+1, halfInterval);
+	vector<double> sd(vel.size()/3);
+	for(size_t p=0; p<sd.size(); ++p)
+		sd[p] = (halfInterval*2+1) * (vel[3*p]*vel[3*p] + vel[3*p+1]*vel[3*p+1] + vel[3*p+2]*vel[3*p+2]);
+	return sd;
 }
 
 
@@ -648,6 +637,8 @@ vector<double> DynamicParticles::getSD(const size_t &t, const size_t &halfInterv
 /** \brief Mean square displacement function of time between t0 and t1 for a selection of trajectories */
 vector<double> DynamicParticles::getMSD(const vector<size_t> &selection,const size_t &t0,const size_t &t1,const size_t &t3) const
 {
+    if(getStoragePrecision() == float_storage)
+        return getMSD_packed<float>(selection, t0, t1, t3);
     const size_t nb_selection = selection.size();
     vector<double> sumSD(t1-t0+1,0.0), nbSD(t1-t0+1,0.0);
     if(selection.empty())
@@ -679,6 +670,69 @@ vector<double> DynamicParticles::getMSD(const vector<size_t> &selection,const si
     return sumSD;
 }
 
+/** \brief Mean square displacement function of time between t0 and t1 for a selection of trajectories.
+    Same as getMSD, but the positions of the selection are first copied frame by frame in the storage precision.
+    The displacements are computed in the storage precision and summed in double.
+*/
+template<class Real>
+vector<double> DynamicParticles::getMSD_packed(const vector<size_t> &selection,const size_t &t0,const size_t &t1,const size_t &t3) const
+{
+    const size_t nb_selection = selection.size();
+    vector<double> sumSD(t1-t0+1,0.0);
+    if(selection.empty())
+        return sumSD;
+
+    //positions of the selection at each time step of the interval of interest
+    const size_t last = (t3==0) ? t1 : t1+t3-1;
+    vector<Real> packed(3*nb_selection*(last-t0+1));
+    for(size_t t=t0; t<=last; ++t)
+        for(size_t tr=0; tr<nb_selection; ++tr)
+        {
+            const Coord &c = (*this)(selection[tr], t);
+            for(size_t d=0; d<3; ++d)
+                packed[3*(nb_selection*(t-t0) + tr) + d] = c[d];
+        }
+    //square displacement of the selection between two time steps, in double
+    vector<double> nbSD(t1-t0+1,0.0);
+    const size_t nbPairs = (t3==0) ? (t1-t0)*(t1-t0+1)/2 : t3*(t1-t0);
+    vector<double> SD(nbPairs);
+    vector< pair<size_t, size_t> > pairs;
+    pairs.reserve(nbPairs);
+    if(t3==0)
+    {
+        for(size_t start=t0;start<t1;++start)
+            for(size_t stop=start+1;stop<=t1;++stop)
+                pairs.push_back(make_pair(start, stop));
+    }
+    else
+        for(size_t Dt=1;Dt<sumSD.size();++Dt)
+            for(size_t start=0;start<t3;++start)
+                pairs.push_back(make_pair(t0+start, t0+start+Dt));
+    #pragma omp parallel for schedule(dynamic)
+    for(ssize_t i=0; i<(ssize_t)pairs.size(); ++i)
+    {
+        const Real *from = &packed[3*nb_selection*(pairs[i].first-t0)],
+            *to = &packed[3*nb_selection*(pairs[i].second-t0)];
+        double sd = 0.0;
+        for(size_t j=0; j<3*nb_selection; ++j)
+        {
+            const Real x = to[j] - from[j];
+            sd += (double)x*x;
+        }
+        SD[i] = sd;
+    }
+    for(size_t i=0; i<pairs.size(); ++i)
+    {
+        sumSD[pairs[i].second-pairs[i].first] += SD[i];
+        nbSD[pairs[i].second-pairs[i].first] += 1.0;
+    }
+    for(size_t t=1;t<sumSD.size();++t)
+        sumSD[t] /= nbSD[t] * nb_selection;
+    return sumSD;
+}
+template vector<double> DynamicParticles::getMSD_packed<float>(const vector<size_t>&, const size_t&, const size_t&, const size_t&) const;
+template vector<double> DynamicParticles::getMSD_packed<double>(const vector<size_t>&, const size_t&, const size_t&, const size_t&) const;
+
 /** \brief Mean square displacement function of lag time.
     \param t0 begining of the interval of interest
     \param t1 so that t1-t0 is the maximum lag time
@@ -768,6 +822,7 @@ vector<double> DynamicParticles::getNonGaussian(const std::vector<size_t> &selec
 /** @brief get both Mean Square Displacement and Non Gaussian Parameter  */
 void DynamicParticles::get_MSD_NGP(const std::vector<size_t> &selection, std::vector<double> &MSD, std::vector<double> &NGP, const size_t &t0, const size_t &t1, const size_t &t3) const
 {
+	Instrument::Timer timer("get_MSD_NGP");
 	const size_t nb_selection = selection.size();
 	//NGP is used to store the quadratic displacements
 	NGP.assign(t1-t0+1,0.0);
@@ -900,8 +955,8 @@ vector<double> DynamicParticles::getSelfISF(const vector<size_t> &selection,cons
     //boost::progress_display show_progress(2*(t1-t0));
 
     //fill in the basic data used for calculation
-    vector< vector<double> > A(t1+t3-t0,vector<double>(nb_selection,0.0)), B=A;
-    vector<double> sumISF(t1-t0,0.0);
+    vector< vector<double> > A(t1-t0+max(t3,(size_t)1),vector<double>(nb_selection,0.0)), B=A;
+    vector<double> sumISF(t1-t0+1,0.0);
     //#pragma omp parallel for shared(selection, t0, t3, q)
     for(size_t t=0;t<A.size();++t)
     {
@@ -950,7 +1005,7 @@ vector<double> DynamicParticles::getSelfISF(const Coord &q,const size_t &t0,cons
     if(t2==0)
         return getSelfISF(selectSpanning(Interval(t0,t1+t2)),q,t0,t1,t2);
 
-    vector<double> ISF(t1-t0, 0.0);
+    vector<double> ISF(t1-t0+1, 0.0);
     size_t count=0;
     for(size_t start=t0; start<t2; ++start)
     {
@@ -976,7 +1031,7 @@ vector<double> DynamicParticles::getSelfISF(const size_t &t0,const size_t &t1,co
     for(size_t d=0;d<3;++d)
         q[d][d] = M_PI/radius;
 
-    vector<double>ISF(t1-t0);
+    vector<double>ISF(t1-t0+1, 0.0);
     if(t2==0)
     {
         const vector<size_t> sp = selectSpanning(Interval(t0,t1+t2));
@@ -1014,24 +1069,37 @@ vector<double> DynamicParticles::getSelfISF(const size_t &t0,const size_t &t1,co
 /**
     @brief make MSD, Self ISF and Non Gaussian Parameter for various sets of trajectories
   */
-void DynamicParticles::makeDynamics(const std::vector< std::vector<size_t> >&sets,std::vector< std::vector<double> > &MSD, std::vector< std::vector<double> > &ISF, std::vector< std::vector<double> > &NGP) const
+void DynamicParticles::makeDynamics(const std::vector< std::vector<size_t> >&sets,std::vector< std::vector<double> > &MSD, std::vector< std::vector<double> > &ISF, std::vector< std::vector<double> > &NGP, const bool cageRelative) const
 {
+	Instrument::Timer timer("makeDynamics");
 	const size_t stop = getNbTimeSteps()-1;
 	MSD.assign(sets.size(),vector<double>(stop+1));
 	NGP.assign(sets.size(),vector<double>(stop+1));
 	ISF.assign(sets.size()*4,vector<double>(stop+1));
 	cout << "get Mean Square Displacement and Self Intermediate Scattering Function"<<endl;
+	if(cageRelative)
+		cout << "relative to the initial neighbours"<<endl;
 
 	vector<Coord> q(3, Coord(0.0,3));
     for(size_t d=0;d<3;++d)
         q[d][d] = M_PI/radius;
 
-	for(size_t s=0;s<sets.size();++s)
+	for(size_t s=0;s<sets.size();++s)
 	{
-        get_MSD_NGP(sets[s], MSD[s], NGP[s], 0, stop);
-        #pragma omp parallel for
-        for(int d=0;d<3;++d)
-        	ISF[4*s+d] = getSelfISF(sets[s],q[d],0,stop);
+		if(cageRelative)
+		{
+			vector< vector<double> > isf;
+			get_cage_MSD_NGP_ISF(sets[s], MSD[s], NGP[s], isf, 0, stop);
+			for(int d=0;d<3;++d)
+				ISF[4*s+d].swap(isf[d]);
+		}
+		else
+		{
+	        get_MSD_NGP(sets[s], MSD[s], NGP[s], 0, stop);
+	        #pragma omp parallel for
+	        for(int d=0;d<3;++d)
+	        	ISF[4*s+d] = getSelfISF(sets[s],q[d],0,stop);
+		}
 		for(size_t t=0;t<ISF[4*s+3].size();++t)
 		{
 			for(size_t d=0;d<3;++d)
@@ -1065,10 +1133,10 @@ void DynamicParticles::makeDynamics(vector<double> &MSD, vector<double> &ISF, st
 /**
     @brief make and export MSD, Self ISF and Non Gaussian Parameter for various sets of trajectories
   */
-void DynamicParticles::exportDynamics(const std::vector< std::vector<size_t> >&sets,const std::vector<std::string>&setsNames,const std::string &inputPath) const
+void DynamicParticles::exportDynamics(const std::vector< std::vector<size_t> >&sets,const std::vector<std::string>&setsNames,const std::string &inputPath, const bool cageRelative) const
 {
     vector< vector<double> > MSD, ISF, NGP;
-    makeDynamics(sets,MSD,ISF, NGP);
+    makeDynamics(sets,MSD,ISF, NGP, cageRelative);
 
     string xyz[3] = {"x","y","z"};
     ofstream msd_f((inputPath + ".msd").c_str());
@@ -1106,32 +1174,146 @@ void DynamicParticles::exportDynamics(const std::vector< std::vector<size_t> >&s
 }
 
 /** @brief make and export MSD, Self ISF and Non Gaussian Parameter  */
-void DynamicParticles::exportDynamics(const string &inputPath) const
+void DynamicParticles::exportDynamics(const string &inputPath, const bool cageRelative) const
 {
     vector< vector<size_t> > sets(1, selectSpanning(Interval(0, getNbTimeSteps()-1)));
     vector<string> setsNames(1,"");
-    exportDynamics(sets,setsNames,inputPath);
+    exportDynamics(sets,setsNames,inputPath, cageRelative);
 }
 
-/** @brief velocities of every particle at time t
+/** @brief Displacement of a trajectory between t0 and t1, relative to the mean displacement of its neighbours at t0
+  *
+  * Neighbours are given by the neighbour list of frame t0. Neighbours whose trajectory does not exist at t1 are ignored.
+  * \param diff Output array of 3 doubles
+  * \return false if the trajectory does not span [t0, t1]
+  */
+bool DynamicParticles::getCageDiff(const size_t &tr, const size_t &t0, const size_t &t1, double *diff) const
+{
+	const Traj &traj = trajectories[tr];
+	if(!traj.span(t0, t1))
+		return false;
+	if(!positions[t0].hasNgbList())
+		throw logic_error("DynamicParticles::getCageDiff: make the neighbour list of the initial frame before");
+	const Coord &a = positions[t0][traj[t0]], &b = positions[t1][traj[t1]];
+	for(size_t d=0; d<3; ++d)
+		diff[d] = b[d] - a[d];
+	const vector<size_t> &ngbs = positions[t0].getNgbList()[traj[t0]];
+	const vector<size_t> &inverse = trajectories.getInverse(t0);
+	double cage[3] = {0.0, 0.0, 0.0};
+	size_t nb = 0;
+	for(size_t n=0; n<ngbs.size(); ++n)
+	{
+		const Traj &ngb = trajectories[inverse[ngbs[n]]];
+		if(ngbs[n] == traj[t0] || !ngb.exist(t1))
+			continue;
+		const Coord &c = positions[t0][ngbs[n]], &e = positions[t1][ngb[t1]];
+		for(size_t d=0; d<3; ++d)
+			cage[d] += e[d] - c[d];
+		nb++;
+	}
+	if(nb>0)
+		for(size_t d=0; d<3; ++d)
+			diff[d] -= cage[d] / nb;
+	return true;
+}
 
-	Using centered scheme except at begining and end of trajectory.
- */
-vector<Coord> DynamicParticles::velocities(const size_t &t, const size_t &halfInterval) const
+/** @brief Cage relative displacements of a selection of trajectories from t0 to every time until t1 (included)
+  *
+  * \param out Caller allocated array of 3*(t1-t0+1)*selection.size() values, ordered by time, then by selection, then by coordinate.
+  * Trajectories that do not exist at a given time have a null displacement.
+  */
+void DynamicParticles::cageDisplacements(double *out, const std::vector<size_t> &selection, const size_t &t0, const size_t &t1) const
 {
-	vector<Coord> vel(trajectories.getInverse(t).size(), Coord(0.0, 3));
-	size_t start, stop;
-	for(size_t p=0; p<trajectories.getInverse(t).size(); ++p)
+	const size_t nb_selection = selection.size();
+	std::fill(out, out + 3*(t1-t0+1)*nb_selection, 0.0);
+	#pragma omp parallel for schedule(dynamic)
+	for(int s=0; s<(int)nb_selection; ++s)
+		for(size_t t=t0+1; t<=t1; ++t)
+			if(!getCageDiff(selection[s], t0, t, out + 3*((t-t0)*nb_selection + s)))
+				break;
+}
+
+/** @brief Cage relative MSD, NGP and self ISF along x, y and z, averaged over all time origins between t0 and t1
+  *
+  * Normalisation is the same as get_MSD_NGP and getSelfISF.
+  */
+void DynamicParticles::get_cage_MSD_NGP_ISF(const std::vector<size_t> &selection, std::vector<double> &MSD, std::vector<double> &NGP, std::vector< std::vector<double> > &ISF, const size_t &t0, const size_t &t1) const
+{
+	const size_t nb_lags = t1-t0+1;
+	MSD.assign(nb_lags, 0.0);
+	NGP.assign(nb_lags, 0.0);
+	ISF.assign(3, vector<double>(nb_lags, 0.0));
+	vector<double> nb(nb_lags, 0.0);
+	const double q = M_PI/radius;
+
+	#pragma omp parallel
 	{
-		const Traj &tr = trajectories[trajectories.getInverse(t)[p]];
-		if(tr.steps.size()>1)
+		vector<double> msd(nb_lags, 0.0), ngp(nb_lags, 0.0), n(nb_lags, 0.0);
+		vector< vector<double> > isf(3, vector<double>(nb_lags, 0.0));
+		double diff[3];
+		for(size_t start=t0; start<t1; ++start)
 		{
-			start = max((int)(t-halfInterval), (int)tr.start_time);
-			stop = min(t+halfInterval, tr.last_time());
-			vel[p] = (positions[stop][tr[stop]] - positions[start][tr[start]]) / (double)(stop-start);
+			#pragma omp for schedule(dynamic) nowait
+			for(int s=0; s<(int)selection.size(); ++s)
+				for(size_t stop=start+1; stop<=t1; ++stop)
+				{
+					if(!getCageDiff(selection[s], start, stop, diff))
+						break;
+					const double sd = diff[0]*diff[0] + diff[1]*diff[1] + diff[2]*diff[2];
+					msd[stop-start] += sd;
+					ngp[stop-start] += sd*sd;
+					for(size_t d=0; d<3; ++d)
+						isf[d][stop-start] += cos(q*diff[d]);
+					n[stop-start] += 1.0;
+				}
+		}
+		#pragma omp critical
+		{
+			for(size_t t=0; t<nb_lags; ++t)
+			{
+				MSD[t] += msd[t];
+				NGP[t] += ngp[t];
+				nb[t] += n[t];
+				for(size_t d=0; d<3; ++d)
+					ISF[d][t] += isf[d][t];
+			}
 		}
 	}
-	return vel;
+	for(size_t t=1; t<nb_lags; ++t)
+		if(nb[t]>0)
+		{
+			NGP[t] *= nb[t] / (3.0 * MSD[t] * MSD[t]);
+			MSD[t] /= nb[t] * pow(2.0*radius,2.0);
+			for(size_t d=0; d<3; ++d)
+				ISF[d][t] /= nb[t];
+		}
+	for(size_t d=0; d<3; ++d)
+		ISF[d][0] = 1.0;
+}
+
+/** @brief velocities of every particle at time t
+
+	Using centered scheme except at begining and end of trajectory.
+ */
+vector<Coord> DynamicParticles::velocities(const size_t &t, const size_t &halfInterval) const
+{
+	vector<double> flat(3*getNbPositions(t, t+1));
+	if(flat.empty())
+		return vector<Coord>();
+	displacements(&flat[0], t, t+1, halfInterval);
+	vector<Coord> vel(flat.size()/3, Coord(0.0, 3));
+	for(size_t p=0; p<vel.size(); ++p)
+		copy(&flat[3*p], &flat[3*p]+3, &vel[p][0]);
+	return vel;
+}
+
+/** @brief total number of positions in the frames t0 to t1 (excluded) */
+size_t DynamicParticles::getNbPositions(const size_t &t0, const size_t &t1) const
+{
+	size_t n = 0;
+	for(size_t t=t0; t<t1; ++t)
+		n += trajectories.getInverse(t).size();
+	return n;
 }
 
 
@@ -1469,13 +1651,146 @@ void DynamicParticles::makeSlidingTimeAverage(
 void DynamicParticles::fill(FileSerie &files)
 {
     positions.reserve(files.size());
+    vector<size_t> steps(files.size());
     for(size_t t=0; t<files.size();++t)
-        positions.push_back(new Particles(files%t, radius));
+    {
+        positions.push_back(new Particles(0, 0.0, radius));
+        steps[t] = t;
+    }
+    load(files, steps);
+    loaded = Interval(0, files.size()-1);
+}
+
+/** @brief read the positions of some time steps, the files being read in parallel  */
+void DynamicParticles::load(FileSerie &files, const std::vector<size_t> &steps)
+{
+    Instrument::Timer timer("load_frames");
+    //the file serie formats the names in place, so it cannot be shared by the readers
+    vector<string> names(steps.size());
+    for(size_t i=0; i<steps.size(); ++i)
+        names[i] = files%steps[i];
+    vector<Particles*> frames(steps.size(), (Particles*)0);
+    string error;
+    #pragma omp parallel for schedule(dynamic)
+    for(ssize_t i=0; i<(ssize_t)steps.size(); ++i)
+    {
+        try
+        {
+            frames[i] = new Particles(names[i], radius);
+        }
+        catch(const exception &e)
+        {
+            #pragma omp critical
+            error = e.what();
+        }
+    }
+    if(!error.empty())
+    {
+        for(size_t i=0; i<frames.size(); ++i)
+            delete frames[i];
+        throw invalid_argument(error);
+    }
+    for(size_t i=0; i<steps.size(); ++i)
+        positions.replace(steps[i], frames[i]);
+}
+
+/** @brief read the header and the trajectories of a .traj file, and the positions of the time steps in frames  */
+void DynamicParticles::open(const std::string &filename, const Interval &frames)
+{
+    //extract the path from the filename
+    const size_t endfolder = filename.find_last_of("/\\");
+    const string folder = filename.substr(0,endfolder+1);
+    size_t t_offset, t_size;
+
+    ifstream input(filename.c_str(), ios::in);
+    if(!input.good())
+        throw invalid_argument((filename+" doesn't exist").c_str() );
+
+    //header
+    input >> radius >> dt;
+    input.get(); //escape the endl
+
+    //data of the file serie containing the positions
+    string base_name,token;
+    getline(input,base_name);
+    getline(input,token);
+    input >> t_offset >> t_size;
+    frameFiles.reset(new FileSerie(folder+base_name, token, t_size, t_offset));
+
+    //positions of the time steps of interest
+    const Interval window(frames.first, min(frames.second, t_size-1));
+    if(window.first > window.second)
+        throw invalid_argument((boost::format("[%1%,%2%] not included in [0,%3%]") % frames.first % frames.second % (t_size-1)).str());
+    positions.reserve(t_size);
+    for(size_t t=0; t<t_size; ++t)
+        positions.push_back(new Particles(0, 0.0, radius));
+    vector<size_t> steps;
+    for(size_t t=window.first; t<=window.second; ++t)
+        steps.push_back(t);
+    load(*frameFiles, steps);
+    loaded = window;
+
+    //construct the TrajIndex from file stream
+    readWithin(input, trajectories, window);
+    trajectories.makeInverse(this->getFrameSizes());
+}
+
+/** @brief keep in memory only the positions of the time steps in frames
+  *
+  * The time steps that are not in memory yet are read in parallel, and the positions outside of frames are freed.
+  * Trajectories are not reloaded, so frames should stay within the time steps given to the constructor.
+  * The newly read positions are as in the files: remove the drift again if needed.
+  */
+void DynamicParticles::setWindow(const Interval &frames)
+{
+    if(!frameFiles.get())
+        throw logic_error("The positions were not read from files");
+    if(frames.first > frames.second || frames.second >= getNbTimeSteps())
+        throw invalid_argument((boost::format("[%1%,%2%] not included in [0,%3%]") % frames.first % frames.second % (getNbTimeSteps()-1)).str());
+
+    vector<size_t> steps;
+    for(size_t t=0; t<getNbTimeSteps(); ++t)
+    {
+        const bool inMemory = (t>=loaded.first && t<=loaded.second),
+            needed = (t>=frames.first && t<=frames.second);
+        if(inMemory && !needed)
+            positions.replace(t, new Particles(0, 0.0, radius));
+        else if(needed && !inMemory)
+            steps.push_back(t);
+    }
+    load(*frameFiles, steps);
+    loaded = frames;
+    Instrument::gauge("loaded_frames", (double)(loaded.second-loaded.first+1));
+
+    trajectories.makeInverse(this->getFrameSizes());
+    //STindex is now completely wrong and has to be made anew
+    this->index.reset();
+}
+
+/** @brief Give the spatial index of the time step t to the time step t+1, following the trajectories.
+  *
+  * Most particles move less than the size of a node, so updating the index in place is cheaper than making it anew.
+  * The time step t is left without index.
+  */
+void DynamicParticles::moveIndex(const size_t &t)
+{
+    if(t+1 >= getNbTimeSteps())
+        throw invalid_argument((boost::format("No time step after %1%") % t).str());
+    const vector<size_t> &inverse = trajectories.getInverse(t);
+    vector<size_t> ids(positions[t].size(), SpatialIndex::noItem);
+    for(size_t p=0; p<ids.size(); ++p)
+    {
+        const Traj &tr = trajectories[inverse[p]];
+        if(tr.exist(t+1))
+            ids[p] = tr[t+1];
+    }
+    positions[t].moveIndex(positions[t+1], ids);
 }
 
 /** @brief link positions into trajectories  */
 void DynamicParticles::link()
 {
+    Instrument::Timer timer("link");
 	const double range = this->radius * 2.0;
     //spatially index each unindexed frame by a RTreeIndex. Needed for the linking
     cout<<"index"<<endl;
@@ -1491,13 +1806,10 @@ void DynamicParticles::link()
     for(size_t t=0; t<positions.size()-1; ++t)
     {
         size_t nbTraj = tm.getNbTraj();
-        vector< multimap<double,size_t> > followersByDist(positions[t].size());
-
-        #pragma omp parallel for schedule(runtime)
-        for(ssize_t p=0;p<(ssize_t)positions[t].size();++p)
-            followersByDist[p] = positions[t+1].getEuclidianNeighboursBySqDist(positions[t][p], range);
+        vector< multimap<double,size_t> > followersByDist = positions[t+1].getEuclidianNeighboursBySqDist(positions[t], range);
 
         tm.push_back(followersByDist, positions[t+1].size());
+        Instrument::count("link.frames");
 
         Error = (tm.getNbTraj() - nbTraj)/(double)tm.getNbTraj();
         sumError+=Error;
@@ -1509,6 +1821,7 @@ void DynamicParticles::link()
 
     //create the trajIndex from the trajMap
     trajectories = TrajIndex(tm);
+    Instrument::gauge("link.trajectories", trajectories.size());
 }
 
 
@@ -65,6 +65,7 @@ namespace Colloids
             explicit DynamicParticles(const TrajMap &trajs, FileSerie &files, const double &rad=1.0,const double &time_step=1.0);
             explicit DynamicParticles(FileSerie &files, const double &rad=1.0, const double &time_step=1.0);
             explicit DynamicParticles(const std::string &filename);
+            explicit DynamicParticles(const std::string &filename, const Interval &frames);
 
             //DynamicParticles(Particles *parts,const double &time_step=1);
             /*
@@ -84,6 +85,10 @@ namespace Colloids
             size_t getMaxSimultaneousParticles() const;
             std::vector<size_t> getFrameSizes() const;
 
+            /** frames in memory **/
+            const Interval& getLoadedFrames() const {return loaded;};
+            void setWindow(const Interval &frames);
+
             /** export to various file formats */
             void save(const std::string &filename,const std::string &base_name,const std::string &token,const size_t &t_offset, const size_t &t_size) const;
             void exportToPV(const std::string &filename,const std::vector<std::map<size_t,unsigned char> > &labels,const size_t &stepSize=1) const;
@@ -109,6 +114,7 @@ namespace Colloids
             void setIndex(SpatioTemporalIndex *I) {index.reset(I);}
             template <class ParentSTIndex>
             void sliceIndex(bool force = false);
+            void moveIndex(const size_t &t);
 
             std::vector<size_t> selectSpanning_Enclosed(const TimeBox &b) const;
             std::vector<size_t> selectEnclosed(const BoundingBox &b) const;
@@ -125,6 +131,8 @@ namespace Colloids
             std::vector<double> getSD(const size_t &t, const size_t &halfInterval=1) const;
             std::vector<double> getMSD(const std::vector<size_t> &selection,const size_t &t0,const size_t &t1,const size_t &t3=0) const;
             std::vector<double> getMSD(const size_t &t0,const size_t &t1,const size_t &t3=0) const;
+            template<class Real>
+            std::vector<double> getMSD_packed(const std::vector<size_t> &selection,const size_t &t0,const size_t &t1,const size_t &t3=0) const;
             std::vector<double> getNonGaussian(const std::vector<size_t> &selection, const size_t &t0,const size_t &t1,const size_t &t3=0) const;
             void get_MSD_NGP(const std::vector<size_t> &selection, std::vector<double> &MSD, std::vector<double> &NGP, const size_t &t0, const size_t &t1, const size_t &t3=0) const;
             std::vector<double> getISF(const std::vector<size_t> &selection,const Coord &q,const size_t &t0,const size_t &t1) const;
@@ -134,10 +142,18 @@ namespace Colloids
             std::vector<double> getSelfISF(const size_t &t0,const size_t &t1,const size_t &t3=0) const;
             void makeDynamics(std::vector<double> &MSD, std::vector<double> &ISF, std::vector<double> &NGP) const;
             void makeDynamics(std::vector<double> &MSD, std::vector<std::vector<double> >&ISF, std::vector<double> &NGP) const;
-            void makeDynamics(const std::vector< std::vector<size_t> >&sets,std::vector< std::vector<double> > &MSD, std::vector< std::vector<double> > &ISF, std::vector< std::vector<double> > &NGP) const;
-            void exportDynamics(const std::string &inputPath) const;
-            void exportDynamics(const std::vector< std::vector<size_t> >&sets,const std::vector<std::string>&setsNames,const std::string &inputPath) const;
+            void makeDynamics(const std::vector< std::vector<size_t> >&sets,std::vector< std::vector<double> > &MSD, std::vector< std::vector<double> > &ISF, std::vector< std::vector<double> > &NGP, const bool cageRelative=false) const;
+            void exportDynamics(const std::string &inputPath, const bool cageRelative=false) const;
+            void exportDynamics(const std::vector< std::vector<size_t> >&sets,const std::vector<std::string>&setsNames,const std::string &inputPath, const bool cageRelative=false) const;
+            bool getCageDiff(const size_t &tr, const size_t &t0, const size_t &t1, double *diff) const;
+            void cageDisplacements(double *out, const std::vector<size_t> &selection, const size_t &t0, const size_t &t1) const;
+            void get_cage_MSD_NGP_ISF(const std::vector<size_t> &selection, std::vector<double> &MSD, std::vector<double> &NGP, std::vector< std::vector<double> > &ISF, const size_t &t0, const size_t &t1) const;
             std::vector<Coord> velocities(const size_t &t, const size_t &halfInterval=1) const;
+            /** \brief how the displacement of a particle at time t is estimated from its trajectory */
+            enum DisplacementScheme {centred, forward, fitted};
+            size_t getNbPositions(const size_t &t0, const size_t &t1) const;
+            template<typename T>
+            void displacements(T *out, const size_t &t0, const size_t &t1, const size_t &halfInterval=1, const DisplacementScheme scheme=centred) const;
 
             std::vector<size_t> getLostNgbs(const size_t &tr,const size_t &t_from,const size_t &t_to) const;
             std::vector<double> getNbLostNgbs(const size_t &t, const size_t &halfInterval=1) const;
@@ -169,8 +185,15 @@ namespace Colloids
                 std::vector< std::map<size_t, tvmet::Vector<double, N> > > &timeAveraged
             ) const;*/
         private:
+            /** \brief files to load the positions from on demand. Null if the positions were not read from files */
+            std::auto_ptr<FileSerie> frameFiles;
+            /** \brief time steps whose positions are in memory. The other time steps are empty */
+            Interval loaded;
+
             void fill(FileSerie &files);
-            void link();
+            void open(const std::string &filename, const Interval &frames);
+            void load(FileSerie &files, const std::vector<size_t> &steps);
+            void link();
 
     };
 
@@ -215,6 +238,70 @@ namespace Colloids
                     );
     }
 
+    /** @brief Displacements per time step of every position of the frames t0 to t1 (excluded), in a flat array
+      *
+      * \param out Caller allocated array of 3*getNbPositions(t0, t1) values. Frames follow each other, positions are in the order of each frame.
+      * \param halfInterval The displacement at t is estimated between t-halfInterval and t+halfInterval
+      * \param scheme centred : difference between the ends of the interval, clamped to the trajectory.
+      * forward : difference between t and t+2*halfInterval, shifted backward near the end of the trajectory.
+      * fitted : least square slope of the positions over the interval.
+      * Trajectories of a single time step have a null displacement.
+      */
+    template<typename T>
+    void DynamicParticles::displacements(T *out, const size_t &t0, const size_t &t1, const size_t &halfInterval, const DisplacementScheme scheme) const
+    {
+        if(t1 > getNbTimeSteps() || t0 > t1)
+            throw std::out_of_range("DynamicParticles::displacements: invalid frame range");
+        std::vector<size_t> offsets(1, 0);
+        for(size_t t=t0; t<t1; ++t)
+            offsets.push_back(offsets.back() + 3*trajectories.getInverse(t).size());
+
+        #pragma omp parallel
+        for(size_t t=t0; t<t1; ++t)
+        {
+            const std::vector<size_t> &inverse = trajectories.getInverse(t);
+            T *o = out + offsets[t-t0];
+            #pragma omp for schedule(static) nowait
+            for(int p=0; p<(int)inverse.size(); ++p)
+            {
+                const Traj &tr = trajectories[inverse[p]];
+                double d[3] = {0.0, 0.0, 0.0};
+                if(tr.steps.size()>1)
+                {
+                    size_t start = std::max(t, tr.start_time+halfInterval) - halfInterval,
+                        stop = std::min(t+halfInterval, tr.last_time());
+                    if(scheme == forward)
+                    {
+                        stop = std::min(t+2*halfInterval, tr.last_time());
+                        start = std::max(stop, tr.start_time+2*halfInterval) - 2*halfInterval;
+                    }
+                    if(scheme == fitted && stop > start+1)
+                    {
+                        //least square slope, time centred on the middle of the interval
+                        const double mid = 0.5*(start+stop);
+                        double den = 0.0;
+                        for(size_t u=start; u<=stop; ++u)
+                        {
+                            const Coord &x = positions[u][tr[u]];
+                            for(size_t i=0; i<3; ++i)
+                                d[i] += (u-mid) * x[i];
+                            den += (u-mid) * (u-mid);
+                        }
+                        for(size_t i=0; i<3; ++i)
+                            d[i] /= den;
+                    }
+                    else if(stop > start)
+                    {
+                        const Coord &a = positions[start][tr[start]], &b = positions[stop][tr[stop]];
+                        for(size_t i=0; i<3; ++i)
+                            d[i] = (b[i] - a[i]) / (stop-start);
+                    }
+                }
+                std::copy(d, d+3, o + 3*p);
+            }
+        }
+    }
+
     /** @brief Average over time a time dependant and trajectory dependant value.
       *
       * \param selection The trajectories to treat
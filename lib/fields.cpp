@@ -41,6 +41,18 @@ ostream & Colloids::operator<<(std::ostream &os, const ScalarField &s)
 	return os;
 }
 
+/** @brief write as vtk legacy format  */
+ostream & Colloids::operator<<(std::ostream &os, const Field<float> &s)
+{
+	os<<"SCALARS "<< s.name<<" float\n"
+			"LOOKUP_TABLE default\n";
+	copy(
+		s.values.begin(), s.values.end(),
+		ostream_iterator<float>(os,"\n")
+		);
+	return os;
+}
+
 /** @brief write as vtk legacy format  */
 ostream & Colloids::operator<<(std::ostream &os, const VectorField &v)
 {
@@ -52,38 +52,72 @@ namespace Colloids
     typedef Field<Coord>	                		VectorField;
 
     std::ostream& operator<< (std::ostream& os, const ScalarField &s);
+    std::ostream& operator<< (std::ostream& os, const Field<float> &s);
 	std::ostream& operator<< (std::ostream& os, const VectorField &s);
 
+	/** \brief name of a value type in vtk legacy format */
+	template<typename T> inline const char* vtkType();
+	template<> inline const char* vtkType<double>() {return "double";}
+	template<> inline const char* vtkType<float>() {return "float";}
+
+	/** \brief write n 3D vectors stored contiguously as vtk legacy format */
+	template<typename T>
+	std::ostream& toVTKvectors(std::ostream& os, const std::string &name, const T* first, const size_t &n)
+	{
+		os<<"VECTORS "<<name<<" "<<vtkType<T>()<<"\n";
+		for(size_t p=0; p<n; ++p, first+=3)
+			os<<first[0]<<" "<<first[1]<<" "<<first[2]<<" \n";
+		return os;
+	}
+
+    /** \brief	Type used to accumulate values of type V. Single precision values are summed in double precision. */
+    template<typename V>
+    struct Accumulator
+    {
+    	typedef V type;
+    };
+    template<>
+    struct Accumulator<float>
+    {
+    	typedef double type;
+    };
+
     /**	\brief	Contains data averaged over a given interval
 
-		Averaging is made by forward scheme.
+		Averaging is made by centred scheme over averaging/2 frames on each side.
 		Values are defined for all the range of the input,
-		but the averaging interval vanishes when approaching the upper bound.
+		but the averaging interval vanishes when approaching the bounds.
+
+		Running sums are kept per trajectory and updated by adding the incoming frame and removing the frame leaving the window,
+		so the cost of a frame does not depend on the averaging interval.
+		The trajectory index is NOT copied and must outlive the field.
     */
     template<typename V>
     class DynamicField
     {
+    	typedef typename Accumulator<V>::type A;
+
     	boost::ptr_vector< std::vector<V> > values;
-    	std::deque< std::vector<size_t> > divisors;
-    	const TrajIndex trajectories;
+    	const TrajIndex *trajectories;
     	size_t averaging, actual_time;
+    	/** \brief sum and number of the non null values of each trajectory inside the window */
+    	std::vector<A> sums;
+    	std::vector<size_t> counts;
+    	/** \brief the input frames inside the window, in a ring */
+    	std::vector< std::vector<V> > ring;
 
     	public:
 			std::string name;
 
 			DynamicField(const TrajIndex &ti, const size_t &averaging, const std::string &name="") :
-				values(ti.nbFrames()), trajectories(ti), averaging(averaging), actual_time(0), name(name)
+				values(ti.nbFrames()), trajectories(&ti), averaging(averaging), actual_time(0),
+				sums(ti.size(), A(getNull())), counts(ti.size(), 0), ring(2*(averaging/2)+1), name(name)
 			{
 				for(size_t t=0; t<ti.nbFrames(); ++t)
 					this->values.push_back(new std::vector<V>(ti.getInverse(t).size(), getNull()));
-				for(size_t t=0; t<(averaging/2)+1 && t<ti.nbFrames(); ++t)
-					divisors.push_back(std::vector<size_t>(ti.getInverse(t).size(), 0));
 			};
 			DynamicField(const TrajIndex &ti, boost::ptr_vector< std::vector<V> > &values, const std::string &name="")
-				: trajectories(ti), name(name) {this->values.swap(values);};
-			DynamicField(const DynamicField &d)
-				: values(d.values), divisors(d.divisors), trajectories(d.trajectories),
-				averaging(d.averaging), actual_time(d.actual_time), name(d.name) {};
+				: trajectories(&ti), averaging(0), actual_time(values.size()), name(name) {this->values.swap(values);};
 
 			void push_back(const Field<V> &frame);
 			void assign(boost::ptr_vector< std::vector<V> > &values){this->values.swap(values);};
@@ -94,6 +128,7 @@ namespace Colloids
 			static bool isNull(const V& v);
     };
     typedef DynamicField<double>	ScalarDynamicField;
+    typedef DynamicField<float>		FloatDynamicField;
     typedef DynamicField<Coord>		VectorDynamicField;
 
     /**	\brief	create a view of the content of an existing container */
@@ -116,49 +151,78 @@ namespace Colloids
 	template<class V>
 	void DynamicField<V>::push_back(const Field<V> &frame)
 	{
-		if(averaging/2 ==0)
-			std::copy(frame.values.begin(), frame.values.end(), values[actual_time].begin());
-		else
+		if(actual_time >= values.size())
+			throw std::out_of_range("DynamicField: more frames than in the trajectory index");
+		const size_t half = averaging/2, u = actual_time;
+		const std::vector<size_t> &inverse = trajectories->getInverse(u);
+		if(frame.size() != inverse.size())
+			throw std::invalid_argument("DynamicField: the frame size differs from the number of positions");
+		std::vector<V> &slot = ring[u % ring.size()];
+		//the frame u-2*half-1 leaves the window. It occupies the slot of the incoming frame.
+		const bool leaving = u > 2*half;
+		const std::vector<size_t> &leavingInverse = trajectories->getInverse(leaving ? u-2*half-1 : u);
+		//frames to output: the frame centred on u, and all the remaining frames if u is the last one
+		const size_t first = std::max(u, half) - half, last = (u+1 == values.size()) ? u : first;
+		const bool output = u >= half || u+1 == values.size();
+
+		#pragma omp parallel
 		{
-			//bin the values at actual time in the next "average interval" time steps (including actual)
-			const size_t t0 = std::max(actual_time,averaging/2)-averaging/2;
-			for(size_t t=t0; t<std::min(actual_time+(averaging/2)+1, values.size()); ++t)
+			//within a frame, each position belongs to a different trajectory, so no race condition
+			if(leaving)
 			{
-				#pragma omp parallel for schedule(runtime)
-				for(int p=0; p<(int)trajectories.getInverse(t).size();++p)
-				{
-					const Traj& tr = trajectories[trajectories.getInverse(t)[p]];
-					if(tr.exist(actual_time) && !isNull(frame[tr[actual_time]]))
+				#pragma omp for schedule(static)
+				for(int p=0; p<(int)slot.size(); ++p)
+					if(!isNull(slot[p]))
 					{
-						values[t][p] += frame[tr[actual_time]];
-						divisors[t-t0][p]++;
+						const size_t tr = leavingInverse[p];
+						sums[tr] -= slot[p];
+						if(--counts[tr] == 0)
+							sums[tr] = A(getNull());
 					}
-				}
 			}
+			#pragma omp single
+			slot.resize(inverse.size(), getNull());
 
-			//the time step "average interval" ago is totally binned. We divide it.
-			if(actual_time >= averaging/2)
+			#pragma omp for schedule(static)
+			for(int p=0; p<(int)inverse.size(); ++p)
 			{
-				size_t front = actual_time - averaging/2;
-				do
+				slot[p] = frame[p];
+				if(!isNull(slot[p]))
 				{
-					#pragma omp parallel for schedule(runtime)
-					for(int p=0; p<(int)values[front].size(); ++p)
-						values[front][p] /= (double)std::max((size_t)1,divisors.front()[p]);
-
-					divisors.pop_front(); //discard the divisors of the time step we just output
-					front++;
+					sums[inverse[p]] += slot[p];
+					counts[inverse[p]]++;
 				}
-				//if at the end, we divide the remaining times
-				while(actual_time+1 == values.size() && front<values.size());
 			}
 
-			//averaging on less and less time steps on the upper boundary
-			if(1+actual_time + averaging/2 < values.size())
-				divisors.push_back(std::vector<size_t>(trajectories.getInverse(1+actual_time+averaging/2).size()));
+			for(size_t t=first; output && t<=last; ++t)
+			{
+				//at the end, the window shrinks: remove the frame before it
+				if(t > first && t > half)
+				{
+					const std::vector<V> &old = ring[(t-half-1) % ring.size()];
+					const std::vector<size_t> &oldInverse = trajectories->getInverse(t-half-1);
+					#pragma omp for schedule(static)
+					for(int p=0; p<(int)old.size(); ++p)
+						if(!isNull(old[p]))
+						{
+							const size_t tr = oldInverse[p];
+							sums[tr] -= old[p];
+							if(--counts[tr] == 0)
+								sums[tr] = A(getNull());
+						}
+				}
+				const std::vector<size_t> &outInverse = trajectories->getInverse(t);
+				#pragma omp for schedule(static)
+				for(int p=0; p<(int)outInverse.size(); ++p)
+				{
+					const size_t tr = outInverse[p];
+					values[t][p] = sums[tr];
+					if(counts[tr] > 1)
+						values[t][p] /= (double)counts[tr];
+				}
+			}
 		}
 		actual_time++;
-
 	}
 	/** @brief return a view of the field at frame t in terms of positions, not trajectories  */
 	template<class V>
@@ -183,6 +247,20 @@ namespace Colloids
 		return 0.0;
 	}
 
+	/** @brief return true if the value is zero or very close to zero, with the same threshold as the double precision fields*/
+	template<>
+	inline bool Colloids::FloatDynamicField::isNull(const float& v)
+	{
+		return 1.0+(double)v*v == 1.0;
+	}
+
+	/** @brief return null value (0.0) */
+	template<>
+	inline float Colloids::FloatDynamicField::getNull()
+	{
+		return 0.0f;
+	}
+
 	/** @brief return true if the value is zero or very close to zero*/
 	template<>
 	inline bool Colloids::VectorDynamicField::isNull(const Coord& v)
@@ -0,0 +1,355 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "frameAnalysis.hpp"
+#include "instrument.hpp"
+
+#include <deque>
+#include <fstream>
+
+using namespace std;
+using namespace Colloids;
+
+namespace {
+	const char* productNames[FrameAnalysis::nbProducts] = {"index", "bonds", "rdf", "qlm", "surf_qlm", "cg_qlm", "cna", "clusters", "voronoi"};
+	const char* productTimers[FrameAnalysis::nbProducts] = {"analysis.index", "analysis.bonds", "analysis.rdf", "analysis.qlm", "analysis.surf_qlm", "analysis.cg_qlm", "analysis.cna", "analysis.clusters", "analysis.voronoi"};
+
+	/** \brief the products and all the products they depend on */
+	FrameAnalysis::Products closure(FrameAnalysis::Products products)
+	{
+		FrameAnalysis::Products previous;
+		while(previous != products)
+		{
+			previous = products;
+			for(size_t p=0; p<FrameAnalysis::nbProducts; ++p)
+				if(previous[p])
+					products |= FrameAnalysis::dependencies((FrameAnalysis::Product)p);
+		}
+		return products;
+	}
+}
+
+/** @brief Constructor. The particles are modified by the analyses (index and neighbour list) */
+FrameAnalysis::FrameAnalysis(Particles &parts, const Options &options) : parts(parts), options(options), loaded(false), jointBoo(false)
+{
+	if(parts.hasIndex())
+		available.set(index);
+}
+
+/** @brief products a product is computed from */
+FrameAnalysis::Products FrameAnalysis::dependencies(const Product p)
+{
+	Products d;
+	switch(p)
+	{
+		case bonds:
+		case rdf:
+			d.set(index);
+			break;
+		case qlm:
+		case surf_qlm:
+		case cna:
+			d.set(bonds);
+			break;
+		case cg_qlm:
+			d.set(qlm);
+			d.set(bonds);
+			break;
+		case clusters:
+			d.set(cg_qlm);
+			d.set(bonds);
+			break;
+		default:
+			break;
+	}
+	return d;
+}
+
+/** @brief product from its name */
+FrameAnalysis::Product FrameAnalysis::parseProduct(const std::string &name)
+{
+	for(size_t p=0; p<nbProducts; ++p)
+		if(name == productNames[p])
+			return (Product)p;
+	throw invalid_argument("Unknown product "+name);
+}
+
+const char* FrameAnalysis::productName(const Product p)
+{
+	return productNames[p];
+}
+
+/** @brief compute the required products and their dependencies, freeing the intermediates as soon as possible */
+void FrameAnalysis::run()
+{
+	Instrument::Timer timer("analysis");
+	const Products needed = closure(required);
+	if(needed[voronoi])
+		throw invalid_argument("The Voronoi tessellation needs voro++. Use cgVoro.");
+
+	//loading the bonds from file does not need the spatial index
+	Products prerequisites[nbProducts];
+	for(size_t p=0; p<nbProducts; ++p)
+		prerequisites[p] = dependencies((Product)p);
+	if(needed[bonds] && !available[bonds] && !options.bondsFile.empty() && ifstream(options.bondsFile.c_str()).good())
+	{
+		loaded = true;
+		prerequisites[bonds].reset();
+	}
+	//qlm and surf_qlm are computed together
+	Products pending = needed & ~available;
+	jointBoo = pending[qlm] && pending[surf_qlm];
+	if(jointBoo)
+		pending.reset(surf_qlm);
+	Products used = required;
+	for(size_t p=0; p<nbProducts; ++p)
+		if(pending[p])
+			used |= prerequisites[p];
+	if(!used[index] && !required[index])
+		pending.reset(index);
+
+	//the spatial index and the neighbour list are read from the cache instead of built, if it matches
+	const bool useCache = !options.cacheFile.empty() && (pending[index] || (pending[bonds] && !loaded));
+	if(useCache && parts.loadCache(options.cacheFile, options.cacheKey))
+	{
+		if(parts.hasIndex() && (pending[index] || available[index]))
+		{
+			fromCache.set(index);
+			if(pending[index])
+			{
+				available.set(index);
+				computed.set(index);
+				pending.reset(index);
+			}
+		}
+		if(parts.hasNgbList() && pending[bonds] && !loaded)
+			fromCache.set(bonds);
+		else if(parts.hasNgbList() && !available[bonds])
+			parts.delNgbList();
+	}
+	bool toCache = false;
+
+	while(pending.any())
+	{
+		vector<Product> ready;
+		for(size_t p=0; p<nbProducts; ++p)
+			if(pending[p] && (prerequisites[p] & ~available).none())
+				ready.push_back((Product)p);
+		if(ready.empty())
+			throw logic_error("FrameAnalysis: circular dependency");
+
+		//one product after the other, so that the loops inside each product use all the threads
+		for(size_t i=0; i<ready.size(); ++i)
+			compute(ready[i]);
+		for(size_t i=0; i<ready.size(); ++i)
+		{
+			toCache = toCache || ready[i]==index || (ready[i]==bonds && !loaded && !fromCache[bonds]);
+			available.set(ready[i]);
+			computed.set(ready[i]);
+			pending.reset(ready[i]);
+		}
+		if(jointBoo && available[qlm])
+		{
+			available.set(surf_qlm);
+			computed.set(surf_qlm);
+		}
+
+		//save the index and the neighbour list once both are built, before they are freed
+		if(useCache && toCache && !pending[index] && !pending[bonds])
+		{
+			try
+			{
+				parts.saveCache(options.cacheFile, options.cacheKey, !loaded);
+			}
+			catch(const exception &e)
+			{
+				cerr<<e.what()<<". The cache is not saved."<<endl;
+			}
+			toCache = false;
+		}
+
+		//free the intermediates computed here that no remaining product depends on
+		Products stillNeeded = required;
+		for(size_t p=0; p<nbProducts; ++p)
+			if(pending[p])
+				stillNeeded |= prerequisites[p];
+		for(size_t p=0; p<nbProducts; ++p)
+			if(computed[p] && available[p] && !stillNeeded[p])
+				release((Product)p);
+	}
+}
+
+/** @brief compute a single product. Its dependencies must be available */
+void FrameAnalysis::compute(const Product p)
+{
+	Instrument::Timer timer(productTimers[p]);
+	switch(p)
+	{
+		case index:
+			parts.makeRTreeIndex();
+			break;
+
+		case bonds:
+		{
+			const double margin = options.bondLength*parts.radius;
+			if(loaded)
+			{
+				parts.makeNgbList(loadBonds(options.bondsFile));
+				inside = parts.selectInside_noindex(margin, options.noZ);
+				secondInside = parts.selectInside_noindex(2.0*margin, options.noZ);
+			}
+			else
+			{
+				if(!fromCache[bonds])
+					parts.makeNgbList(options.bondLength);
+				inside = parts.selectInside(margin, options.noZ);
+				secondInside = parts.selectInside(2.0*margin, options.noZ);
+			}
+			//no particle far enough from the boundaries: consider them all
+			if(inside.empty())
+				for(size_t i=0; i<parts.size(); ++i)
+					inside.push_back(i);
+			if(secondInside.empty())
+				for(size_t i=0; i<parts.size(); ++i)
+					secondInside.push_back(i);
+			break;
+		}
+
+		case rdf:
+			g = parts.getRdf(options.rdfBins, options.rdfRange);
+			break;
+
+		case qlm:
+			if(jointBoo)
+			{
+				parts.getBOOs_SurfBOOs(qlm_raw, qlm_sf);
+				if(inside.size() < parts.size())
+					parts.removeOutside(inside, qlm_sf);
+			}
+			else
+				parts.getBOOs(qlm_raw);
+			if(inside.size() < parts.size())
+				parts.removeOutside(inside, qlm_raw);
+			break;
+
+		case surf_qlm:
+		{
+			vector<BooData> raw;
+			parts.getBOOs_SurfBOOs(raw, qlm_sf);
+			if(inside.size() < parts.size())
+				parts.removeOutside(inside, qlm_sf);
+			break;
+		}
+
+		case cg_qlm:
+			parts.getCgBOOs(secondInside, qlm_raw, qlm_cg);
+			break;
+
+		case cna:
+		{
+			n1551.assign(parts.size(), 0);
+			const BondSet pairs = parts.get1551pairs();
+			for(BondSet::const_iterator b=pairs.begin(); b!=pairs.end(); ++b)
+			{
+				n1551[b->low()]++;
+				n1551[b->high()]++;
+			}
+			break;
+		}
+
+		case clusters:
+		{
+			//connected components of the bond network between the particles above the threshold
+			vector<bool> member(parts.size(), false), visited(parts.size(), false);
+			for(size_t i=0; i<qlm_cg.size(); ++i)
+				member[i] = !qlm_cg[i].isnull() && qlm_cg[i].getQl(6) > options.clusterQ6;
+			members.clear();
+			for(size_t i=0; i<parts.size(); ++i)
+			{
+				if(!member[i] || visited[i])
+					continue;
+				members.push_back(vector<size_t>());
+				deque<size_t> front(1, i);
+				visited[i] = true;
+				while(!front.empty())
+				{
+					const size_t q = front.front();
+					front.pop_front();
+					members.back().push_back(q);
+					for(vector<size_t>::const_iterator n=parts.getNgbList()[q].begin(); n!=parts.getNgbList()[q].end(); ++n)
+						if(member[*n] && !visited[*n])
+						{
+							visited[*n] = true;
+							front.push_back(*n);
+						}
+				}
+				sort(members.back().begin(), members.back().end());
+			}
+			break;
+		}
+
+		default:
+			throw invalid_argument(string("Cannot compute ")+productNames[p]);
+	}
+}
+
+/** @brief free the memory of a product */
+void FrameAnalysis::release(const Product p)
+{
+	switch(p)
+	{
+		case index:
+			parts.setIndex(0);
+			break;
+		case bonds:
+			parts.delNgbList();
+			vector<size_t>().swap(inside);
+			vector<size_t>().swap(secondInside);
+			break;
+		case rdf:
+			vector<double>().swap(g);
+			break;
+		case qlm:
+			vector<BooData>().swap(qlm_raw);
+			break;
+		case surf_qlm:
+			vector<BooData>().swap(qlm_sf);
+			break;
+		case cg_qlm:
+			vector<BooData>().swap(qlm_cg);
+			break;
+		case cna:
+			vector<size_t>().swap(n1551);
+			break;
+		case clusters:
+			vector< vector<size_t> >().swap(members);
+			break;
+		default:
+			break;
+	}
+	available.reset(p);
+}
+
+/** @brief the bonds of the frame, if still available */
+BondSet FrameAnalysis::getBonds() const
+{
+	if(!available[bonds])
+		throw logic_error("FrameAnalysis: the bonds are not available");
+	return parts.getBonds();
+}
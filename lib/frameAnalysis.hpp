@@ -0,0 +1,122 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+
+ * \file frameAnalysis.hpp
+ * \brief Graph of the analyses of a single frame, sharing the spatial index, the bonds and the bond orientational order
+ * \author Mathieu Leocmach
+ * \date 18 October 2026
+ *
+ * The products of the analysis depend on each other:
+ *
+ *   index <- bonds <- qlm <- cg_qlm <- clusters
+ *   index <- rdf      bonds <- surf_qlm
+ *                     bonds <- cna
+ *
+ * The user requires some products. Their dependencies are added, each product is computed once,
+ * and the products that were not required are freed as soon as all the products depending on them are done.
+ * Each product is computed by parallel loops over the particles, so independent products are computed one after the other.
+ */
+
+#ifndef frame_analysis_H
+#define frame_analysis_H
+
+#include "particles.hpp"
+#include "frameCache.hpp"
+
+#include <bitset>
+#include <boost/utility.hpp>
+
+namespace Colloids
+{
+    /** \brief Computes once and shares the analyses of a frame */
+    class FrameAnalysis : boost::noncopyable
+    {
+        public:
+            enum Product {index=0, bonds, rdf, qlm, surf_qlm, cg_qlm, cna, clusters, voronoi, nbProducts};
+            typedef std::bitset<nbProducts> Products;
+
+            /** \brief Parameters of the analyses, in units of the diameter */
+            struct Options
+            {
+                /** \brief maximum bond length */
+                double bondLength;
+                /** \brief number of bins and range of the g(r) */
+                size_t rdfBins;
+                double rdfRange;
+                /** \brief coarse grained Q6 above which a particle belongs to a cluster */
+                double clusterQ6;
+                /** \brief do not consider the boundaries perpendicular to z as walls */
+                bool noZ;
+                /** \brief file to load the bonds from instead of computing them, if it exists */
+                std::string bondsFile;
+                /** \brief file caching the spatial index and the neighbour list, and its key (see frameCache.hpp). No cache if empty */
+                std::string cacheFile;
+                boost::uint64_t cacheKey;
+
+                Options() : bondLength(1.3), rdfBins(200), rdfRange(15.0), clusterQ6(0.25), noZ(false), cacheKey(0) {};
+            };
+
+            explicit FrameAnalysis(Particles &parts, const Options &options=Options());
+
+            void require(const Product p) {required.set(p);};
+            void require(const Products &p) {required |= p;};
+            void run();
+
+            /** \brief products computed and not freed yet */
+            const Products& getAvailable() const {return available;};
+            /** \brief true if the bonds were loaded from file instead of computed */
+            bool bondsLoaded() const {return loaded;};
+            /** \brief true if the spatial index or the neighbour list were read from the cache file */
+            bool cacheUsed() const {return fromCache.any();};
+
+            /** accessors to the products. The BOO are null for the particles too close to the boundaries */
+            const Particles& getParticles() const {return parts;};
+            BondSet getBonds() const;
+            const std::vector<double>& getRdf() const {return g;};
+            const std::vector<BooData>& getQlm() const {return qlm_raw;};
+            const std::vector<BooData>& getSurfQlm() const {return qlm_sf;};
+            const std::vector<BooData>& getCgQlm() const {return qlm_cg;};
+            /** \brief number of 1551 pairs (two bonded particles sharing 5 neighbours in a ring) each particle belongs to */
+            const std::vector<size_t>& getCna() const {return n1551;};
+            /** \brief members of each cluster of connected particles having coarse grained Q6 above the threshold */
+            const std::vector< std::vector<size_t> >& getClusters() const {return members;};
+
+            static Product parseProduct(const std::string &name);
+            static const char* productName(const Product p);
+            static Products dependencies(const Product p);
+
+        private:
+            Particles &parts;
+            const Options options;
+            /** \brief products asked by the user, presently in memory, and computed by this object (the others are not freed) */
+            Products required, available, computed;
+            /** \brief index and bonds read from the cache file */
+            Products fromCache;
+            bool loaded, jointBoo;
+            std::vector<size_t> inside, secondInside;
+            std::vector<double> g;
+            std::vector<BooData> qlm_raw, qlm_sf, qlm_cg;
+            std::vector<size_t> n1551;
+            std::vector< std::vector<size_t> > members;
+
+            void compute(const Product p);
+            void release(const Product p);
+    };
+}
+
+#endif
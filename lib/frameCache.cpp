@@ -0,0 +1,304 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "config.h"
+#include "frameCache.hpp"
+#include "particles.hpp"
+#include "instrument.hpp"
+
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <boost/static_assert.hpp>
+#include <boost/utility.hpp>
+
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace Colloids;
+
+namespace {
+	const char cacheMagic[8] = {'C','O','L','C','A','C','H','E'};
+	const boost::uint32_t cacheVersion = 1;
+	enum CacheSection {index_section=1, ngb_section=2};
+
+	struct CacheHeader
+	{
+		char magic[8];
+		boost::uint32_t version, sections;
+		boost::uint64_t key;
+	};
+	//the sections are written and read as they are in memory, and must stay aligned on 8 bytes
+	BOOST_STATIC_ASSERT(sizeof(CacheHeader) == 24);
+	BOOST_STATIC_ASSERT(sizeof(FrozenRStarIndex_S::Node) % 8 == 0);
+
+	/** \brief read-only content of a whole file, mapped in memory if the system allows it */
+	class FileContent : boost::noncopyable
+	{
+		const char *data;
+		size_t length;
+		void *mapping;
+		vector<char> buffer;
+
+		public:
+			explicit FileContent(const std::string &filename);
+			~FileContent();
+			bool good() const {return !!data;};
+			const char* begin() const {return data;};
+			const char* end() const {return data+length;};
+			size_t size() const {return length;};
+	};
+
+	FileContent::FileContent(const std::string &filename) : data(0), length(0), mapping(0)
+	{
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+		const int fd = open(filename.c_str(), O_RDONLY);
+		if(fd < 0)
+			return;
+		struct stat st;
+		if(!fstat(fd, &st) && st.st_size > 0)
+		{
+			void *m = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(m != MAP_FAILED)
+			{
+				mapping = m;
+				data = static_cast<const char*>(m);
+				length = st.st_size;
+			}
+		}
+		close(fd);
+		if(mapping)
+			return;
+#endif
+		//no mapping: read the file at once
+		ifstream f(filename.c_str(), ios::in | ios::binary);
+		if(!f)
+			return;
+		f.seekg(0, ios::end);
+		buffer.resize((size_t)f.tellg());
+		f.seekg(0);
+		if(buffer.empty() || !f.read(&buffer[0], buffer.size()))
+			return;
+		data = &buffer[0];
+		length = buffer.size();
+	}
+
+	FileContent::~FileContent()
+	{
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+		if(mapping)
+			munmap(mapping, length);
+#endif
+	}
+
+	/** \brief sequential access to the sections of a file in memory, checking the bounds */
+	struct Cursor
+	{
+		const char *pos, *last;
+
+		Cursor(const char *first, const char *last) : pos(first), last(last) {};
+		/** \brief pointer to the next n values, without copy */
+		template<class T>
+		const T* skip(const boost::uint64_t &n)
+		{
+			if(n > (boost::uint64_t)(last-pos)/sizeof(T))
+				throw invalid_argument("truncated cache file");
+			const T* p = reinterpret_cast<const T*>(pos);
+			pos += n*sizeof(T);
+			return p;
+		}
+		template<class T>
+		T read() {return *skip<T>(1);}
+	};
+
+	/** \brief 64 bits Fowler-Noll-Vo (FNV-1a) hash */
+	boost::uint64_t fnv1a(const char *first, const char *last, boost::uint64_t h=14695981039346656037ULL)
+	{
+		for(; first!=last; ++first)
+		{
+			h ^= static_cast<unsigned char>(*first);
+			h *= 1099511628211ULL;
+		}
+		return h;
+	}
+}
+
+/** @brief key of the cache of a frame. Reading the file is much faster than building the index and the neighbours */
+boost::uint64_t Colloids::frameCacheKey(const std::string &coordinatesFile, const double &radius, const double &bondLength)
+{
+	FileContent file(coordinatesFile);
+	if(!file.good())
+		throw invalid_argument("no such file as "+coordinatesFile);
+	boost::uint64_t h = fnv1a(file.begin(), file.end());
+	const double parameters[2] = {radius, bondLength};
+	h = fnv1a(reinterpret_cast<const char*>(parameters), reinterpret_cast<const char*>(parameters+2), h);
+	return fnv1a(reinterpret_cast<const char*>(&cacheVersion), reinterpret_cast<const char*>(&cacheVersion+1), h);
+}
+
+/**
+    @brief Set the spatial index and the neighbour list from a cache file.
+
+    \return false if the file does not exist, was made for another key or is corrupted. Nothing is set in that case.
+    The neighbour list is only set if it was saved, so it may remain to be built.
+*/
+bool Particles::loadCache(const std::string &filename, const boost::uint64_t &key)
+{
+	Instrument::Timer timer("cache.load");
+	FileContent file(filename);
+	if(!file.good() || file.size() < sizeof(CacheHeader))
+	{
+		Instrument::count("cache.misses");
+		return false;
+	}
+	Cursor cursor(file.begin(), file.end());
+	const CacheHeader header = cursor.read<CacheHeader>();
+	if(!equal(cacheMagic, cacheMagic+8, header.magic) || header.version != cacheVersion || header.key != key)
+	{
+		Instrument::count("cache.misses");
+		return false;
+	}
+	auto_ptr<FrozenRStarIndex_S> I;
+	auto_ptr<NgbList> ngb;
+	try
+	{
+		if(header.sections & index_section)
+		{
+			const boost::uint64_t nbNodes = cursor.read<boost::uint64_t>();
+			const double *box = cursor.skip<double>(6);
+			BoundingBox overall;
+			for(size_t d=0; d<3; ++d)
+			{
+				overall.edges[d].first = box[2*d];
+				overall.edges[d].second = box[2*d+1];
+			}
+			const FrozenRStarIndex_S::Node *nodes = cursor.skip<FrozenRStarIndex_S::Node>(nbNodes);
+			for(size_t n=0; n<nbNodes; ++n)
+				if(nodes[n].hasLeaves)
+					for(size_t c=0; c<min((size_t)nodes[n].size, FrozenRStarIndex_S::capacity); ++c)
+						if(nodes[n].child[c] >= size())
+							throw invalid_argument("the cached index refers to missing particles");
+			I.reset(new FrozenRStarIndex_S(nodes, nodes+nbNodes, overall));
+		}
+		if(header.sections & ngb_section)
+		{
+			const boost::uint64_t n = cursor.read<boost::uint64_t>(), nbItems = cursor.read<boost::uint64_t>();
+			if(n != size())
+				throw invalid_argument("the cached neighbour list has a different number of particles");
+			const boost::uint64_t *offsets = cursor.skip<boost::uint64_t>(n+1);
+			const boost::uint32_t *items = cursor.skip<boost::uint32_t>(nbItems);
+			if(offsets[0] || offsets[n] != nbItems)
+				throw invalid_argument("corrupted neighbour list");
+			ngb.reset(new NgbList(n));
+			for(size_t p=0; p<n; ++p)
+			{
+				if(offsets[p+1] < offsets[p] || offsets[p+1] > nbItems)
+					throw invalid_argument("corrupted neighbour list");
+				(*ngb)[p].assign(items+offsets[p], items+offsets[p+1]);
+			}
+			for(boost::uint64_t i=0; i<nbItems; ++i)
+				if(items[i] >= n)
+					throw invalid_argument("the cached neighbour list refers to missing particles");
+		}
+	}
+	catch(const exception &e)
+	{
+		cerr<<filename<<": "<<e.what()<<". Ignoring the cache."<<endl;
+		Instrument::count("cache.misses");
+		return false;
+	}
+	if(I.get())
+		index = I;
+	if(ngb.get())
+		neighboursList = ngb;
+	Instrument::count("cache.hits");
+	return true;
+}
+
+/**
+    @brief Save the spatial index (if frozen) and the neighbour list (if any and asked for) to a cache file.
+
+    The file is written under a temporary name then renamed, so that a concurrent reader never sees it partially written.
+*/
+void Particles::saveCache(const std::string &filename, const boost::uint64_t &key, const bool withNgbList) const
+{
+	Instrument::Timer timer("cache.save");
+	const FrozenRStarIndex_S *frozen = dynamic_cast<const FrozenRStarIndex_S*>(index.get());
+	if(frozen && (frozen->getNbInserted() || frozen->getNodes().empty()))
+		frozen = 0;
+	CacheHeader header;
+	copy(cacheMagic, cacheMagic+8, header.magic);
+	header.version = cacheVersion;
+	header.sections = (frozen ? index_section : 0) | (withNgbList && hasNgbList() ? ngb_section : 0);
+	header.key = key;
+	if(!header.sections)
+		return;
+	if(size() > numeric_limits<boost::uint32_t>::max())
+		throw length_error("too many particles for the cache format");
+
+	const string temporary = filename+".tmp";
+	{
+		ofstream f(temporary.c_str(), ios::out | ios::trunc | ios::binary);
+		if(!f)
+			throw invalid_argument("cannot open "+temporary);
+		f.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		if(frozen)
+		{
+			const boost::uint64_t nbNodes = frozen->getNodes().size();
+			const BoundingBox overall = frozen->getOverallBox();
+			double box[6];
+			for(size_t d=0; d<3; ++d)
+			{
+				box[2*d] = overall.edges[d].first;
+				box[2*d+1] = overall.edges[d].second;
+			}
+			f.write(reinterpret_cast<const char*>(&nbNodes), sizeof(nbNodes));
+			f.write(reinterpret_cast<const char*>(box), sizeof(box));
+			f.write(reinterpret_cast<const char*>(&frozen->getNodes()[0]), nbNodes*sizeof(FrozenRStarIndex_S::Node));
+		}
+		if(header.sections & ngb_section)
+		{
+			const NgbList &ngb = getNgbList();
+			vector<boost::uint64_t> offsets(ngb.size()+1, 0);
+			for(size_t p=0; p<ngb.size(); ++p)
+				offsets[p+1] = offsets[p] + ngb[p].size();
+			vector<boost::uint32_t> items;
+			items.reserve(offsets.back());
+			for(size_t p=0; p<ngb.size(); ++p)
+				items.insert(items.end(), ngb[p].begin(), ngb[p].end());
+			const boost::uint64_t counts[2] = {ngb.size(), items.size()};
+			f.write(reinterpret_cast<const char*>(counts), sizeof(counts));
+			f.write(reinterpret_cast<const char*>(&offsets[0]), offsets.size()*sizeof(boost::uint64_t));
+			if(!items.empty())
+				f.write(reinterpret_cast<const char*>(&items[0]), items.size()*sizeof(boost::uint32_t));
+		}
+		if(!f)
+			throw runtime_error("cannot write "+temporary);
+	}
+	if(rename(temporary.c_str(), filename.c_str()))
+	{
+		remove(temporary.c_str());
+		throw runtime_error("cannot rename "+temporary+" to "+filename);
+	}
+}
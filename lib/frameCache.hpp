@@ -0,0 +1,50 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+
+ * \file frameCache.hpp
+ * \brief Persistent cache of the spatial index and of the neighbour list of a frame
+ * \author Mathieu Leocmach
+ * \date 18 October 2026
+ *
+ * Particles::saveCache writes the frozen spatial index and the neighbour list of a frame to a binary sidecar file,
+ * and Particles::loadCache reads them back instead of building them, if the key stored in the file matches.
+ * The key is a hash of the content of the coordinates file and of the parameters the index and the neighbours depend on,
+ * so that a modified frame or a different bond length invalidates the cache.
+ *
+ * File layout, in the byte order of the machine:
+ *  - the 8 characters "COLCACHE", the format version and the sections present (1: index, 2: neighbours) as 32 bits unsigned integers,
+ *    and the key as a 64 bits unsigned integer;
+ *  - index section: the number of nodes (64 bits), the overall bounding box (6 doubles) and the nodes of the FrozenRStarIndex_S as they are in memory;
+ *  - neighbours section: the number of particles and of neighbours (64 bits), the offsets of the neighbours of each particle (64 bits)
+ *    and the neighbours (32 bits).
+ * All the sections start at a multiple of 8 bytes. The file is mapped in memory when the system allows it.
+ */
+
+#ifndef frame_cache_H
+#define frame_cache_H
+
+#include <string>
+#include <boost/cstdint.hpp>
+
+namespace Colloids
+{
+    /** \brief key of the cache of a frame, from the content of its coordinates file and the build parameters */
+    boost::uint64_t frameCacheKey(const std::string &coordinatesFile, const double &radius, const double &bondLength);
+}
+
+#endif
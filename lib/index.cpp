@@ -19,21 +19,71 @@
 */
 
 #include "index.hpp"
+#include "cpuDispatch.hpp"
+#include <deque>
+#include <cmath>
+#include <stdexcept>
+#include <limits>
 using namespace std;
 using namespace Colloids;
 
 /** @brief Get the indices of the objects contained inside a reduction of the maximum bounding box  */
 vector<size_t> SpatialIndex::getInside(const double &margin, const bool noZ) const
 {
-    BoundingBox insideBox = getOverallBox();
-    for(size_t i=0;i<3-noZ;++i)
-        if(insideBox.edges[i].second-insideBox.edges[i].first>2*margin)
+    //gets the indexes of the particles totally contained inside this volume
+    return (*this)(shrink(getOverallBox(), margin, noZ));
+}
+
+BoundingBox Colloids::shrink(BoundingBox b, const double &margin, const bool noZ)
+{
+    const size_t nd = noZ ? 2 : 3;
+    for(size_t d=0; d<nd; ++d)
+        if(b.edges[d].second - b.edges[d].first > 2*margin)
         {
-            insideBox.edges[i].first  += margin;
-            insideBox.edges[i].second -= margin;
+            b.edges[d].first  += margin;
+            b.edges[d].second -= margin;
         }
-    //gets the indexes of the particles totally contained inside this volume
-    return (*this)(insideBox);
+    return b;
+}
+
+vector<size_t> Colloids::spatialOrder(const std::vector<BoundingBox> &boxes)
+{
+    vector<size_t> order(boxes.size());
+    if(boxes.empty())
+        return order;
+    //extent of the centers
+    double mini[3], maxi[3];
+    for(size_t d=0; d<3; ++d)
+        mini[d] = maxi[d] = boxes.front().edges[d].first + boxes.front().edges[d].second;
+    for(size_t i=0; i<boxes.size(); ++i)
+        for(size_t d=0; d<3; ++d)
+        {
+            const double c = boxes[i].edges[d].first + boxes[i].edges[d].second;
+            mini[d] = min(mini[d], c);
+            maxi[d] = max(maxi[d], c);
+        }
+    const double cells = (double)((1u << curveBits) - 1);
+    double scale[3];
+    for(size_t d=0; d<3; ++d)
+        scale[d] = (maxi[d] > mini[d]) ? cells / (maxi[d] - mini[d]) : 0.0;
+    vector< pair<boost::uint64_t, size_t> > keys(boxes.size());
+    for(size_t i=0; i<boxes.size(); ++i)
+    {
+        boost::uint32_t X[3];
+        for(size_t d=0; d<3; ++d)
+            X[d] = (boost::uint32_t)((boxes[i].edges[d].first + boxes[i].edges[d].second - mini[d]) * scale[d]);
+        keys[i] = make_pair(mortonKey(X), i);
+    }
+    sort(keys.begin(), keys.end());
+    for(size_t i=0; i<keys.size(); ++i)
+        order[i] = keys[i].second;
+    return order;
+}
+
+/** @brief Answer the queries in parallel  */
+QueryResults SpatialIndex::batchQuery(const std::vector<BoundingBox> &queries) const
+{
+    return Colloids::batchQuery(queries, *this);
 }
 
 /** @brief Get objects spanning the whole interval inside the query box  */
@@ -51,15 +101,8 @@ vector<size_t> SpatioTemporalIndex::operator()(const Interval &in) const
 /** @brief Get the indices of the objects spanning the query interval inside a reduction of the maximum bounding box  */
 vector<size_t> SpatioTemporalIndex::getSpanningInside(const Interval &in,const double &margin) const
 {
-    BoundingBox insideBox = getOverallBox();
-    for(size_t i=0;i<3;++i)
-        if(insideBox.edges[i].second-insideBox.edges[i].first>2*margin)
-        {
-            insideBox.edges[i].first  += margin;
-            insideBox.edges[i].second -= margin;
-        }
     //gets the indexes of the particles totally contained inside this volume
-    return (*this)(TimeBox(in,insideBox));
+    return (*this)(TimeBox(in,shrink(getOverallBox(), margin)));
 }
 
 /** @brief Get the indices of the objects spanning the whole interval inside a reduction of the maximum bounding box
@@ -110,10 +153,470 @@ void RStarIndex_S::insert(const size_t &i, const BoundingBox &b)
 /** @brief Get the indices of the objects whose bounding boxes are contained inside the query box */
 vector<size_t> RStarIndex_S::operator()(const BoundingBox &b) const
 {
-    list<size_t> g = tree.Query(RTree::AcceptEnclosing(b), Gatherer()).gathered;
-    g.sort();
-    g.unique();
-    return vector<size_t>(g.begin(), g.end());
+    ArenaScope scope;
+    Gatherer g = tree.Query(RTree::AcceptEnclosing(b), Gatherer());
+    sort(g.gathered.begin(), g.gathered.end());
+    return vector<size_t>(g.gathered.begin(), unique(g.gathered.begin(), g.gathered.end()));
+}
+
+const size_t SpatialIndex::noItem;
+const size_t FrozenRStarIndex_S::capacity;
+const size_t FrozenRStarIndex_S::updatableLeafSize;
+
+/** @brief Copy the structure of a built R*Tree in breadth first order */
+FrozenRStarIndex_S::FrozenRStarIndex_S(const RStarIndex_S::RTree &tree) : leafVolume(0.0)
+{
+    typedef RStarIndex_S::RTree::Node RNode;
+    typedef RStarIndex_S::RTree::Leaf RLeaf;
+    const RNode *root = tree.GetRoot();
+    if(!root)
+        return;
+    overallBox = root->bound;
+    if(tree.GetSize() > numeric_limits<boost::uint32_t>::max())
+        throw length_error("FrozenRStarIndex_S: too many items for 32 bits indices");
+    //the position of a node in the queue is its position in the frozen tree
+    deque<const RNode*> queue(1, root);
+    for(size_t n=0; n<queue.size(); ++n)
+    {
+        const RNode &source = *queue[n];
+        if(source.items.size() > capacity)
+            throw length_error("FrozenRStarIndex_S: a node has more children than the capacity");
+        nodes.push_back(Node());
+        Node &node = nodes.back();
+        node.size = source.items.size();
+        node.hasLeaves = source.hasLeaves;
+        for(size_t c=0; c<node.size; ++c)
+        {
+            setChild(node, c, source.items[c]->bound);
+            if(source.hasLeaves)
+                node.child[c] = static_cast<const RLeaf*>(source.items[c])->leaf;
+            else
+            {
+                node.child[c] = queue.size();
+                queue.push_back(static_cast<const RNode*>(source.items[c]));
+            }
+        }
+    }
+}
+
+namespace {
+    /** \brief Sort the entries along axis and cut them into slabs, recursively, then into groups of at most M entries along the last axis */
+    void tile(vector<size_t> &order, const size_t &first, const size_t &last, const vector<BoundingBox> &boxes, const size_t &axis, const size_t &M, vector<size_t> &ends)
+    {
+        vector< pair<double, size_t> > keys;
+        keys.reserve(last-first);
+        for(size_t i=first; i<last; ++i)
+            keys.push_back(make_pair(boxes[order[i]].edges[axis].first + boxes[order[i]].edges[axis].second, order[i]));
+        sort(keys.begin(), keys.end());
+        for(size_t i=first; i<last; ++i)
+            order[i] = keys[i-first].second;
+        const size_t n = last - first;
+        if(axis == 2)
+        {
+            for(size_t k=0; k<n; k+=M)
+                ends.push_back(first + min(k+M, n));
+            return;
+        }
+        const size_t groups = (n+M-1)/M,
+            slabs = (size_t)ceil(pow((double)groups, 1.0/(3-axis)) - 1e-9),
+            slab = M * ((groups+slabs-1)/slabs);
+        for(size_t k=0; k<n; k+=slab)
+            tile(order, first+k, first+min(k+slab, n), boxes, axis+1, M, ends);
+    }
+}
+
+/**
+    @brief Bulk load the items by Sort-Tile-Recursive packing.
+
+    Full nodes with little overlap are obtained in O(N log N), much faster and with a better query time than
+    inserting the items one by one into a R*Tree. Leaves of leafSize items leave room for update.
+*/
+FrozenRStarIndex_S::FrozenRStarIndex_S(const std::vector<BoundingBox> &items, const size_t &leafSize) : leafVolume(0.0)
+{
+    if(leafSize == 0 || leafSize > capacity)
+        throw invalid_argument("FrozenRStarIndex_S: the leaf size must be between 1 and the capacity");
+    if(items.empty())
+        return;
+    if(items.size() > numeric_limits<boost::uint32_t>::max())
+        throw length_error("FrozenRStarIndex_S: too many items for 32 bits indices");
+    //levels from the leaves to the root. The children of a node index the level below (or the items).
+    vector< vector<Node> > levels;
+    vector<BoundingBox> boxes(items);
+    do
+    {
+        vector<size_t> order(boxes.size()), ends;
+        for(size_t i=0; i<order.size(); ++i)
+            order[i] = i;
+        tile(order, 0, order.size(), boxes, 0, levels.empty() ? leafSize : capacity, ends);
+        //the nodes of the level below are reordered so that siblings are contiguous
+        if(!levels.empty())
+        {
+            vector<Node> below;
+            below.reserve(order.size());
+            for(size_t i=0; i<order.size(); ++i)
+                below.push_back(levels.back()[order[i]]);
+            levels.back().swap(below);
+        }
+        levels.push_back(vector<Node>(ends.size()));
+        vector<BoundingBox> parentBoxes(ends.size());
+        for(size_t g=0, start=0; g<ends.size(); start = ends[g++])
+        {
+            Node &node = levels.back()[g];
+            node.size = ends[g] - start;
+            node.hasLeaves = (levels.size() == 1);
+            parentBoxes[g] = boxes[order[start]];
+            for(size_t c=0; c<node.size; ++c)
+            {
+                const size_t i = node.hasLeaves ? order[start+c] : start+c;
+                setChild(node, c, boxes[order[start+c]]);
+                node.child[c] = i;
+                parentBoxes[g].stretch(boxes[order[start+c]]);
+            }
+        }
+        boxes.swap(parentBoxes);
+    }
+    while(boxes.size() > 1);
+    overallBox = boxes.front();
+
+    //concatenate the levels from the root
+    for(size_t l=levels.size(); l>0; --l)
+    {
+        const size_t offset = nodes.size() + levels[l-1].size();
+        for(size_t n=0; n<levels[l-1].size(); ++n)
+        {
+            nodes.push_back(levels[l-1][n]);
+            if(!nodes.back().hasLeaves)
+                for(size_t c=0; c<nodes.back().size; ++c)
+                    nodes.back().child[c] += offset;
+        }
+    }
+}
+
+/** @brief Copy nodes laid out as by the other constructors */
+FrozenRStarIndex_S::FrozenRStarIndex_S(const Node *first, const Node *last, const BoundingBox &overall) : nodes(first, last), overallBox(overall), leafVolume(0.0)
+{
+    for(vector<Node>::const_iterator n=nodes.begin(); n!=nodes.end(); ++n)
+        if(n->size > capacity || (!n->hasLeaves && count_if(n->child, n->child+n->size, bind2nd(greater_equal<boost::uint32_t>(), nodes.size()))))
+            throw invalid_argument("FrozenRStarIndex_S: corrupted nodes");
+}
+
+/** @brief Copy a child bounding box into the arrays of a node */
+void FrozenRStarIndex_S::setChild(Node &node, const size_t &c, const BoundingBox &b)
+{
+    for(size_t d=0; d<3; ++d)
+    {
+        node.lo[d][c] = b.edges[d].first;
+        node.hi[d][c] = b.edges[d].second;
+    }
+}
+
+namespace {
+    /**
+        \brief Flag the children of a frozen node to visit: the nodes overlapping the query box, or the leaves it encloses.
+        Unlike RStarTree::AcceptOverlapping, the comparisons are not strict, so that no item lying on the boundary of the query is missed.
+    */
+    inline size_t frozenNodeHits_impl(const FrozenRStarIndex_S::Node &node, const double *qlo, const double *qhi, boost::uint32_t *out)
+    {
+        const size_t N = FrozenRStarIndex_S::capacity;
+        unsigned char hit[N];
+        if(node.hasLeaves)
+            for(size_t c=0; c<N; ++c)
+                hit[c] =
+                    (qlo[0] <= node.lo[0][c]) & (node.hi[0][c] <= qhi[0]) &
+                    (qlo[1] <= node.lo[1][c]) & (node.hi[1][c] <= qhi[1]) &
+                    (qlo[2] <= node.lo[2][c]) & (node.hi[2][c] <= qhi[2]);
+        else
+            for(size_t c=0; c<N; ++c)
+                hit[c] =
+                    (node.lo[0][c] <= qhi[0]) & (qlo[0] <= node.hi[0][c]) &
+                    (node.lo[1][c] <= qhi[1]) & (qlo[1] <= node.hi[1][c]) &
+                    (node.lo[2][c] <= qhi[2]) & (qlo[2] <= node.hi[2][c]);
+        size_t nb = 0;
+        for(size_t c=0; c<node.size; ++c)
+        {
+            out[nb] = node.child[c];
+            nb += hit[c];
+        }
+        return nb;
+    }
+    typedef size_t (*FrozenNodeHits)(const FrozenRStarIndex_S::Node&, const double*, const double*, boost::uint32_t*);
+    COLLOIDS_DISPATCH_VARIANTS(size_t, frozenNodeHits, frozenNodeHits_impl,
+        (const FrozenRStarIndex_S::Node &node, const double *qlo, const double *qhi, boost::uint32_t *out),
+        (node, qlo, qhi, out))
+    inline size_t frozenNodeHits(const FrozenRStarIndex_S::Node &node, const double *qlo, const double *qhi, boost::uint32_t *out)
+    {
+        static const FrozenNodeHits f = dispatch<FrozenNodeHits>(
+            frozenNodeHits_generic, frozenNodeHits_sse42, frozenNodeHits_avx2, frozenNodeHits_avx512);
+        return f(node, qlo, qhi, out);
+    }
+}
+
+/** @brief Get the indices of the objects whose bounding boxes are contained inside the query box */
+vector<size_t> FrozenRStarIndex_S::operator()(const BoundingBox &b) const
+{
+    ArenaScope scope;
+    Scratch<size_t>::vector gathered;
+    if(!nodes.empty())
+    {
+        double qlo[3], qhi[3];
+        for(size_t d=0; d<3; ++d)
+        {
+            qlo[d] = b.edges[d].first;
+            qhi[d] = b.edges[d].second;
+        }
+        Scratch<boost::uint32_t>::vector stack(1, 0), hits(capacity);
+        while(!stack.empty())
+        {
+            const Node &node = nodes[stack.back()];
+            stack.pop_back();
+            const size_t nb = frozenNodeHits(node, qlo, qhi, &hits[0]);
+            if(node.hasLeaves)
+                gathered.insert(gathered.end(), hits.begin(), hits.begin()+nb);
+            else
+                stack.insert(stack.end(), hits.begin(), hits.begin()+nb);
+        }
+    }
+    if(inserted.get())
+    {
+        const vector<size_t> more = (*inserted)(b);
+        gathered.insert(gathered.end(), more.begin(), more.end());
+    }
+    sort(gathered.begin(), gathered.end());
+    return vector<size_t>(gathered.begin(), unique(gathered.begin(), gathered.end()));
+}
+
+/** @brief The frozen tree is read only. Newly inserted items are indexed by a separate R*Tree. */
+void FrozenRStarIndex_S::insert(const size_t &i, const BoundingBox &b)
+{
+    if(!inserted.get())
+        inserted.reset(new RStarIndex_S(vector<BoundingBox>()));
+    inserted->insert(i, b);
+}
+
+/** @brief Translate all bounding boxes  */
+void FrozenRStarIndex_S::operator+=(const Coord &v)
+{
+    for(size_t n=0; n<nodes.size(); ++n)
+        for(size_t d=0; d<3; ++d)
+            for(size_t c=0; c<nodes[n].size; ++c)
+            {
+                nodes[n].lo[d][c] += v[d];
+                nodes[n].hi[d][c] += v[d];
+            }
+    if(!nodes.empty())
+        overallBox += v;
+    if(inserted.get())
+        (*inserted) += v;
+}
+
+BoundingBox FrozenRStarIndex_S::getOverallBox() const
+{
+    if(!inserted.get() || !inserted->tree.GetSize())
+    {
+        if(nodes.empty())
+            throw out_of_range("The frozen R*Tree is empty");
+        return overallBox;
+    }
+    if(nodes.empty())
+        return inserted->getOverallBox();
+    BoundingBox b = overallBox;
+    b.stretch(inserted->getOverallBox());
+    return b;
+}
+
+/** @brief Copy a child bounding box out of the arrays of a node */
+BoundingBox FrozenRStarIndex_S::getChild(const Node &node, const size_t &c)
+{
+    BoundingBox b;
+    for(size_t d=0; d<3; ++d)
+    {
+        b.edges[d].first = node.lo[d][c];
+        b.edges[d].second = node.hi[d][c];
+    }
+    return b;
+}
+
+/** @brief Bounding box of a node, as stored in its parent */
+BoundingBox FrozenRStarIndex_S::getBox(const boost::uint32_t &n) const
+{
+    if(n == 0)
+        return overallBox;
+    return getChild(nodes[parents[n].first], parents[n].second);
+}
+
+/**
+    @brief Make the boxes of the nodes fit their children, from the leaves to the root. An empty node keeps its box.
+    \return the sum of the volumes of the leaves
+*/
+double FrozenRStarIndex_S::refit()
+{
+    double volume = 0.0;
+    //children are stored after their parent
+    for(size_t n=nodes.size(); n>0; --n)
+    {
+        const Node &node = nodes[n-1];
+        if(node.size)
+        {
+            BoundingBox b = getChild(node, 0);
+            for(size_t c=1; c<node.size; ++c)
+                b.stretch(getChild(node, c));
+            if(n == 1)
+                overallBox = b;
+            else
+                setChild(nodes[parents[n-1].first], parents[n-1].second, b);
+        }
+        if(node.hasLeaves)
+            volume += getBox(n-1).area();
+    }
+    return volume;
+}
+
+/** @brief Descend from the node n to the leaf whose box is enlarged the least by b, the smallest if several */
+boost::uint32_t FrozenRStarIndex_S::chooseLeaf(boost::uint32_t n, const BoundingBox &b) const
+{
+    while(!nodes[n].hasLeaves)
+    {
+        const Node &node = nodes[n];
+        size_t best = 0;
+        double bestEnlargement = numeric_limits<double>::max(), bestArea = numeric_limits<double>::max();
+        for(size_t c=0; c<node.size; ++c)
+        {
+            BoundingBox box = getChild(node, c);
+            const double area = box.area();
+            box.stretch(b);
+            const double enlargement = box.area() - area;
+            if(enlargement < bestEnlargement || (enlargement == bestEnlargement && area < bestArea))
+            {
+                best = c;
+                bestEnlargement = enlargement;
+                bestArea = area;
+            }
+        }
+        n = node.child[best];
+    }
+    return n;
+}
+
+/** @brief Append the item j to the leaf n */
+void FrozenRStarIndex_S::addChild(const boost::uint32_t &n, const size_t &j, const BoundingBox &b, std::vector<Place> &places)
+{
+    Node &node = nodes[n];
+    setChild(node, node.size, b);
+    node.child[node.size] = j;
+    places[j] = Place(n, node.size++);
+}
+
+/** @brief Remove the child c of the leaf n, the last child taking its slot */
+void FrozenRStarIndex_S::removeChild(const boost::uint32_t &n, const size_t &c, std::vector<Place> &places)
+{
+    Node &node = nodes[n];
+    const size_t last = --node.size;
+    if(c == last)
+        return;
+    for(size_t d=0; d<3; ++d)
+    {
+        node.lo[d][c] = node.lo[d][last];
+        node.hi[d][c] = node.hi[d][last];
+    }
+    node.child[c] = node.child[last];
+    places[node.child[c]] = Place(n, c);
+}
+
+/**
+    @brief Move the items to new boxes, typically from a frame to the next.
+
+    The items that do not fit in a leaf go to the overflow tree, and the next update inserts them again.
+    When the leaves have grown by a quarter of their volume after the bulk loading, or when more than 1/256 of
+    the items overflow, the index is updated but false is returned, as the queries are slowed down.
+*/
+bool FrozenRStarIndex_S::update(const std::vector<size_t> &ids, const std::vector<BoundingBox> &boxes)
+{
+    if(nodes.empty())
+        return false;
+    if(boxes.size() > numeric_limits<boost::uint32_t>::max())
+        throw length_error("FrozenRStarIndex_S: too many items for 32 bits indices");
+    //the items of the overflow tree are not in the leaves, thus inserted anew
+    inserted.reset();
+    if(parents.empty())
+    {
+        parents.assign(nodes.size(), Place(0, 0));
+        for(size_t n=0; n<nodes.size(); ++n)
+            if(!nodes[n].hasLeaves)
+                for(size_t c=0; c<nodes[n].size; ++c)
+                {
+                    if(nodes[n].child[c] <= n)
+                        throw invalid_argument("FrozenRStarIndex_S: a child is stored before its parent");
+                    parents[nodes[n].child[c]] = Place(n, c);
+                }
+        for(size_t n=0; n<nodes.size(); ++n)
+            if(nodes[n].hasLeaves)
+                leafVolume += getBox(n).area();
+    }
+    //rename the items of the leaves, removing the items that disappear, and locate the new items
+    const Place nowhere(numeric_limits<boost::uint32_t>::max(), 0);
+    vector<Place> places(boxes.size(), nowhere);
+    for(size_t n=0; n<nodes.size(); ++n)
+    {
+        Node &node = nodes[n];
+        if(!node.hasLeaves)
+            continue;
+        for(size_t c=node.size; c>0; --c)
+        {
+            if(node.child[c-1] >= ids.size())
+                throw invalid_argument("FrozenRStarIndex_S::update: no new index for an item");
+            const size_t j = ids[node.child[c-1]];
+            if(j == noItem)
+            {
+                //the last child takes the slot, and has already been renamed
+                node.size--;
+                for(size_t d=0; d<3; ++d)
+                {
+                    node.lo[d][c-1] = node.lo[d][node.size];
+                    node.hi[d][c-1] = node.hi[d][node.size];
+                }
+                node.child[c-1] = node.child[node.size];
+                continue;
+            }
+            if(j >= boxes.size())
+                throw invalid_argument("FrozenRStarIndex_S::update: new index out of range");
+            node.child[c-1] = j;
+        }
+        for(size_t c=0; c<node.size; ++c)
+        {
+            if(places[node.child[c]] != nowhere)
+                throw invalid_argument("FrozenRStarIndex_S::update: two items have the same new index");
+            places[node.child[c]] = Place(n, c);
+        }
+    }
+    //the boxes of the nodes are the ones of the previous frame until the refit
+    for(size_t j=0; j<boxes.size(); ++j)
+    {
+        if(places[j] == nowhere)
+        {
+            //did not exist before
+            const boost::uint32_t leaf = chooseLeaf(0, boxes[j]);
+            if(nodes[leaf].size == capacity)
+                insert(j, boxes[j]);
+            else
+                addChild(leaf, j, boxes[j], places);
+            continue;
+        }
+        const Place from = places[j];
+        setChild(nodes[from.first], from.second, boxes[j]);
+        if(getBox(from.first).encloses(boxes[j]))
+            continue;
+        //reinsert below the lowest ancestor containing the new box, if there is room
+        boost::uint32_t a = parents[from.first].first;
+        while(a != 0 && !getBox(a).encloses(boxes[j]))
+            a = parents[a].first;
+        const boost::uint32_t leaf = chooseLeaf(a, boxes[j]);
+        if(leaf != from.first && nodes[leaf].size < capacity)
+        {
+            removeChild(from.first, from.second, places);
+            addChild(leaf, j, boxes[j], places);
+        }
+    }
+    return refit() <= 1.25 * leafVolume && 256 * getNbInserted() <= boxes.size();
 }
 
 /** @brief insertion  */
@@ -28,14 +28,17 @@
 #include "config.h"
 
 #include "RStarTree/RStarTree.h"
+#include "arena.hpp"
 
 #include <boost/ptr_container/ptr_container.hpp>
+#include <boost/cstdint.hpp>
 
 #include <vector>
 #include <valarray>
 #include <set>
 #include <map>
 #include <algorithm>
+#include <memory>
 
 //define by a macro all the constructors
 #define INDEX_CONSTRUCTOR(Index, BoundingItem)\
@@ -75,6 +78,116 @@ namespace Colloids
     typedef std::pair<size_t,size_t>            Interval;
     typedef std::pair<Interval, BoundingBox>    TimeBox;
 
+    /** \brief number of bits per dimension of the keys along the space filling curves */
+    const int curveBits = 21;
+
+    /** \brief spread the 21 lowest bits of x, leaving two zeros between each */
+    inline boost::uint64_t spreadBits(boost::uint64_t x)
+    {
+        x &= 0x1fffffULL;
+        x = (x | x << 32) & 0x1f00000000ffffULL;
+        x = (x | x << 16) & 0x1f0000ff0000ffULL;
+        x = (x | x << 8) & 0x100f00f00f00f00fULL;
+        x = (x | x << 4) & 0x10c30c30c30c30c3ULL;
+        x = (x | x << 2) & 0x1249249249249249ULL;
+        return x;
+    }
+
+    /** \brief position along the Z-order curve, the first coordinate having the strongest bits */
+    inline boost::uint64_t mortonKey(const boost::uint32_t X[3])
+    {
+        return spreadBits(X[0]) << 2 | spreadBits(X[1]) << 1 | spreadBits(X[2]);
+    }
+
+    /**
+        \brief position along the Hilbert curve.
+        The coordinates are transformed into the transposed Hilbert index, following
+        J. Skilling, AIP Conference Proceedings 707, 381 (2004), then interleaved.
+    */
+    inline boost::uint64_t hilbertKey(const boost::uint32_t coords[3])
+    {
+        boost::uint32_t X[3] = {coords[0], coords[1], coords[2]};
+        const boost::uint32_t M = 1u << (curveBits-1);
+        //inverse undo
+        for(boost::uint32_t Q = M; Q > 1; Q >>= 1)
+        {
+            const boost::uint32_t P = Q - 1;
+            for(int i=0; i<3; ++i)
+                if(X[i] & Q)
+                    X[0] ^= P;
+                else
+                {
+                    const boost::uint32_t t = (X[0] ^ X[i]) & P;
+                    X[0] ^= t;
+                    X[i] ^= t;
+                }
+        }
+        //Gray encode
+        for(int i=1; i<3; ++i)
+            X[i] ^= X[i-1];
+        boost::uint32_t t = 0;
+        for(boost::uint32_t Q = M; Q > 1; Q >>= 1)
+            if(X[2] & Q)
+                t ^= Q - 1;
+        for(int i=0; i<3; ++i)
+            X[i] ^= t;
+        return mortonKey(X);
+    }
+
+    /** \brief order of the boxes along the Z-order curve of their centers */
+    std::vector<size_t> spatialOrder(const std::vector<BoundingBox> &boxes);
+
+    /** \brief the box reduced by a margin on each side, along the dimensions wider than twice the margin */
+    BoundingBox shrink(BoundingBox b, const double &margin, const bool noZ=false);
+
+    /**
+        \brief Results of a batch of spatial queries, in compressed sparse row format.
+        The items found by query q are items[offsets[q]] to items[offsets[q+1]-1], sorted.
+    */
+    struct QueryResults
+    {
+        typedef std::vector<size_t>::const_iterator const_iterator;
+        std::vector<size_t> offsets, items;
+
+        QueryResults() : offsets(1, 0) {};
+        /** \brief number of queries */
+        size_t size() const {return offsets.size()-1;};
+        /** \brief number of items found by query q */
+        size_t size(const size_t &q) const {return offsets[q+1]-offsets[q];};
+        const_iterator begin(const size_t &q) const {return items.begin()+offsets[q];};
+        const_iterator end(const size_t &q) const {return items.begin()+offsets[q+1];};
+        std::vector<size_t> operator[](const size_t &q) const {return std::vector<size_t>(begin(q), end(q));};
+    };
+
+    /**
+        \brief Answer many queries in parallel with a function answering a single query.
+
+        The queries are processed along the Z-order curve of their centers, so that consecutive queries
+        visit the same parts of the index, and are distributed dynamically between the OpenMP threads.
+        The query function must be safe to call concurrently.
+    */
+    template<class Query>
+    QueryResults batchQuery(const std::vector<BoundingBox> &queries, const Query &query)
+    {
+        const std::vector<size_t> order = spatialOrder(queries);
+        std::vector< std::vector<size_t> > found(queries.size());
+        #pragma omp parallel for schedule(dynamic, 16)
+        for(std::ptrdiff_t i=0; i<(std::ptrdiff_t)order.size(); ++i)
+        {
+            std::vector<size_t> f = query(queries[order[i]]);
+            found[order[i]].swap(f);
+        }
+        QueryResults results;
+        results.offsets.resize(queries.size()+1);
+        for(size_t q=0; q<found.size(); ++q)
+            results.offsets[q+1] = results.offsets[q] + found[q].size();
+        results.items.resize(results.offsets.back());
+        #pragma omp parallel for schedule(static)
+        for(std::ptrdiff_t q=0; q<(std::ptrdiff_t)found.size(); ++q)
+            std::copy(found[q].begin(), found[q].end(), results.items.begin()+results.offsets[q]);
+        return results;
+    }
+
     /** \brief A template class defining the common interface of index classes   */
     template<class BoundingItem>
     struct BasicIndex
@@ -85,14 +198,30 @@ namespace Colloids
         virtual std::vector<size_t> operator()(const BoundingItem &b) const = 0;
     };
 
-    /** \brief A virtual class defining the common interface of spatial index classes   */
+    /**
+        \brief A virtual class defining the common interface of spatial index classes
+
+        Once built, an index can be queried concurrently from several threads. Insertions, translations and updates must not
+        run concurrently with anything else.
+    */
     class SpatialIndex : public BasicIndex<BoundingBox>
     {
         public:
+            /** \brief new index of the items that disappear, see update */
+            static const size_t noItem = (size_t)-1;
+
             virtual std::vector<size_t> getInside(const double &margin, const bool noZ=false) const;
+            virtual QueryResults batchQuery(const std::vector<BoundingBox> &queries) const;
             /** @brief Translate index */
             virtual void operator+=(const Coord &v) = 0;
             virtual BoundingBox getOverallBox() const = 0;
+            /**
+                @brief Move the items to new boxes instead of building the index anew.
+                \param ids ids[i] is the new index of the item i, or noItem if it disappears
+                \param boxes boxes[j] is the bounding box of the new item j. The new items that are not in ids are inserted.
+                \return false if the index cannot be updated and has to be built anew. Its content is then undefined.
+            */
+            virtual bool update(const std::vector<size_t> &ids, const std::vector<BoundingBox> &boxes) {return false;};
     };
 
     /** \brief A virtual class defining the common interface of temporal index classes   */
@@ -136,9 +265,9 @@ namespace Colloids
             typedef RStarTree<size_t, 3, 4, 32, double> 	RTree;
             RTree tree;
 
-        /** \brief Visitor gathering particles indices */
+        /** \brief Visitor gathering particles indices in the arena of the calling thread */
         struct Gatherer {
-            std::list<size_t> gathered;
+            Scratch<size_t>::vector gathered;
             bool ContinueVisiting;
 
             Gatherer() : gathered(), ContinueVisiting(true) {};
@@ -155,6 +284,71 @@ namespace Colloids
             BoundingBox getOverallBox() const{return tree.getOverallBox();};
     };
 
+    /**
+        \brief Read-only copy of a built R*Tree, laid out for fast queries.
+
+        The nodes are stored contiguously in breadth first order, so that the children of a node are adjacent.
+        The boxes of the children of a node are stored as structure of arrays (one array of 32 values per bound and per axis)
+        and the overlap tests of a node are done in a single vectorized loop. Children are referred to by 32 bits indices.
+        It can be frozen from a built R*Tree, or bulk loaded from all the items of a static frame.
+        Items inserted afterwards go to a small R*Tree queried alongside.
+
+        The items can be moved in place by update, for example from a frame to the next.
+        The box of an item is overwritten in its leaf. An item leaving the box of its leaf is reinserted below the
+        lowest ancestor still containing it, then the boxes of the nodes are refitted from the leaves up.
+        The leaves of a bulk loaded index can be left partly empty to make room for the items moving in.
+        When the leaves have grown by a quarter of their volume after the bulk loading, or when the items that
+        do not fit in the leaves go beyond a few per thousand, update asks for a rebuild.
+    */
+    class FrozenRStarIndex_S : public SpatialIndex
+    {
+        public:
+            static const size_t capacity = 32;
+            /** \brief items per leaf of a bulk loaded index meant to be updated, leaving room for the items moving in */
+            static const size_t updatableLeafSize = 3*capacity/4;
+            struct Node
+            {
+                double lo[3][capacity], hi[3][capacity];
+                /** \brief index of the child nodes, or of the items if hasLeaves */
+                boost::uint32_t child[capacity];
+                boost::uint32_t size, hasLeaves;
+            };
+
+            explicit FrozenRStarIndex_S(const RStarIndex_S::RTree &tree);
+            explicit FrozenRStarIndex_S(const std::vector<BoundingBox> &items, const size_t &leafSize=capacity);
+            /** \brief from the nodes of another frozen index, for example read from a cache file */
+            FrozenRStarIndex_S(const Node *first, const Node *last, const BoundingBox &overall);
+            void insert(const size_t &i, const BoundingBox &b);
+            std::vector<size_t> operator()(const BoundingBox &b) const;
+            void operator+=(const Coord &v);
+            BoundingBox getOverallBox() const;
+            bool update(const std::vector<size_t> &ids, const std::vector<BoundingBox> &boxes);
+            size_t getNbNodes() const {return nodes.size();};
+            const std::vector<Node>& getNodes() const {return nodes;};
+            /** \brief number of items inserted after freezing, that are not in the nodes */
+            size_t getNbInserted() const {return inserted.get() ? inserted->tree.GetSize() : 0;};
+
+        private:
+            /** \brief (node, slot) of a child in the nodes */
+            typedef std::pair<boost::uint32_t, boost::uint32_t> Place;
+
+            std::vector<Node> nodes;
+            BoundingBox overallBox;
+            std::auto_ptr<RStarIndex_S> inserted;
+            /** \brief place of each node in its parent. Made by the first update */
+            std::vector<Place> parents;
+            /** \brief sum of the volumes of the leaves before the first update */
+            double leafVolume;
+
+            static void setChild(Node &node, const size_t &c, const BoundingBox &b);
+            static BoundingBox getChild(const Node &node, const size_t &c);
+            BoundingBox getBox(const boost::uint32_t &n) const;
+            double refit();
+            boost::uint32_t chooseLeaf(boost::uint32_t n, const BoundingBox &b) const;
+            void addChild(const boost::uint32_t &n, const size_t &j, const BoundingBox &b, std::vector<Place> &places);
+            void removeChild(const boost::uint32_t &n, const size_t &c, std::vector<Place> &places);
+    };
+
     /** \brief simple tree implementation of temporal index */
     class TreeIndex_T : public TemporalIndex
     {
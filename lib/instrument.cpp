@@ -0,0 +1,290 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "instrument.hpp"
+
+#include <map>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <boost/unordered_map.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+using namespace Colloids;
+
+bool Instrument::active = false;
+
+namespace
+{
+    enum Kind {timerKind=0, counterKind=1, gaugeKind=2};
+
+    struct Stat
+    {
+        Kind kind;
+        double calls, total, minimum, maximum, last;
+        Stat() : kind(timerKind), calls(0), total(0), minimum(numeric_limits<double>::max()), maximum(-numeric_limits<double>::max()), last(0){};
+        void add(const double &v)
+        {
+            calls++;
+            total += v;
+            last = v;
+            if(v<minimum) minimum = v;
+            if(v>maximum) maximum = v;
+        }
+        void merge(const Stat &s)
+        {
+            kind = s.kind;
+            calls += s.calls;
+            total += s.total;
+            last = s.last;
+            if(s.minimum<minimum) minimum = s.minimum;
+            if(s.maximum>maximum) maximum = s.maximum;
+        }
+    };
+
+    /** \brief statistics of one thread, keyed by the address of the name */
+    typedef boost::unordered_map<const char*, Stat> Slot;
+
+    /** \brief maximum number of threads having their own slot. Other threads share a slot under a critical section. */
+    const size_t nbSlots = 256;
+
+    /**
+        \brief Statistics of all threads.
+
+        Each OpenMP thread writes in its own slot, so no synchronisation is needed while measuring.
+        The slots are merged by name when the report is written, at exit.
+    */
+    struct Registry
+    {
+        vector<Slot*> slots;
+        Slot shared;
+        string reportFile, tool;
+        double start;
+
+        Registry() : slots(nbSlots, (Slot*)0), start(Instrument::now())
+        {
+            const char *file = getenv("COLLOIDS_REPORT");
+            if(file && *file)
+            {
+                reportFile = file;
+                Instrument::active = true;
+            }
+        }
+        ~Registry()
+        {
+            if(Instrument::active && !reportFile.empty())
+                Instrument::writeReport();
+            for(size_t i=0; i<slots.size(); ++i)
+                delete slots[i];
+        }
+        map<string, Stat> merge() const
+        {
+            map<string, Stat> all;
+            for(size_t i=0; i<=slots.size(); ++i)
+            {
+                const Slot *s = (i<slots.size()) ? slots[i] : &shared;
+                if(s)
+                    for(Slot::const_iterator it=s->begin(); it!=s->end(); ++it)
+                        all[it->first].merge(it->second);
+            }
+            return all;
+        }
+    };
+
+    Registry registry;
+
+    /** \brief slot of the calling thread, keyed like frameArena(). nbSlots (the shared slot) under nested active parallelism. */
+    size_t threadId()
+    {
+#ifdef _OPENMP
+        if(omp_get_active_level() > 1)
+            return nbSlots;
+        //inside an inactive nested region, omp_get_thread_num() is 0 for all the threads
+        for(int l=omp_get_level(); l>0; --l)
+            if(omp_get_team_size(l) > 1)
+                return omp_get_ancestor_thread_num(l);
+#endif
+        return 0;
+    }
+
+    void record(const char *name, const Kind kind, const double &v)
+    {
+        const size_t id = threadId();
+        if(id < nbSlots)
+        {
+            Slot *&s = registry.slots[id];
+            if(!s)
+            {
+                //the pointer of this slot is only ever written by this thread
+                s = new Slot();
+            }
+            Stat &st = (*s)[name];
+            st.kind = kind;
+            st.add(v);
+        }
+        else
+        {
+            #pragma omp critical(instrument_shared)
+            {
+                Stat &st = registry.shared[name];
+                st.kind = kind;
+                st.add(v);
+            }
+        }
+    }
+
+    /** \brief escape a name for a JSON string */
+    string quote(const string &s)
+    {
+        string q("\"");
+        for(size_t i=0; i<s.size(); ++i)
+        {
+            if(s[i]=='"' || s[i]=='\\')
+                q.push_back('\\');
+            q.push_back(s[i]);
+        }
+        q.push_back('"');
+        return q;
+    }
+}
+
+/** @brief start recording and write the report to the given file at exit */
+void Instrument::enable(const std::string &reportFile)
+{
+    registry.reportFile = reportFile;
+    active = true;
+}
+
+/** @brief stop recording. Nothing will be written at exit unless enabled again. */
+void Instrument::disable()
+{
+    active = false;
+}
+
+/** @brief name of the tool written in the report */
+void Instrument::setToolName(const std::string &name)
+{
+    registry.tool = name;
+}
+
+/** @brief wall clock in seconds */
+double Instrument::now()
+{
+#ifdef _OPENMP
+    return omp_get_wtime();
+#else
+    return (boost::posix_time::microsec_clock::universal_time() - boost::posix_time::ptime(boost::gregorian::date(2000,1,1))).total_microseconds() * 1e-6;
+#endif
+}
+
+void Instrument::addTime(const char *name, const double &seconds)
+{
+    record(name, timerKind, seconds);
+}
+
+void Instrument::addCount(const char *name, const double &n)
+{
+    record(name, counterKind, n);
+}
+
+void Instrument::setGauge(const char *name, const double &value)
+{
+    record(name, gaugeKind, value);
+}
+
+/** @brief Report as a JSON object with timers, counters and gauges sub-objects */
+void Instrument::writeJSON(std::ostream &os)
+{
+    const map<string, Stat> all = registry.merge();
+    const char *kinds[3] = {"timers", "counters", "gauges"};
+    os << "{\n\t\"tool\": " << quote(registry.tool) << ",\n";
+#ifdef _OPENMP
+    os << "\t\"threads\": " << omp_get_max_threads() << ",\n";
+#else
+    os << "\t\"threads\": 1,\n";
+#endif
+    os << "\t\"wall\": " << now() - registry.start;
+    for(int k=0; k<3; ++k)
+    {
+        os << ",\n\t\"" << kinds[k] << "\": {";
+        bool first = true;
+        for(map<string, Stat>::const_iterator it=all.begin(); it!=all.end(); ++it)
+        {
+            if(it->second.kind != k)
+                continue;
+            os << (first ? "\n" : ",\n") << "\t\t" << quote(it->first) << ": ";
+            first = false;
+            const Stat &s = it->second;
+            switch(k)
+            {
+            case timerKind:
+                os << "{\"calls\": " << s.calls << ", \"total\": " << s.total << ", \"min\": " << s.minimum << ", \"max\": " << s.maximum << "}";
+                break;
+            case counterKind:
+                os << s.total;
+                break;
+            case gaugeKind:
+                os << "{\"last\": " << s.last << ", \"max\": " << s.maximum << "}";
+                break;
+            }
+        }
+        os << "\n\t}";
+    }
+    os << "\n}" << endl;
+}
+
+/** @brief Report as CSV, one line per measure */
+void Instrument::writeCSV(std::ostream &os)
+{
+    const map<string, Stat> all = registry.merge();
+    const char *kinds[3] = {"timer", "counter", "gauge"};
+    os << "tool,kind,name,calls,total,min,max,last" << endl;
+    os << registry.tool << ",timer,wall,1," << now() - registry.start << ",,," << endl;
+    for(map<string, Stat>::const_iterator it=all.begin(); it!=all.end(); ++it)
+    {
+        const Stat &s = it->second;
+        os << registry.tool << "," << kinds[s.kind] << "," << it->first << "," << s.calls << "," << s.total << ","
+            << s.minimum << "," << s.maximum << "," << s.last << endl;
+    }
+}
+
+/** @brief Write the report to the file given by COLLOIDS_REPORT or enable(). The format is CSV if the name ends in .csv, JSON otherwise. */
+void Instrument::writeReport()
+{
+    const string &file = registry.reportFile;
+    if(file.empty())
+        return;
+    ofstream out(file.c_str());
+    if(!out.good())
+    {
+        cerr << "Cannot write the instrumentation report to " << file << endl;
+        return;
+    }
+    if(file.size()>4 && file.substr(file.size()-4)==".csv")
+        writeCSV(out);
+    else
+        writeJSON(out);
+}
@@ -0,0 +1,93 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+
+ * \file instrument.hpp
+ * \brief Timers, counters and gauges to know where the time goes
+ * \author Mathieu Leocmach
+ * \date 18 October 2026
+ *
+ * Instrumentation is off by default. It is switched on by setting the environment variable COLLOIDS_REPORT
+ * to the name of the report file, ending in .json or .csv. The report is written when the program exits.
+ * When off, each instrumentation point costs a test on a global boolean.
+ */
+
+#ifndef instrument_H
+#define instrument_H
+
+#include <string>
+#include <ostream>
+
+namespace Colloids
+{
+    namespace Instrument
+    {
+        /** \brief true when the measures are recorded */
+        extern bool active;
+
+        void enable(const std::string &reportFile);
+        void disable();
+        void setToolName(const std::string &name);
+
+        double now();
+        /** \brief names must be string literals: they are identified by their address */
+        void addTime(const char *name, const double &seconds);
+        void addCount(const char *name, const double &n);
+        void setGauge(const char *name, const double &value);
+
+        void writeJSON(std::ostream &os);
+        void writeCSV(std::ostream &os);
+        void writeReport();
+
+        /** \brief add 1 (or n) to a counter */
+        inline void count(const char *name, const double &n=1.0)
+        {
+            if(active)
+                addCount(name, n);
+        }
+
+        /** \brief record the last and the maximum value of a quantity */
+        inline void gauge(const char *name, const double &value)
+        {
+            if(active)
+                setGauge(name, value);
+        }
+
+        /** \brief measure the wall time spent in a scope */
+        class Timer
+        {
+            public:
+                explicit Timer(const char *name) : name(name), start(active ? now() : 0.0){};
+                ~Timer(){stop();};
+                /** \brief record before the end of the scope */
+                void stop()
+                {
+                    if(active && name)
+                        addTime(name, now()-start);
+                    name = 0;
+                };
+
+            private:
+                const char *name;
+                double start;
+                Timer(const Timer&);
+                Timer& operator=(const Timer&);
+        };
+    }
+}
+
+#endif
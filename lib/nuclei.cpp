@@ -0,0 +1,262 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "nuclei.hpp"
+#include "instrument.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+using namespace Colloids;
+
+namespace {
+	size_t findRoot(vector<size_t> &root, size_t p)
+	{
+		while(root[p] != p)
+		{
+			root[p] = root[root[p]];
+			p = root[p];
+		}
+		return p;
+	}
+
+	/** \brief the root of the smallest index becomes the root of both */
+	void unite(vector<size_t> &root, const size_t &p, const size_t &q)
+	{
+		const size_t a = findRoot(root, p), b = findRoot(root, q);
+		root[max(a, b)] = min(a, b);
+	}
+
+	/** \brief larger overlap first */
+	bool largerOverlap(const pair<size_t, size_t> &a, const pair<size_t, size_t> &b)
+	{
+		return a.first > b.first;
+	}
+}
+
+const size_t NucleusFinder::noNucleus;
+
+/** @brief Constructor. Connect the particles and find the nuclei.
+  *
+  * \param parts The particles, with their neighbour list
+  * \param qlm The BOO of the particles, null where they are not defined (near the boundaries)
+  */
+NucleusFinder::NucleusFinder(const Particles &parts, const std::vector<BooData> &qlm, const Options &options) :
+	options(options), nbSolid(0)
+{
+	if(!parts.hasNgbList())
+		throw invalid_argument("NucleusFinder: make the neighbour list first");
+	if(qlm.size() != parts.size())
+		throw invalid_argument("NucleusFinder: one BOO per particle is needed");
+	connect(parts, qlm);
+	cluster(parts);
+}
+
+/** @brief normalised q6 product along each bond and number of connections of each particle */
+void NucleusFinder::connect(const Particles &parts, const std::vector<BooData> &qlm)
+{
+	Instrument::Timer timer("nuclei.connections");
+	const NgbList &ngb = parts.getNgbList();
+	offsets.assign(ngb.size()+1, 0);
+	for(size_t p=0; p<ngb.size(); ++p)
+		offsets[p+1] = offsets[p] + ngb[p].size();
+	products.assign(offsets.back(), 0.0);
+	connections.assign(ngb.size(), 0);
+
+	#pragma omp parallel for schedule(dynamic, 256) reduction(+:nbSolid)
+	for(ptrdiff_t p=0; p<(ptrdiff_t)ngb.size(); ++p)
+	{
+		if(qlm[p].isnull())
+			continue;
+		size_t c = 0;
+		for(size_t n=0; n<ngb[p].size(); ++n)
+		{
+			const size_t q = ngb[p][n];
+			if(qlm[q].isnull())
+				continue;
+			const double prod = qlm[p].normedProduct(qlm[q], 6);
+			products[offsets[p]+n] = prod;
+			//false for the NaN of the particles without bond
+			if(prod > options.threshold)
+				c++;
+		}
+		connections[p] = c;
+		if(c >= options.minConnections)
+			nbSolid++;
+	}
+	Instrument::count("nuclei.bonds", offsets.back());
+}
+
+/** @brief connected components of the bond network between solid-like particles */
+void NucleusFinder::cluster(const Particles &parts)
+{
+	Instrument::Timer timer("nuclei.clusters");
+	const NgbList &ngb = parts.getNgbList();
+	const size_t n = ngb.size();
+	vector<size_t> root(n);
+	for(size_t p=0; p<n; ++p)
+		root[p] = p;
+
+	//each thread unites the bonds inside its range, the roots staying in the range, and keeps the bonds between ranges
+	vector< vector<Bond> > across;
+	#pragma omp parallel
+	{
+		size_t nbThreads = 1, thread = 0;
+#ifdef _OPENMP
+		nbThreads = omp_get_num_threads();
+		thread = omp_get_thread_num();
+#endif
+		#pragma omp single
+		across.resize(nbThreads);
+		const size_t first = (n*thread)/nbThreads, last = (n*(thread+1))/nbThreads;
+		for(size_t p=first; p<last; ++p)
+			if(isSolid(p))
+				for(vector<size_t>::const_iterator q=ngb[p].begin(); q!=ngb[p].end(); ++q)
+					if(*q > p && isSolid(*q))
+					{
+						if(*q < last)
+							unite(root, p, *q);
+						else
+							across[thread].push_back(Bond(p, *q));
+					}
+	}
+	size_t nbAcross = 0;
+	for(size_t t=0; t<across.size(); ++t)
+	{
+		for(vector<Bond>::const_iterator b=across[t].begin(); b!=across[t].end(); ++b)
+			unite(root, b->low(), b->high());
+		nbAcross += across[t].size();
+	}
+	Instrument::count("nuclei.bonds_across_threads", nbAcross);
+
+	//the root of a nucleus is its first member, so the nuclei are numbered in the order of their first member
+	labels.assign(n, noNucleus);
+	nuclei.clear();
+	for(size_t p=0; p<n; ++p)
+	{
+		if(!isSolid(p))
+			continue;
+		const size_t r = findRoot(root, p);
+		if(r == p)
+		{
+			labels[p] = nuclei.size();
+			nuclei.push_back(vector<size_t>());
+		}
+		else
+			labels[p] = labels[r];
+		nuclei[labels[p]].push_back(p);
+	}
+	Instrument::count("nuclei.nuclei", nuclei.size());
+}
+
+/** @brief number of members of the largest nucleus, 0 if there is no solid-like particle */
+size_t NucleusFinder::getLargest() const
+{
+	size_t largest = 0;
+	for(size_t k=0; k<nuclei.size(); ++k)
+		largest = max(largest, nuclei[k].size());
+	return largest;
+}
+
+/** @brief number of nuclei of each size, from 0 to the size of the largest */
+std::vector<size_t> NucleusFinder::getSizeDistribution() const
+{
+	vector<size_t> distribution(getLargest()+1, 0);
+	for(size_t k=0; k<nuclei.size(); ++k)
+		distribution[nuclei[k].size()]++;
+	return distribution;
+}
+
+/** @brief Constructor
+  *
+  * \param first The time step in the trajectory index of the first frame to be pushed
+  */
+NucleusTracker::NucleusTracker(const TrajIndex &trajectories, const size_t &first) :
+	trajectories(trajectories), first(first), t(0), nbIds(0)
+{
+	if(trajectories.nbFrames()==0)
+		throw invalid_argument("NucleusTracker: make the inverse of the trajectory index first");
+}
+
+/** @brief Identify the nuclei of the next frame with the nuclei of the previous frame.
+  *
+  * \param nuclei The members of each nucleus, in position indices
+  * \return The identity of each nucleus
+  */
+const std::vector<size_t>& NucleusTracker::push_back(const std::vector< std::vector<size_t> > &nuclei)
+{
+	if(first + t >= trajectories.nbFrames())
+		throw out_of_range("NucleusTracker: more frames than in the trajectory index");
+	const vector<size_t> &inverse = trajectories.getInverse(first + t);
+
+	//the identity of the previous frame sharing the most trajectories with each nucleus, ties going to the oldest
+	vector< pair<size_t, size_t> > claims;
+	vector<size_t> previousIds;
+	ids.assign(nuclei.size(), 0);
+	for(size_t k=0; k<nuclei.size(); ++k)
+	{
+		previousIds.clear();
+		for(vector<size_t>::const_iterator p=nuclei[k].begin(); p!=nuclei[k].end(); ++p)
+		{
+			boost::unordered_map<size_t, size_t>::const_iterator it = previous.find(inverse.at(*p));
+			if(it != previous.end())
+				previousIds.push_back(it->second);
+		}
+		sort(previousIds.begin(), previousIds.end());
+		size_t best = 0;
+		for(size_t i=0; i<previousIds.size(); )
+		{
+			const size_t j = upper_bound(previousIds.begin()+i, previousIds.end(), previousIds[i]) - previousIds.begin();
+			if(j-i > best)
+			{
+				best = j-i;
+				ids[k] = previousIds[i];
+			}
+			i = j;
+		}
+		if(best)
+			claims.push_back(make_pair(best, k));
+	}
+
+	//the largest overlap keeps the identity, the other parts of a split nucleus are new
+	vector<bool> isNew(nuclei.size(), true);
+	stable_sort(claims.begin(), claims.end(), largerOverlap);
+	vector<bool> taken(nbIds, false);
+	for(size_t c=0; c<claims.size(); ++c)
+		if(!taken[ids[claims[c].second]])
+		{
+			taken[ids[claims[c].second]] = true;
+			isNew[claims[c].second] = false;
+		}
+	for(size_t k=0; k<nuclei.size(); ++k)
+		if(isNew[k])
+			ids[k] = nbIds++;
+
+	previous.clear();
+	for(size_t k=0; k<nuclei.size(); ++k)
+		for(vector<size_t>::const_iterator p=nuclei[k].begin(); p!=nuclei[k].end(); ++p)
+			previous[inverse.at(*p)] = ids[k];
+	t++;
+	return ids;
+}
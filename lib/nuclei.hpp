@@ -0,0 +1,118 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+
+ * \file nuclei.hpp
+ * \brief Crystal nuclei of a frame, after ten Wolde, Ruiz-Montero and Frenkel, and their history along the trajectories
+ * \author Mathieu Leocmach
+ * \date 18 October 2026
+ *
+ * Two bonded particles are connected when the normalised product of their q6m is above a threshold.
+ * A particle having enough connections is solid-like, and the nuclei are the connected components of the
+ * bond network between the solid-like particles.
+ *
+ * The products are computed for each entry of the neighbour list and stored along it in compressed sparse row format.
+ * The connected components are found by union-find, each thread uniting the bonds inside its own range of particles,
+ * the bonds between ranges being united afterwards.
+ */
+
+#ifndef nuclei_H
+#define nuclei_H
+
+#include "particles.hpp"
+#include "traj.hpp"
+
+#include <boost/unordered_map.hpp>
+
+namespace Colloids
+{
+    /** \brief Solid-like particles and crystal nuclei of a frame */
+    class NucleusFinder
+    {
+        public:
+            /** \brief Parameters of the ten Wolde criterion */
+            struct Options
+            {
+                /** \brief normalised q6 product above which two bonded particles are connected */
+                double threshold;
+                /** \brief number of connections from which a particle is solid-like */
+                size_t minConnections;
+
+                Options() : threshold(0.7), minConnections(7) {};
+            };
+            /** \brief label of the particles that do not belong to any nucleus */
+            static const size_t noNucleus = (size_t)-1;
+
+            NucleusFinder(const Particles &parts, const std::vector<BooData> &qlm, const Options &options=Options());
+
+            /** \brief normalised q6 product of the neighbour n of p is getProducts()[getOffsets()[p]+n] */
+            const std::vector<size_t>& getOffsets() const {return offsets;};
+            const std::vector<double>& getProducts() const {return products;};
+            const std::vector<size_t>& getConnections() const {return connections;};
+            bool isSolid(const size_t &p) const {return connections[p] >= options.minConnections;};
+            size_t getNbSolid() const {return nbSolid;};
+            /** \brief nucleus of each particle, noNucleus for the liquid-like particles */
+            const std::vector<size_t>& getLabels() const {return labels;};
+            /** \brief members of each nucleus, sorted. The nuclei are sorted by their first member */
+            const std::vector< std::vector<size_t> >& getNuclei() const {return nuclei;};
+            size_t getLargest() const;
+            /** \brief number of nuclei of each size */
+            std::vector<size_t> getSizeDistribution() const;
+
+        private:
+            const Options options;
+            size_t nbSolid;
+            std::vector<size_t> offsets, connections, labels;
+            std::vector<double> products;
+            std::vector< std::vector<size_t> > nuclei;
+
+            void connect(const Particles &parts, const std::vector<BooData> &qlm);
+            void cluster(const Particles &parts);
+    };
+
+    /**
+        \brief Follow the nuclei frame after frame.
+
+        A nucleus keeps the identity of the nucleus of the previous frame with which it shares the most trajectories.
+        When a nucleus splits, the largest part keeps the identity and the others get new ones.
+    */
+    class NucleusTracker
+    {
+        public:
+            explicit NucleusTracker(const TrajIndex &trajectories, const size_t &first=0);
+
+            const std::vector<size_t>& push_back(const std::vector< std::vector<size_t> > &nuclei);
+
+            /** \brief number of frames already processed */
+            size_t size() const {return t;};
+            /** \brief number of identities given so far */
+            size_t getNbIds() const {return nbIds;};
+            /** \brief identity of each nucleus of the last frame */
+            const std::vector<size_t>& getIds() const {return ids;};
+
+        private:
+            const TrajIndex &trajectories;
+            /** \brief time step in the trajectory index of the first frame */
+            const size_t first;
+            size_t t, nbIds;
+            /** \brief identity of the nucleus of each trajectory in the last frame */
+            boost::unordered_map<size_t, size_t> previous;
+            std::vector<size_t> ids;
+    };
+}
+
+#endif
@@ -18,6 +18,9 @@
 **/
 
 #include "particles.hpp"
+#include "instrument.hpp"
+#include "cpuDispatch.hpp"
+#include <boost/cstdint.hpp>
 //#include <boost/progress.hpp>
 
 using namespace std;
@@ -83,9 +86,93 @@ void Particles::push_back(const Coord &p)
 {
     if(hasIndex())
         index->insert(size(),bounds(p));
+    if(!originalIds.empty())
+        originalIds.push_back(originalIds.size());
     vector<Coord>::push_back(p);
 }
 
+/** @brief Reorder the particles along a space filling curve, so that neighbours in space are close in memory.
+  *
+  * The neighbour-heavy passes (neighbour list, BOO, RDF, common neighbours) then access memory almost sequentially.
+  * The permutation is kept: getOriginalId, toOriginalOrder and toOriginalIds map the indices and the per-particle outputs back,
+  * and restoreOrder puts the positions back. The spatial index and the neighbour list are dropped, since they refer to the old indices.
+  * For trajectories, the original index of the position of trajectory tr at time t is positions[t].getOriginalId(trajectories[tr][t]).
+  */
+void Particles::sortSpatially(const SpaceFillingCurve &curve)
+{
+    if(empty())
+        return;
+    //extent of the positions
+    Coord mini = front(), maxi = front();
+    for(const_iterator p=begin(); p!=end(); ++p)
+        for(size_t d=0; d<3; ++d)
+        {
+            mini[d] = min(mini[d], (*p)[d]);
+            maxi[d] = max(maxi[d], (*p)[d]);
+        }
+    const double cells = (double)((1u << curveBits) - 1);
+    double scale[3];
+    for(size_t d=0; d<3; ++d)
+        scale[d] = (maxi[d] > mini[d]) ? cells / (maxi[d] - mini[d]) : 0.0;
+
+    vector< pair<boost::uint64_t, size_t> > keys(size());
+    #pragma omp parallel for schedule(static)
+    for(ssize_t p=0; p<(ssize_t)size(); ++p)
+    {
+        boost::uint32_t X[3];
+        for(size_t d=0; d<3; ++d)
+            X[d] = (boost::uint32_t)(((*this)[p][d] - mini[d]) * scale[d]);
+        keys[p] = make_pair((curve == hilbert) ? hilbertKey(X) : mortonKey(X), (size_t)p);
+    }
+    sort(keys.begin(), keys.end());
+
+    vector<Coord> sorted(size());
+    vector<size_t> ids(size());
+    for(size_t p=0; p<size(); ++p)
+    {
+        sorted[p] = (*this)[keys[p].second];
+        ids[p] = getOriginalId(keys[p].second);
+    }
+    vector<Coord>::swap(sorted);
+    originalIds.swap(ids);
+    index.reset();
+    neighboursList.reset();
+}
+
+/** @brief Put back the particles in the order preceding sortSpatially. The spatial index and the neighbour list are dropped. */
+void Particles::restoreOrder()
+{
+    if(originalIds.empty())
+        return;
+    vector<Coord> original(*this);
+    toOriginalOrder(original);
+    vector<Coord>::swap(original);
+    originalIds.clear();
+    index.reset();
+    neighboursList.reset();
+}
+
+/** @brief replace indices of particles by their value before sortSpatially */
+void Particles::toOriginalIds(std::vector<size_t> &indices) const
+{
+    if(originalIds.empty())
+        return;
+    for(size_t i=0; i<indices.size(); ++i)
+        indices[i] = originalIds[indices[i]];
+}
+
+/** @brief express bonds in terms of the indices of the particles before sortSpatially */
+BondSet Particles::toOriginalIds(const BondSet &bonds) const
+{
+    if(originalIds.empty())
+        return bonds;
+    vector<Bond> original;
+    original.reserve(bonds.size());
+    for(BondSet::const_iterator b=bonds.begin(); b!=bonds.end(); ++b)
+        original.push_back(Bond(originalIds[b->low()], originalIds[b->high()]));
+    return BondSet(original.begin(), original.end());
+}
+
 /** @brief return a copy with no particle closer than sep.
     First in first served
     The copy is indexed by a R*Tree
@@ -208,15 +295,55 @@ BoundingBox Particles::bounds(const Coord &center,const double &r)
 	return bb;
 }
 
-/** @brief make a RTree spatial index for the present particles set  */
-void Particles::makeRTreeIndex()
+/** @brief make a RTree spatial index for the present particles set, frozen for fast queries. See FrozenRStarIndex_S for the leaf size.  */
+void Particles::makeRTreeIndex(const size_t &leafSize)
 {
+    Instrument::Timer timer("index");
     vector<BoundingBox> boxes;
     boxes.reserve(this->size());
     for(const_iterator p = this->begin(); p!=this->end();++p)
         boxes.push_back(bounds(*p));
 
-    setIndex(new RStarIndex_S(boxes));
+    setIndex(new FrozenRStarIndex_S(boxes, leafSize));
+}
+
+/** @brief update the spatial index after the particles moved, or make it if the index cannot follow  */
+void Particles::updateIndex()
+{
+    vector<size_t> ids(this->size());
+    for(size_t p=0; p<ids.size(); ++p)
+        ids[p] = p;
+    moveIndex(*this, ids);
+}
+
+/**
+    @brief give the spatial index to the next frame, updated to its positions, instead of making it anew
+
+    If the index cannot follow, next gets a new index with room in its leaves for the next updates.
+
+    \param next The particles the index goes to
+    \param ids ids[p] is the index in next of the particle p, or SpatialIndex::noItem if it disappears
+*/
+void Particles::moveIndex(Particles &next, const std::vector<size_t> &ids)
+{
+    if(!this->hasIndex())
+    {
+        next.makeRTreeIndex(FrozenRStarIndex_S::updatableLeafSize);
+        return;
+    }
+    if(&next != this)
+        next.index = this->index;
+    bool updated;
+    {
+        Instrument::Timer timer("index.update");
+        vector<BoundingBox> boxes;
+        boxes.reserve(next.size());
+        for(const_iterator p = next.begin(); p!=next.end();++p)
+            boxes.push_back(bounds(*p));
+        updated = next.index->update(ids, boxes);
+    }
+    if(!updated)
+        next.makeRTreeIndex(FrozenRStarIndex_S::updatableLeafSize);
 }
 
 /** @brief getOverallBox  */
@@ -267,6 +394,97 @@ vector<size_t> Particles::getEuclidianNeighbours(const size_t &center, const dou
     return NormTwoNeighbours;
 }
 
+namespace {
+    /** \brief a neighbour is closer than range to the center */
+    struct CloserThan
+    {
+        const Particles &parts;
+        const double rSq;
+        CloserThan(const Particles &p, const double &range) : parts(p), rSq(range*range) {};
+        bool operator()(const size_t &center, const size_t &ngb) const
+        {
+            const Coord diff = parts.getDiff(center, ngb);
+            return dot(diff,diff)<rSq;
+        }
+    };
+
+    /** \brief a neighbour is closer than range to the center, the distance being computed in the storage precision */
+    template<class Real>
+    struct PackedCloserThan
+    {
+        const Particles &parts;
+        const PositionArray<Real> &pos;
+        const double rSq;
+        PackedCloserThan(const Particles &p, const PositionArray<Real> &ps, const double &range) : parts(p), pos(ps), rSq(range*range) {};
+        bool operator()(const size_t &center, const size_t &ngb) const
+        {
+            double diff[3];
+            pos.diff(center, ngb, diff);
+            parts.minimumImage(diff);
+            return diff[0]*diff[0] + diff[1]*diff[1] + diff[2]*diff[2] < rSq;
+        }
+    };
+
+    /** \brief keep in each row of ngb the items different from the center and accepted by keep */
+    template<class Keep>
+    void filterRows(QueryResults &ngb, const std::vector<size_t> &centers, const Keep &keep)
+    {
+        //keep the accepted neighbours at the beginning of each row
+        vector<size_t> kept(centers.size());
+        #pragma omp parallel for schedule(dynamic, 64)
+        for(ssize_t c=0; c<(ssize_t)centers.size(); ++c)
+        {
+            size_t out = ngb.offsets[c];
+            for(size_t i=ngb.offsets[c]; i<ngb.offsets[c+1]; ++i)
+                if(ngb.items[i] != centers[c] && keep(centers[c], ngb.items[i]))
+                    ngb.items[out++] = ngb.items[i];
+            kept[c] = out - ngb.offsets[c];
+        }
+        //pack the rows
+        size_t packed = 0;
+        for(size_t c=0; c<centers.size(); ++c)
+        {
+            const size_t start = ngb.offsets[c];
+            copy(ngb.items.begin()+start, ngb.items.begin()+start+kept[c], ngb.items.begin()+packed);
+            ngb.offsets[c] = packed;
+            packed += kept[c];
+        }
+        ngb.offsets.back() = packed;
+        ngb.items.resize(packed);
+    }
+}
+
+/**
+    \brief get the indices of the particles closer than range to each center (Euclidian norm), discarding the centers themselves.
+    The spatial queries and the distance computations are done in parallel.
+*/
+QueryResults Particles::getEuclidianNeighbours(const std::vector<size_t> &centers, const double &range) const
+{
+    vector<BoundingBox> queries(centers.size());
+    for(size_t c=0; c<centers.size(); ++c)
+        queries[c] = bounds((*this)[centers[c]], range);
+    QueryResults ngb = selectEnclosed(queries);
+    filterRows(ngb, centers, CloserThan(*this, range));
+    return ngb;
+}
+
+/**
+    \brief get the indices of the particles closer than range to each center, discarding the centers themselves.
+    The distances are computed from the positions in the storage precision.
+*/
+template<class Real>
+QueryResults Particles::getEuclidianNeighbours(const PositionArray<Real> &pos, const std::vector<size_t> &centers, const double &range) const
+{
+    vector<BoundingBox> queries(centers.size());
+    for(size_t c=0; c<centers.size(); ++c)
+        queries[c] = bounds((*this)[centers[c]], range);
+    QueryResults ngb = selectEnclosed(queries);
+    filterRows(ngb, centers, PackedCloserThan<Real>(*this, pos, range));
+    return ngb;
+}
+template QueryResults Particles::getEuclidianNeighbours<float>(const PositionArray<float>&, const std::vector<size_t>&, const double&) const;
+template QueryResults Particles::getEuclidianNeighbours<double>(const PositionArray<double>&, const std::vector<size_t>&, const double&) const;
+
 /**
     \brief get the index of the particles closer than range to center sorted by Sqare distance to the center (Euclidian norm)
 */
@@ -285,6 +503,31 @@ multimap<double,size_t> Particles::getEuclidianNeighboursBySqDist(const Coord &c
     return NormTwoNeighbours;
 }
 
+/**
+    \brief for each center, get the index of the particles closer than range sorted by Sqare distance (Euclidian norm).
+    The spatial queries and the distance computations are done in parallel.
+*/
+vector< multimap<double,size_t> > Particles::getEuclidianNeighboursBySqDist(const std::vector<Coord> &centers, const double &range) const
+{
+    vector<BoundingBox> queries(centers.size());
+    for(size_t c=0; c<centers.size(); ++c)
+        queries[c] = bounds(centers[c], range);
+    const QueryResults ngb = selectEnclosed(queries);
+
+    vector< multimap<double,size_t> > NormTwoNeighbours(centers.size());
+    const double rSq = range*range;
+    #pragma omp parallel for schedule(dynamic, 64)
+    for(ssize_t c=0; c<(ssize_t)centers.size(); ++c)
+        for(QueryResults::const_iterator q=ngb.begin(c); q!=ngb.end(c); ++q)
+        {
+            const Coord diff = getDiff(centers[c], *q);
+            const double distSq = dot(diff, diff);
+            if(distSq<rSq)
+                NormTwoNeighbours[c].insert(make_pair(distSq, *q));
+        }
+    return NormTwoNeighbours;
+}
+
 /**
     \brief get the index of the closest particle to center (Euclidian norm)
     \param range Guess of the distance to the nearest neighbour
@@ -325,10 +568,17 @@ size_t Particles::getNearestNeighbour(const Coord &center, const double &range)
   */
 NgbList & Particles::makeNgbList(const double &bondLength)
 {
+    Instrument::Timer timer("makeNgbList");
+    Instrument::count("makeNgbList.particles", size());
     this->neighboursList.reset(new NgbList(size()));
     const double sep = 2.0*bondLength*radius;
+    vector<size_t> all(size());
     for(size_t p=0;p<size();++p)
-        (*neighboursList)[p] = getEuclidianNeighbours(p, sep);
+        all[p] = p;
+    const QueryResults ngb = getEuclidianNeighbours(all, sep);
+    #pragma omp parallel for schedule(static)
+    for(ssize_t p=0;p<(ssize_t)size();++p)
+        (*neighboursList)[p].assign(ngb.begin(p), ngb.end(p));
 
     return *this->neighboursList;
 }
@@ -363,10 +613,14 @@ BooData Particles::getBOO(const size_t &center) const
     const size_t nb = ngbList.size();
     if(nb > 0)
     {
-        //sum up the contribution of each neighbour to every spherical harmonic.
-        for(ssize_t p=0; p<(ssize_t)ngbList.size();++p)
-            boo+=sphHarm_OneBond(center,ngbList[p]);
-
+        //gather the bonds and sum up the contribution of each neighbour to every spherical harmonic.
+        vector<double> bonds(3*nb);
+        for(size_t p=0; p<nb; ++p)
+        {
+            const Coord diff = getDiff(center, ngbList[p]);
+            copy(&diff[0], &diff[0]+3, bonds.begin()+3*p);
+        }
+        boo = BooData(&bonds[0], nb);
         boo/=(double)nb;
     }
     return boo;
@@ -395,6 +649,7 @@ BooData Particles::getCgBOO(const std::vector<BooData> &BOO, const size_t &cente
 */
 void Particles::getBOOs(std::vector<BooData> &BOO) const
 {
+    Instrument::Timer timer("getBOOs");
     BOO.resize(size());
     vector<size_t> nbs(size(),0);
     for(size_t p=0;p<getNgbList().size();++p)
@@ -419,6 +674,7 @@ void Particles::getBOOs(std::vector<BooData> &BOO) const
 */
 void Particles::getBOOs(const vector<size_t> &selection, std::vector<BooData> &BOO) const
 {
+    Instrument::Timer timer("getBOOs");
     BOO.resize(size());
     for(ssize_t p=0;p<(ssize_t)selection.size();++p)
         BOO[selection[p]] = getBOO(selection[p]);
@@ -430,16 +686,77 @@ void Particles::getBOOs(const vector<size_t> &selection, std::vector<BooData> &B
 */
 void Particles::getCgBOOs(const vector<size_t> &selection, const std::vector<BooData> &BOO, std::vector<BooData> &cgBOO) const
 {
+    Instrument::Timer timer("getCgBOOs");
     cgBOO.resize(size());
     for(ssize_t p=0;p<(ssize_t)selection.size();++p)
         cgBOO[selection[p]] = getCgBOO(BOO, selection[p]);
 }
 
+/**
+    \brief get the bond orientational order for all particles, stored in the storage precision.
+    The bonds are computed from the positions in the storage precision, the harmonics are summed in double.
+*/
+template<class Real>
+void Particles::getBOOs_packed(BooArray<Real> &BOO) const
+{
+    Instrument::Timer timer("getBOOs");
+    const PositionArray<Real> pos(*this);
+    BOO.assign(size());
+    #pragma omp parallel
+    {
+        vector<double> bonds;
+        #pragma omp for schedule(dynamic, 64)
+        for(ssize_t p=0; p<(ssize_t)size(); ++p)
+        {
+            const vector<size_t> &ngbList = getNgbList()[p];
+            const size_t nb = ngbList.size();
+            if(nb == 0)
+                continue;
+            bonds.resize(3*nb);
+            for(size_t q=0; q<nb; ++q)
+            {
+                pos.diff(p, ngbList[q], &bonds[3*q]);
+                minimumImage(&bonds[3*q]);
+            }
+            BooData boo(&bonds[0], nb);
+            boo /= (double)nb;
+            BOO.set(p, boo);
+        }
+    }
+}
+template void Particles::getBOOs_packed<float>(BooArray<float>&) const;
+template void Particles::getBOOs_packed<double>(BooArray<double>&) const;
+
+/**
+    \brief get the coarse grained bond orientational order of a selection, stored in the storage precision.
+    The qlm of the neighbours are summed in double.
+*/
+template<class Real>
+void Particles::getCgBOOs_packed(const vector<size_t> &selection, const BooArray<Real> &BOO, BooArray<Real> &cgBOO) const
+{
+    Instrument::Timer timer("getCgBOOs");
+    cgBOO.assign(size());
+    #pragma omp parallel for schedule(dynamic, 64)
+    for(ssize_t p=0; p<(ssize_t)selection.size(); ++p)
+    {
+        const vector<size_t> &ngbList = getNgbList()[selection[p]];
+        BooData avBoo;
+        BOO.addTo(selection[p], avBoo);
+        for(size_t q=0; q<ngbList.size(); ++q)
+            BOO.addTo(ngbList[q], avBoo);
+        avBoo /= (double)(1+ngbList.size());
+        cgBOO.set(selection[p], avBoo);
+    }
+}
+template void Particles::getCgBOOs_packed<float>(const vector<size_t>&, const BooArray<float>&, BooArray<float>&) const;
+template void Particles::getCgBOOs_packed<double>(const vector<size_t>&, const BooArray<double>&, BooArray<double>&) const;
+
 /**
     \brief get the bond orientational order including surface bonds for all particles
 */
 void Particles::getSurfBOOs(std::vector<BooData> &BOO) const
 {
+    Instrument::Timer timer("getSurfBOOs");
     BOO.resize(size());
     vector<size_t> nbs(size(),0);
     for(size_t p=0;p<getNgbList().size();++p)
@@ -475,6 +792,7 @@ void Particles::getSurfBOOs(std::vector<BooData> &BOO) const
 
 void Particles::getBOOs_SurfBOOs(std::vector<BooData> &BOO, std::vector<BooData> &surfBOO) const
 {
+    Instrument::Timer timer("getBOOs_SurfBOOs");
     BOO.resize(size());
     surfBOO.resize(size());
     vector<size_t> nbs(size(),0);
@@ -776,15 +1094,22 @@ BondSet Particles::getSecondShell() const
 
 Particles::Binner::~Binner(void){};
 
+namespace {
+	/** \brief number of particles whose neighbours are queried together by the binners, to bound the memory used */
+	const size_t binnerBlock = 8192;
+}
+
 /**	\brief Bin the particles given by selection (coupled to their neighbours). */
 void Particles::Binner::operator<<(const std::vector<size_t> &selection)
 {
-    #pragma omp parallel for schedule(dynamic)
-    for(ssize_t p=0; p<(ssize_t)selection.size(); ++p)
+    for(size_t start=0; start<selection.size(); start+=binnerBlock)
     {
-        std::vector<size_t> around = parts.getEuclidianNeighbours(selection[p],cutoff);
-        for(ssize_t q=0;q<(ssize_t)around.size();++q)
-			(*this)(selection[p],around[q]);
+        const std::vector<size_t> block(selection.begin()+start, selection.begin()+min(start+binnerBlock, selection.size()));
+        const QueryResults around = parts.getEuclidianNeighbours(block, cutoff);
+        #pragma omp parallel for schedule(dynamic)
+        for(ssize_t p=0; p<(ssize_t)block.size(); ++p)
+            for(QueryResults::const_iterator q=around.begin(p); q!=around.end(p); ++q)
+                (*this)(block[p], *q);
     }
 }
 
@@ -799,11 +1124,126 @@ void Particles::RdfBinner::normalize(const size_t &n)
         g[r]/=r*r;
 }
 
+namespace {
+	/** \brief Bin the norms of n difference vectors (3n contiguous coordinates) into a histogram of nbins */
+	inline void binDistances_impl(const double *diffs, const size_t n, const double scale, const size_t nbins, double *hist)
+	{
+		const size_t block = 64;
+		double r[block];
+		for(size_t start=0; start<n; start+=block)
+		{
+			const size_t m = min(block, n-start);
+			const double *d = diffs + 3*start;
+			for(size_t i=0; i<m; ++i)
+				r[i] = sqrt(d[3*i]*d[3*i] + d[3*i+1]*d[3*i+1] + d[3*i+2]*d[3*i+2]) * scale;
+			for(size_t i=0; i<m; ++i)
+			{
+				const size_t bin = (size_t)r[i];
+				if(bin < nbins)
+					hist[bin]++;
+			}
+		}
+	}
+
+	COLLOIDS_DISPATCH_VARIANTS(void, binDistances, binDistances_impl,
+		(const double *diffs, const size_t n, const double scale, const size_t nbins, double *hist),
+		(diffs, n, scale, nbins, hist))
+
+	typedef void (*BinDistances)(const double *, const size_t, const double, const size_t, double *);
+	void binDistances(const double *diffs, const size_t n, const double scale, const size_t nbins, double *hist)
+	{
+		static const BinDistances f = dispatch<BinDistances>(
+			binDistances_generic, binDistances_sse42, binDistances_avx2, binDistances_avx512);
+		f(diffs, n, scale, nbins, hist);
+	}
+}
+
+/**	\brief Bin the particles given by selection (coupled to their neighbours).
+	Same result as operator<< but each thread fills its own histogram from batches of bond vectors.
+*/
+void Particles::RdfBinner::fill(const std::vector<size_t> &selection)
+{
+	size_t total = 0;
+	for(size_t start=0; start<selection.size(); start+=binnerBlock)
+	{
+		const std::vector<size_t> block(selection.begin()+start, selection.begin()+min(start+binnerBlock, selection.size()));
+		const QueryResults around = parts.getEuclidianNeighbours(block, cutoff);
+		#pragma omp parallel reduction(+:total)
+		{
+			std::vector<double> local(g.size(), 0.0), diffs;
+			#pragma omp for schedule(dynamic)
+			for(ssize_t p=0; p<(ssize_t)block.size(); ++p)
+			{
+				const size_t nb = around.size(p);
+				diffs.resize(3*nb);
+				for(size_t q=0; q<nb; ++q)
+				{
+					const Coord diff = parts.getDiff(block[p], around.items[around.offsets[p]+q]);
+					copy(&diff[0], &diff[0]+3, diffs.begin()+3*q);
+				}
+				if(nb)
+					binDistances(&diffs[0], nb, scale, local.size(), &local[0]);
+				total += nb;
+			}
+			#pragma omp critical
+			{
+				for(size_t r=0; r<g.size(); ++r)
+					g[r] += local[r];
+			}
+		}
+	}
+	count += total;
+}
+
+/**	\brief Bin the particles given by selection (coupled to their neighbours).
+	Same as fill, but the positions are read from a copy in the storage precision. The histogram is in double.
+*/
+template<class Real>
+void Particles::RdfBinner::fill_packed(const std::vector<size_t> &selection)
+{
+	const PositionArray<Real> pos(parts);
+	size_t total = 0;
+	for(size_t start=0; start<selection.size(); start+=binnerBlock)
+	{
+		const std::vector<size_t> block(selection.begin()+start, selection.begin()+min(start+binnerBlock, selection.size()));
+		const QueryResults around = parts.getEuclidianNeighbours(pos, block, cutoff);
+		#pragma omp parallel reduction(+:total)
+		{
+			std::vector<double> local(g.size(), 0.0), diffs;
+			#pragma omp for schedule(dynamic)
+			for(ssize_t p=0; p<(ssize_t)block.size(); ++p)
+			{
+				const size_t nb = around.size(p);
+				diffs.resize(3*nb);
+				for(size_t q=0; q<nb; ++q)
+				{
+					pos.diff(block[p], around.items[around.offsets[p]+q], &diffs[3*q]);
+					parts.minimumImage(&diffs[3*q]);
+				}
+				if(nb)
+					binDistances(&diffs[0], nb, scale, local.size(), &local[0]);
+				total += nb;
+			}
+			#pragma omp critical
+			{
+				for(size_t r=0; r<g.size(); ++r)
+					g[r] += local[r];
+			}
+		}
+	}
+	count += total;
+}
+template void Particles::RdfBinner::fill_packed<float>(const std::vector<size_t>&);
+template void Particles::RdfBinner::fill_packed<double>(const std::vector<size_t>&);
+
 /**	\brief Make and export the rdf of the selection */
 std::vector<double> Particles::getRdf(const std::vector<size_t> &selection, const size_t &n, const double &nbDiameterCutOff) const
 {
 	RdfBinner b(*this,n,nbDiameterCutOff);
-	b<<selection;
+	if(getStoragePrecision() == float_storage)
+		b.fill_packed<float>(selection);
+	else
+		b.fill(selection);
 	b.normalize(selection.size());
 	return b.g;
 }
@@ -990,34 +1430,17 @@ void Particles::loadBoo(const string &filename, boost::multi_array<double,2>&qw)
 BondSet Colloids::ngb2bonds(const NgbList& ngbList)
 {
     BondSet bonds;
-	for(size_t p=0;p<ngbList.size();++p)
+    //the bonds come in increasing order, so each insertion is at the end
+    size_t nb = 0;
+	for(size_t p=0;p<ngbList.size();++p)
+		nb += ngbList[p].end() - lower_bound(ngbList[p].begin(), ngbList[p].end(), p+1);
+    bonds.reserve(nb);
+	for(size_t p=0;p<ngbList.size();++p)
 		for(vector<size_t>::const_iterator q=lower_bound(ngbList[p].begin(), ngbList[p].end(), p+1); q!=ngbList[p].end();++q)
 			bonds.insert(bonds.end(), Bond(p,*q));
 	return bonds;
 }
 
-/** @brief load bonds from file  */
-BondSet Colloids::loadBonds(const std::string &filename)
-{
-	BondSet bonds;
-	ifstream f(filename.c_str());
-	if(!f)
-		throw invalid_argument("no such file as "+filename);
-	copy(
-		istream_iterator<Bond>(f), istream_iterator<Bond>(),
-		inserter(bonds, bonds.end())
-		);
-	return bonds;
-}
-
-/** @brief export a bondset to a stream in VTK format (heavier than saveBond)  */
-ostream & Colloids::toVTKstream(std::ostream &out, const BondSet &bonds)
-{
-	out << "LINES "<<bonds.size()<<" "<<bonds.size()*3<<endl;
-	for(BondSet::const_iterator b= bonds.begin();b!=bonds.end();++b)
-		out<<"2 "<< *b <<"\n";
-    return out;
-}
 
 
 
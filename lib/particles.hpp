@@ -33,6 +33,8 @@
 #include "index.hpp"
 #include "fields.hpp"
 #include "boo_data.hpp"
+#include "precision.hpp"
+#include "bonds.hpp"
 
 #include <boost/multi_array.hpp>
 #include <boost/bind.hpp>
@@ -56,35 +58,6 @@ namespace Colloids
     typedef RStarIndex_S::RTree                     RTree;
     typedef std::vector< std::vector<size_t> >         NgbList;
 
-    struct Bond : private std::pair<size_t, size_t>
-	{
-		explicit Bond(const size_t &x, const size_t &y){this->assign(x,y);}
-		Bond(std::pair<size_t, size_t> p){this->assign(p.first, p.second);};
-		Bond(){first=static_cast<size_t>(-2); second=static_cast<size_t>(-1);}
-
-		void assign(const size_t &x, const size_t &y)
-		{
-			if(x<y)
-			{
-				this->first=x;
-				this->second=y;
-			}
-			else
-			{
-				this->first=y;
-				this->second=x;
-			}
-		};
-		const size_t& low() const {return this->first;}
-		const size_t& high() const {return this->second;}
-		bool operator<(const Bond &rhs) const
-		{
-			return (this->first < rhs.first) || (this->first == rhs.first && this->second < rhs.second);
-		}
-	};
-
-    typedef std::set<Bond>	BondSet;
-
     BondSet ngb2bonds(const NgbList& ngbList);
 
     /**
@@ -98,7 +71,12 @@ namespace Colloids
         /** \brief A neighbour list */
         std::auto_ptr<NgbList> neighboursList;
 
-        public:
+        /** \brief originalIds[p] is the index that the particle p had before sortSpatially. Empty if never sorted. */
+        std::vector<size_t> originalIds;
+
+        public:
+            /** \brief Space filling curves along which the particles can be sorted */
+            enum SpaceFillingCurve {morton, hilbert};
             /** \brief overall bounding box */
             BoundingBox bb;
             /** \brief (mean) radius of all the particles */
@@ -126,6 +104,8 @@ namespace Colloids
             /** Geometry related */
             virtual Coord getDiff(const Coord &from,const size_t &to) const;
             virtual Coord getDiff(const size_t &from,const size_t &to) const;
+            /** \brief bring a difference vector to its minimum image. Nothing to do without periodic boundary conditions. */
+            virtual void minimumImage(double *diff) const {};
             virtual double getAngle(const size_t &origin,const size_t &a,const size_t &b) const;
             virtual std::vector<size_t> selectInside_noindex(const double &margin, const bool noZ=false) const;
             void loadInside(std::vector<size_t> &inside) const;
@@ -134,22 +114,44 @@ namespace Colloids
             static BoundingBox bounds(const Coord &center,const double &r=0.0);
             bool hasIndex() const {return !!index.get();};
             void setIndex(SpatialIndex *I){index.reset(I);};
-            void makeRTreeIndex();
+            void makeRTreeIndex(const size_t &leafSize=FrozenRStarIndex_S::capacity);
+            void updateIndex();
+            void moveIndex(Particles &next, const std::vector<size_t> &ids);
             BoundingBox getOverallBox() const;
 
             /** Spatial query and neighbours. Depends on both geometry and spatial index */
             virtual std::vector<size_t> selectEnclosed(const BoundingBox &b) const;
+            virtual QueryResults selectEnclosed(const std::vector<BoundingBox> &queries) const;
             std::vector<size_t> getEuclidianNeighbours(const Coord &center, const double &range) const;
             std::vector<size_t> getEuclidianNeighbours(const size_t &center, const double &range) const;
+            QueryResults getEuclidianNeighbours(const std::vector<size_t> &centers, const double &range) const;
+            template<class Real>
+            QueryResults getEuclidianNeighbours(const PositionArray<Real> &pos, const std::vector<size_t> &centers, const double &range) const;
             size_t getNearestNeighbour(const Coord &center, const double &range=1.0) const;
             std::multimap<double,size_t> getEuclidianNeighboursBySqDist(const Coord &center, const double &range) const;
+            std::vector< std::multimap<double,size_t> > getEuclidianNeighboursBySqDist(const std::vector<Coord> &centers, const double &range) const;
             NgbList & makeNgbList(const double &bondLength);
             NgbList & makeNgbList(const BondSet &bonds);
             const NgbList & getNgbList() const {return *this->neighboursList;};
+            bool hasNgbList() const {return !!neighboursList.get();};
             void delNgbList(){neighboursList.reset();};
             BondSet getBonds() const {return ngb2bonds(getNgbList());};
             virtual std::vector<size_t> selectInside(const double &margin, const bool noZ=false) const;
 
+            /** Cache of the spatial index and of the neighbour list, see frameCache.hpp */
+            bool loadCache(const std::string &filename, const boost::uint64_t &key);
+            void saveCache(const std::string &filename, const boost::uint64_t &key, const bool withNgbList=true) const;
+
+            /** Memory ordering */
+            void sortSpatially(const SpaceFillingCurve &curve=hilbert);
+            void restoreOrder();
+            bool isSorted() const {return !originalIds.empty();};
+            size_t getOriginalId(const size_t &p) const {return originalIds.empty() ? p : originalIds[p];};
+            const std::vector<size_t> & getOriginalIds() const {return originalIds;};
+            template<typename T> void toOriginalOrder(std::vector<T> &values) const;
+            void toOriginalIds(std::vector<size_t> &indices) const;
+            BondSet toOriginalIds(const BondSet &bonds) const;
+
 
             /**Bond Orientational Order related */
             BooData sphHarm_OneBond(const size_t &center, const size_t &neighbour) const;
@@ -158,6 +160,10 @@ namespace Colloids
             void getBOOs(std::vector<BooData> &BOO) const;
             void getBOOs(const std::vector<size_t> &selection, std::vector<BooData> &BOO) const;
             void getCgBOOs(const std::vector<size_t> &selection, const std::vector<BooData> &BOO, std::vector<BooData> &cgBOO) const;
+            template<class Real>
+            void getBOOs_packed(BooArray<Real> &BOO) const;
+            template<class Real>
+            void getCgBOOs_packed(const std::vector<size_t> &selection, const BooArray<Real> &BOO, BooArray<Real> &cgBOO) const;
             void getSurfBOOs(std::vector<BooData> &BOO) const;
             void getBOOs_SurfBOOs(std::vector<BooData> &BOO, std::vector<BooData> &surfBOO) const;
             void getFlipBOOs(const std::vector<BooData> &BOO, std::vector<BooData> &flipBOO, const BondSet &bonds) const;
@@ -210,7 +216,10 @@ namespace Colloids
 					g[(size_t)(norm2(parts.getDiff(p,q)) * scale)]++;
 					count++;
 				};
-                void normalize(const size_t &n);
+                void fill(const std::vector<size_t> &selection);
+                template<class Real>
+                void fill_packed(const std::vector<size_t> &selection);
+                void normalize(const size_t &n);
             };
 
             std::vector<double> getRdf(const std::vector<size_t> &selection, const size_t &n, const double &nbDiameterCutOff) const;
@@ -256,20 +265,16 @@ namespace Colloids
             //static bool areTooClose(const std::valarray<double> &c, const Coord &d,const double &Sep);
 
     };
-    BondSet loadBonds(const std::string &filename);
-    std::ostream &toVTKstream(std::ostream &out, const BondSet &bonds);
-    inline std::ostream & operator<<(std::ostream& out, const Bond& b)
-    {
-    	out<<b.low()<<" "<<b.high();
-    	return out;
-    }
-    inline std::istream & operator>>(std::istream& in, Bond& b)
+
+    /** \brief Particles of a part of a frame (MPI domain, tile), having the number density of the whole frame */
+    class DomainParticles : public Particles
     {
-    	size_t x,y;
-    	in>>x>>y;
-    	b = Bond(x,y);
-    	return in;
-    }
+        public:
+            double density;
+
+            DomainParticles(const double &r) : Particles(0, 0.0, r), density(0.0) {};
+            double getNumberDensity() const {return density;};
+    };
 
     /**Inline functions, for performance*/
 
@@ -298,6 +303,15 @@ namespace Colloids
         return (*index)(b);
     }
 
+    /** @brief get the indices of the particles enclosed by each query box, the queries being processed in parallel  */
+    inline QueryResults Particles::selectEnclosed(const std::vector<BoundingBox> &queries) const
+    {
+        #ifndef NDEBUG
+        if(!this->hasIndex()) throw std::logic_error("Set a spatial index before doing spatial queries !");
+        #endif
+        return index->batchQuery(queries);
+    }
+
     /** @brief get the indices of the particles inside a reduction of the maximum bounding box  */
     inline std::vector<size_t> Particles::selectInside(const double &margin, const bool noZ) const
     {
@@ -319,6 +333,20 @@ namespace Colloids
 		}
 	};
 
+	/** @brief put back in the order preceding sortSpatially a vector of values, one per particle */
+	template<typename T>
+	void Particles::toOriginalOrder(std::vector<T> &values) const
+	{
+		if(originalIds.empty())
+			return;
+		if(values.size() != originalIds.size())
+			throw std::invalid_argument("Particles::toOriginalOrder: there must be one value per particle");
+		std::vector<T> original(values.size());
+		for(size_t p=0; p<values.size(); ++p)
+			original[originalIds[p]] = values[p];
+		values.swap(original);
+	}
+
 	/** @brief remove the values that are not in the selection      */
 	template<typename T>
     void Particles::removeOutside(const std::vector<size_t> &inside, std::vector<T> &BOO) const
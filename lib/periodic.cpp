@@ -33,6 +33,16 @@ void PeriodicParticles::periodify(Coord &v) const
 }
 
 
+/** \brief Bring a difference vector to its minimum image */
+void PeriodicParticles::minimumImage(double *diff) const
+{
+    for(size_t i=0;i<3;++i)
+    {
+        if(diff[i]>getPeriod(i)/2.0) diff[i] -= getPeriod(i);
+        if(diff[i]<=-getPeriod(i)/2.0) diff[i] += getPeriod(i);
+    }
+}
+
 /** \brief get the difference vector between a position and one of the particles */
 Coord PeriodicParticles::getDiff(const Coord &from,const size_t &to) const
 {
@@ -114,3 +124,22 @@ vector<size_t> PeriodicParticles::selectEnclosed(const BoundingBox &b) const
     return vector<size_t>(total.begin(), total.end());
 
 }
+
+namespace {
+    /** \brief a single periodic query */
+    struct PeriodicQuery
+    {
+        const PeriodicParticles &parts;
+        explicit PeriodicQuery(const PeriodicParticles &p) : parts(p) {};
+        vector<size_t> operator()(const BoundingBox &b) const {return parts.selectEnclosed(b);}
+    };
+}
+
+/**
+    \brief get the indices of the particles enclosed inside each query box, with periodicity.
+    The queries are processed in parallel.
+*/
+QueryResults PeriodicParticles::selectEnclosed(const std::vector<BoundingBox> &queries) const
+{
+    return batchQuery(queries, PeriodicQuery(*this));
+}
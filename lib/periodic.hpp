@@ -48,9 +48,11 @@ namespace Colloids
             void periodify(Coord &v) const;
             Coord getDiff(const Coord &from,const size_t &to) const;
             Coord getDiff(const size_t &from,const size_t &to) const;
+            void minimumImage(double *diff) const;
             double getNumberDensity() const;
             std::vector<size_t> selectInside(const double &margin, const bool noZ=false) const;
             std::vector<size_t> selectEnclosed(const BoundingBox &b) const;
+            QueryResults selectEnclosed(const std::vector<BoundingBox> &queries) const;
             std::vector<size_t> selectInside_noindex(const double &margin, const bool noZ=false) const{return this->selectInside(margin, noZ);};
             //vector<size_t> getEuclidianNeighbours(const valarray<double> &center, const double &range) const;
     };
@@ -0,0 +1,176 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+
+ * \file precision.hpp
+ * \brief Storage precision of the positions and bond orientational order in the bandwidth-bound analyses
+ * \author Mathieu Leocmach
+ * \date 18 October 2026
+ *
+ * The particles are kept in double precision, but the analyses that stream over all positions or all qlm
+ * (g(r), mean square displacement, coarse-grained BOO) can work on packed copies in single precision,
+ * halving the memory traffic. Differences of positions are taken in the storage precision,
+ * but every sum over neighbours, particles or time intervals is accumulated in double.
+ *
+ * The precision used by getRdf and getMSD is chosen at runtime by the environment variable COLLOIDS_PRECISION
+ * (float or double). The default is double, or float when configured with --enable-float-storage.
+ */
+
+#ifndef precision_H
+#define precision_H
+
+#include "boo_data.hpp"
+
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace Colloids
+{
+    /** \brief Precision policy: what is stored in memory, and what sums are made of */
+    template<class Real>
+    struct Precision
+    {
+        typedef Real storage;
+        typedef double accumulator;
+    };
+
+    enum StoragePrecision {double_storage=0, float_storage=1};
+
+    /** \brief storage precision selected at build time and by the COLLOIDS_PRECISION environment variable */
+    inline StoragePrecision selectStoragePrecision()
+    {
+#ifdef COLLOIDS_FLOAT_STORAGE
+        const StoragePrecision def = float_storage;
+#else
+        const StoragePrecision def = double_storage;
+#endif
+        const char* env = std::getenv("COLLOIDS_PRECISION");
+        if(!env || !*env)
+            return def;
+        if(!std::strcmp(env, "float"))
+            return float_storage;
+        if(!std::strcmp(env, "double"))
+            return double_storage;
+        std::cerr<<"COLLOIDS_PRECISION="<<env<<" is not one of float, double. Using "<<(def==float_storage?"float":"double")<<std::endl;
+        return def;
+    }
+
+    /** \brief storage precision used during the whole run */
+    inline StoragePrecision getStoragePrecision()
+    {
+        static const StoragePrecision p = selectStoragePrecision();
+        return p;
+    }
+
+    /** \brief Positions of a set of particles as a structure of arrays in the storage precision */
+    template<class Real>
+    class PositionArray
+    {
+        public:
+            typedef typename Precision<Real>::accumulator accumulator;
+
+            PositionArray() {};
+            explicit PositionArray(const std::vector<Coord> &positions)
+            {
+                for(size_t d=0; d<3; ++d)
+                {
+                    xyz[d].resize(positions.size());
+                    for(size_t p=0; p<positions.size(); ++p)
+                        xyz[d][p] = positions[p][d];
+                }
+            };
+
+            size_t size() const {return xyz[0].size();};
+            const Real& operator()(const size_t &p, const size_t &d) const {return xyz[d][p];};
+
+            /** \brief difference vector between two particles, computed in the storage precision */
+            void diff(const size_t &from, const size_t &to, double *out) const
+            {
+                for(size_t d=0; d<3; ++d)
+                    out[d] = (Real)(xyz[d][to] - xyz[d][from]);
+            };
+            accumulator sqDist(const size_t &from, const size_t &to) const
+            {
+                accumulator s = 0;
+                for(size_t d=0; d<3; ++d)
+                {
+                    const accumulator x = (Real)(xyz[d][to] - xyz[d][from]);
+                    s += x*x;
+                }
+                return s;
+            };
+
+        private:
+            std::vector<Real> xyz[3];
+    };
+
+    /** \brief Bond orientational order of many particles, the 36 qlm of each particle being stored contiguously in the storage precision */
+    template<class Real>
+    class BooArray
+    {
+        public:
+            typedef typename Precision<Real>::accumulator accumulator;
+
+            explicit BooArray(const size_t &n=0) : data(72*n, (Real)0) {};
+
+            size_t size() const {return data.size()/72;};
+            void assign(const size_t &n) {data.assign(72*n, (Real)0);};
+
+            void set(const size_t &p, const BooData &boo)
+            {
+                Real *d = &data[72*p];
+                for(size_t i=0; i<36; ++i)
+                {
+                    d[2*i] = boo[i].real();
+                    d[2*i+1] = boo[i].imag();
+                }
+            };
+            BooData operator[](const size_t &p) const
+            {
+                BooData boo;
+                addTo(p, boo);
+                return boo;
+            };
+            /** \brief add the qlm of particle p to a sum in double precision */
+            void addTo(const size_t &p, BooData &sum) const
+            {
+                const Real *d = &data[72*p];
+                for(size_t i=0; i<36; ++i)
+                    sum[i] += std::complex<double>(d[2*i], d[2*i+1]);
+            };
+            /** \brief Steinhardt order parameter Ql of particle p */
+            accumulator getQl(const size_t &p, const size_t &l) const
+            {
+                const Real *d = &data[72*p + 2*(l*l/4)];
+                accumulator sum = 0;
+                for(size_t m=1; m<=l; ++m)
+                    sum += (accumulator)d[2*m]*d[2*m] + (accumulator)d[2*m+1]*d[2*m+1];
+                sum *= 2.0;
+                sum += (accumulator)d[0]*d[0] + (accumulator)d[1]*d[1];
+                return std::sqrt(4.0 * M_PI * sum / (2 * l + 1));
+            };
+
+        private:
+            std::vector<Real> data;
+    };
+}
+
+#endif
@@ -0,0 +1,449 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "tiledFrame.hpp"
+#include "instrument.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <boost/cstdint.hpp>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+using namespace Colloids;
+
+namespace {
+	/** \brief a particle in a tile file */
+	struct TileRecord
+	{
+		double pos[3];
+		boost::uint64_t id;
+	};
+
+	/** \brief number of invariants per particle in the binary file: q4 q6 q8 q10 w4 w6 w8 w10 then the same coarse grained */
+	const size_t nbInvariants = 16;
+	/** \brief number of particles converted to text at once */
+	const size_t exportBlock = 4096;
+
+	size_t nbThreads()
+	{
+#ifdef _OPENMP
+		return omp_get_max_threads();
+#else
+		return 1;
+#endif
+	}
+
+	/** \brief append the buffer to a tile file and empty it */
+	void appendRecords(vector<TileRecord> &buffer, const string &filename, size_t &count)
+	{
+		if(buffer.empty())
+			return;
+		ofstream f(filename.c_str(), ios::out | ios::app | ios::binary);
+		f.write(reinterpret_cast<const char*>(&buffer[0]), buffer.size()*sizeof(TileRecord));
+		if(!f)
+			throw runtime_error("cannot write "+filename);
+		count += buffer.size();
+		vector<TileRecord>().swap(buffer);
+	}
+
+	/** \brief add the particles of a tile file to the particles of the tile */
+	void readRecords(const string &filename, const size_t &count, Particles &parts, vector<size_t> &ids)
+	{
+		if(!count)
+			return;
+		vector<TileRecord> records(count);
+		ifstream f(filename.c_str(), ios::in | ios::binary);
+		if(!f.read(reinterpret_cast<char*>(&records[0]), count*sizeof(TileRecord)))
+			throw runtime_error("cannot read "+filename);
+		Coord c(0.0, 3);
+		for(size_t i=0; i<count; ++i)
+		{
+			copy(records[i].pos, records[i].pos+3, &c[0]);
+			parts.push_back(c);
+			ids.push_back(records[i].id);
+		}
+	}
+
+
+
+	bool encloses(const BoundingBox &b, const Coord &c)
+	{
+		for(size_t d=0; d<3; ++d)
+			if(c[d] < b.edges[d].first || c[d] > b.edges[d].second)
+				return false;
+		return true;
+	}
+
+	/** \brief q4 q6 q8 q10 w4 w6 w8 w10, as cloud_exporter */
+	void invariants(const BooData &boo, double *qw)
+	{
+		for(size_t i=0; i<4; ++i)
+			boo.getInvarients(4+2*i, qw[i], qw[4+i]);
+	}
+}
+
+/**
+    @brief Constructor. Splits the frame into tile files
+
+    \param filename A .dat file
+*/
+TiledFrame::TiledFrame(const std::string &filename, const double &radius, const Options &options) :
+	options(options), radius(radius), globalSize(0), nbConcurrent(1), halo(0.0), density(0.0)
+{
+	prefix = options.tilePrefix.empty() ? filename.substr(0, filename.find_last_of(".")) : options.tilePrefix;
+	//the BOO of the neighbours of the particles of a tile are needed for their coarse grained BOO
+	halo = 2.0 * radius * max(options.rdfBins ? options.rdfRange : 0.0, (options.boo ? 2.0 : 1.0) * options.bondLength);
+	try
+	{
+		bucket(filename);
+	}
+	catch(...)
+	{
+		removeFiles();
+		throw;
+	}
+	density = globalSize / (options.periodic ? box : extent).area();
+	if(getLargestTile())
+		nbConcurrent = max((size_t)1, min(nbThreads(), options.memoryBudget / (getLargestTile()*bytesPerParticle)));
+	Instrument::gauge("tiled.tiles", getNbTiles());
+	Instrument::gauge("tiled.largest_tile", getLargestTile());
+	Instrument::gauge("tiled.concurrent", nbConcurrent);
+}
+
+TiledFrame::~TiledFrame()
+{
+	removeFiles();
+}
+
+/** @brief remove the tile files and the invariants */
+void TiledFrame::removeFiles() const
+{
+	for(size_t t=0; t<getNbTiles(); ++t)
+	{
+		remove(tileName(t, true).c_str());
+		remove(tileName(t, false).c_str());
+	}
+	remove(invariantsName().c_str());
+}
+
+std::string TiledFrame::tileName(const size_t &tile, const bool core) const
+{
+	ostringstream name;
+	name << prefix << "_tile" << tile << (core ? ".core" : ".halo");
+	return name.str();
+}
+
+size_t TiledFrame::getLargestTile() const
+{
+	size_t largest = 0;
+	for(size_t t=0; t<getNbTiles(); ++t)
+		largest = max(largest, coreSizes[t] + haloSizes[t]);
+	return largest;
+}
+
+/**
+    @brief Read the coordinates file once and append each particle to the tiles it belongs to, as core or halo particle.
+
+    The particles are buffered in memory up to a quarter of the budget.
+*/
+void TiledFrame::bucket(const std::string &filename)
+{
+	Instrument::Timer timer("tiled.bucket");
+	ifstream file(filename.c_str(), ios::in);
+	if(!file)
+		throw invalid_argument("No such file as "+filename);
+	//same format as Particles(filename): header, upper edges of the box (the lower edges are 0), coordinates
+	size_t trash;
+	file >> trash >> globalSize >> trash;
+	for(size_t d=0; d<3; ++d)
+	{
+		box.edges[d].first = 0.0;
+		file >> box.edges[d].second;
+	}
+	if(!file)
+		throw invalid_argument(filename+" has no valid header");
+
+	double w = 2.0 * radius * options.tileWidth;
+	if(w <= 0.0)
+	{
+		//a tile per thread within the budget, halo included
+		const double nb = options.memoryBudget / (double)bytesPerParticle / nbThreads(),
+			d = box.area() > 0.0 ? globalSize / box.area() : 0.0;
+		w = d > 0.0 ? max(halo, pow(nb / d, 1.0/3.0) - 2.0*halo) : numeric_limits<double>::max();
+	}
+	size_t total = 1;
+	for(size_t d=0; d<3; ++d)
+	{
+		const double L = box.edges[d].second;
+		if(options.periodic && 2.0*halo > L)
+			throw invalid_argument("The halo must be shorter than half the period. Use a shorter range.");
+		nbTiles[d] = L > 0.0 ? max((size_t)1, (size_t)ceil(L / w)) : 1;
+		width[d] = L > 0.0 ? L / nbTiles[d] : 1.0;
+		total *= nbTiles[d];
+	}
+	coreSizes.assign(total, 0);
+	haloSizes.assign(total, 0);
+	for(size_t t=0; t<total; ++t)
+	{
+		remove(tileName(t, true).c_str());
+		remove(tileName(t, false).c_str());
+	}
+
+	vector< vector<TileRecord> > cores(total), halos(total);
+	const size_t bufferLimit = max((size_t)1, options.memoryBudget / 4 / sizeof(TileRecord));
+	size_t buffered = 0;
+	for(size_t d=0; d<3; ++d)
+	{
+		extent.edges[d].first = numeric_limits<double>::max();
+		extent.edges[d].second = -numeric_limits<double>::max();
+	}
+	for(size_t i=0; i<globalSize; ++i)
+	{
+		TileRecord r;
+		r.id = i;
+		file >> r.pos[0] >> r.pos[1] >> r.pos[2];
+		if(!file)
+			throw invalid_argument(filename+" has less particles than announced in its header");
+		//range of tiles closer than the halo. Without periodicity, the particles outside the box belong to the tiles at its boundaries
+		int owner[3], lo[3], hi[3];
+		for(size_t d=0; d<3; ++d)
+		{
+			const double L = box.edges[d].second;
+			if(options.periodic && L > 0.0)
+				r.pos[d] -= L * floor(r.pos[d] / L);
+			extent.edges[d].first = min(extent.edges[d].first, r.pos[d]);
+			extent.edges[d].second = max(extent.edges[d].second, r.pos[d]);
+			const int n = nbTiles[d];
+			owner[d] = max(0, min(n-1, (int)floor(r.pos[d] / width[d])));
+			lo[d] = min(owner[d], (int)floor((r.pos[d] - halo) / width[d]));
+			hi[d] = max(owner[d], (int)floor((r.pos[d] + halo) / width[d]));
+			if(!options.periodic)
+			{
+				lo[d] = max(0, lo[d]);
+				hi[d] = min(n-1, hi[d]);
+			}
+		}
+		int t[3];
+		for(t[0]=lo[0]; t[0]<=hi[0]; ++t[0])
+			for(t[1]=lo[1]; t[1]<=hi[1]; ++t[1])
+				for(t[2]=lo[2]; t[2]<=hi[2]; ++t[2])
+				{
+					//a copy seen from a tile across the periodic boundaries is shifted by the period
+					TileRecord copy = r;
+					size_t tile = 0;
+					bool core = true;
+					for(size_t d=0; d<3; ++d)
+					{
+						const int n = nbTiles[d], k = (int)floor(t[d] / (double)n), wrapped = t[d] - k*n;
+						copy.pos[d] -= k * box.edges[d].second;
+						core = core && !k && wrapped == owner[d];
+						tile = tile * n + wrapped;
+					}
+					(core ? cores : halos)[tile].push_back(copy);
+					buffered++;
+				}
+		if(buffered >= bufferLimit)
+		{
+			for(size_t tile=0; tile<total; ++tile)
+			{
+				appendRecords(cores[tile], tileName(tile, true), coreSizes[tile]);
+				appendRecords(halos[tile], tileName(tile, false), haloSizes[tile]);
+			}
+			buffered = 0;
+		}
+	}
+	for(size_t tile=0; tile<total; ++tile)
+	{
+		appendRecords(cores[tile], tileName(tile, true), coreSizes[tile]);
+		appendRecords(halos[tile], tileName(tile, false), haloSizes[tile]);
+	}
+}
+
+/** @brief Analyse the tiles, as many at a time as the memory budget allows */
+void TiledFrame::run()
+{
+	Instrument::Timer timer("tiled.run");
+	if(options.boo)
+	{
+		ofstream inv(invariantsName().c_str(), ios::out | ios::trunc | ios::binary);
+		if(!inv)
+			throw invalid_argument("cannot write "+invariantsName());
+	}
+	vector<double> hist(options.rdfBins, 0.0);
+	size_t nbRdf = 0;
+	string error;
+	#pragma omp parallel for schedule(dynamic,1) num_threads(nbConcurrent)
+	for(int t=0; t<(int)getNbTiles(); ++t)
+	{
+		try
+		{
+			analyse(t, hist, nbRdf);
+		}
+		catch(const exception &e)
+		{
+			#pragma omp critical
+			error = e.what();
+		}
+	}
+	if(!error.empty())
+		throw runtime_error(error);
+
+	if(options.rdfBins)
+	{
+		DomainParticles whole(radius);
+		whole.density = density;
+		Particles::RdfBinner b(whole, options.rdfBins, options.rdfRange);
+		b.g = hist;
+		b.normalize(nbRdf);
+		g.swap(b.g);
+	}
+}
+
+/**
+    @brief Analyse a single tile as a whole frame. The core particles come first, then the halo.
+
+    \param hist The g(r) histogram to add the core particles to
+    \param nbRdf The number of particles binned in the histogram
+*/
+void TiledFrame::analyse(const size_t &tile, std::vector<double> &hist, size_t &nbRdf) const
+{
+	Instrument::Timer timer("tiled.tile");
+	DomainParticles parts(radius);
+	parts.density = density;
+	parts.bb = box;
+	vector<size_t> ids;
+	const size_t nbCore = coreSizes[tile];
+	parts.reserve(nbCore + haloSizes[tile]);
+	ids.reserve(nbCore + haloSizes[tile]);
+	readRecords(tileName(tile, true), nbCore, parts, ids);
+	readRecords(tileName(tile, false), haloSizes[tile], parts, ids);
+	if(!nbCore)
+		return;
+	parts.makeRTreeIndex();
+
+	if(options.rdfBins)
+	{
+		const BoundingBox inside = shrink(extent, 2.0*radius*options.rdfRange, options.noZ);
+		vector<size_t> selection;
+		for(size_t p=0; p<nbCore; ++p)
+			if(options.periodic || encloses(inside, parts[p]))
+				selection.push_back(p);
+		Particles::RdfBinner b(parts, options.rdfBins, options.rdfRange);
+		b.fill(selection);
+		#pragma omp critical(tiled_rdf)
+		{
+			for(size_t r=0; r<hist.size(); ++r)
+				hist[r] += b.g[r];
+			nbRdf += selection.size();
+		}
+	}
+
+	if(options.boo)
+	{
+		parts.makeNgbList(options.bondLength);
+		//BOO of the core particles and of their neighbours, null near the walls as in FrameAnalysis
+		const double margin = options.bondLength*radius;
+		const BoundingBox inside = shrink(extent, margin, options.noZ), secondInside = shrink(extent, 2.0*margin, options.noZ);
+		vector<bool> needed(parts.size(), false);
+		for(size_t p=0; p<nbCore; ++p)
+		{
+			needed[p] = true;
+			for(vector<size_t>::const_iterator q=parts.getNgbList()[p].begin(); q!=parts.getNgbList()[p].end(); ++q)
+				needed[*q] = true;
+		}
+		vector<size_t> selection, cgSelection;
+		for(size_t p=0; p<parts.size(); ++p)
+			if(needed[p] && (options.periodic || encloses(inside, parts[p])))
+				selection.push_back(p);
+		for(size_t p=0; p<nbCore; ++p)
+			if(options.periodic || encloses(secondInside, parts[p]))
+				cgSelection.push_back(p);
+		vector<BooData> qlm, qlm_cg;
+		parts.getBOOs(selection, qlm);
+		parts.getCgBOOs(cgSelection, qlm, qlm_cg);
+
+		vector<double> qw(nbInvariants*nbCore);
+		for(size_t p=0; p<nbCore; ++p)
+		{
+			invariants(qlm[p], &qw[nbInvariants*p]);
+			invariants(qlm_cg[p], &qw[nbInvariants*p+8]);
+		}
+		//the core particles are in the order of the file
+		bool written;
+		#pragma omp critical(tiled_output)
+		{
+			fstream inv(invariantsName().c_str(), ios::in | ios::out | ios::binary);
+			for(size_t p=0; p<nbCore; ++p)
+			{
+				inv.seekp(ids[p] * nbInvariants * sizeof(double));
+				inv.write(reinterpret_cast<const char*>(&qw[nbInvariants*p]), nbInvariants * sizeof(double));
+			}
+			written = !!inv;
+		}
+		if(!written)
+			throw runtime_error("cannot write "+invariantsName());
+	}
+}
+
+/** @brief Write the invariants of the BOO and of the coarse grained BOO, in the order of the coordinates file. Skip a file if its name is empty */
+void TiledFrame::exportClouds(const std::string &qlmCloud, const std::string &cgCloud) const
+{
+	if(!options.boo)
+		throw logic_error("TiledFrame: the BOO were not computed");
+	Instrument::Timer timer("tiled.export");
+	ifstream inv(invariantsName().c_str(), ios::in | ios::binary);
+	ofstream q, cg;
+	if(!qlmCloud.empty())
+	{
+		q.open(qlmCloud.c_str(), ios::out | ios::trunc);
+		q << "#q4\tq6\tq8\tq10\tw4\tw6\tw8\tw10" << endl;
+	}
+	if(!cgCloud.empty())
+	{
+		cg.open(cgCloud.c_str(), ios::out | ios::trunc);
+		cg << "#Q4\tQ6\tQ8\tQ10\tW4\tW6\tW8\tW10" << endl;
+	}
+	vector<double> block(nbInvariants*exportBlock);
+	for(size_t start=0; start<globalSize; start+=exportBlock)
+	{
+		const size_t nb = min(exportBlock, globalSize-start);
+		if(!inv.read(reinterpret_cast<char*>(&block[0]), nb*nbInvariants*sizeof(double)))
+			throw runtime_error("cannot read "+invariantsName());
+		for(size_t p=0; p<nb; ++p)
+		{
+			if(q.is_open())
+			{
+				copy(block.begin()+nbInvariants*p, block.begin()+nbInvariants*p+8, ostream_iterator<double>(q, "\t"));
+				q << "\n";
+			}
+			if(cg.is_open())
+			{
+				copy(block.begin()+nbInvariants*p+8, block.begin()+nbInvariants*(p+1), ostream_iterator<double>(cg, "\t"));
+				cg << "\n";
+			}
+		}
+	}
+}
@@ -0,0 +1,114 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+
+ * \file tiledFrame.hpp
+ * \brief Out of core analysis of a single frame too large for the memory, tile by tile
+ * \author Mathieu Leocmach
+ * \date 18 October 2026
+ *
+ * The coordinates file is read once, and each particle is appended to the file of the tile owning it and to the halo files
+ * of the tiles closer than the halo width. With periodic boundary conditions, the copies crossing the box boundaries
+ * are shifted by the period. The tiles are then analysed independently, as a whole frame, with the usual spatial index,
+ * neighbour list, BOO and g(r). The BOO of the halo particles are computed too, so the halo is two bond lengths wide.
+ *
+ * The histograms of the g(r) are summed over the tiles. The invariants of the BOO of the particles of each tile are
+ * written to a binary file at the position of the particles in the coordinates file, and converted to text at the end.
+ *
+ * The memory of a tile is estimated to bytesPerParticle per particle, halo included. Without a given tile width,
+ * the tiles are as large as the memory budget allows for one tile per thread. As many tiles as the budget allows are
+ * analysed concurrently, the inner loops being parallel when a single tile fits.
+ */
+
+#ifndef tiled_frame_H
+#define tiled_frame_H
+
+#include "particles.hpp"
+
+#include <boost/utility.hpp>
+
+namespace Colloids
+{
+    /** \brief A frame split into tiles stored on disk */
+    class TiledFrame : boost::noncopyable
+    {
+        public:
+            /** \brief Parameters of the analyses, in units of the diameter */
+            struct Options
+            {
+                /** \brief maximum bond length */
+                double bondLength;
+                /** \brief number of bins and range of the g(r). No g(r) if there is no bin */
+                size_t rdfBins;
+                double rdfRange;
+                /** \brief compute the BOO and the coarse grained BOO */
+                bool boo;
+                /** \brief periodic boundary conditions, the period being the box of the file */
+                bool periodic;
+                /** \brief do not consider the boundaries perpendicular to z as walls (without periodic boundary conditions) */
+                bool noZ;
+                /** \brief width of the tiles without halo. 0 to deduce it from the memory budget */
+                double tileWidth;
+                /** \brief memory in bytes for the tiles analysed concurrently */
+                size_t memoryBudget;
+                /** \brief path and prefix of the tile files. Default is the coordinates file without extension */
+                std::string tilePrefix;
+
+                Options() : bondLength(1.3), rdfBins(200), rdfRange(15.0), boo(true), periodic(false), noZ(false),
+                    tileWidth(0.0), memoryBudget((size_t)1<<30) {};
+            };
+
+            /** \brief estimated memory of a particle in a tile: position, index, neighbours, BOO and coarse grained BOO */
+            static const size_t bytesPerParticle = 2048;
+
+            TiledFrame(const std::string &filename, const double &radius, const Options &options=Options());
+            ~TiledFrame();
+
+            size_t getGlobalSize() const {return globalSize;};
+            size_t getNbTiles() const {return coreSizes.size();};
+            size_t getNbConcurrent() const {return nbConcurrent;};
+            double getHalo() const {return halo;};
+            /** \brief the largest number of particles of a tile, halo included */
+            size_t getLargestTile() const;
+
+            void run();
+            /** \brief g(r) of the frame. Available after run */
+            const std::vector<double>& getRdf() const {return g;};
+            void exportClouds(const std::string &qlmCloud, const std::string &cgCloud) const;
+
+        private:
+            const Options options;
+            const double radius;
+            size_t globalSize, nbConcurrent;
+            double halo, density;
+            std::string prefix;
+            /** \brief the box of the file and the extent of all the particles */
+            BoundingBox box, extent;
+            size_t nbTiles[3];
+            double width[3];
+            std::vector<size_t> coreSizes, haloSizes;
+            std::vector<double> g;
+
+            void bucket(const std::string &filename);
+            void analyse(const size_t &tile, std::vector<double> &hist, size_t &nbRdf) const;
+            std::string tileName(const size_t &tile, const bool core) const;
+            std::string invariantsName() const {return prefix+".inv";};
+            void removeFiles() const;
+    };
+}
+
+#endif
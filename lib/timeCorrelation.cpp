@@ -0,0 +1,231 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "timeCorrelation.hpp"
+
+using namespace std;
+using namespace Colloids;
+
+/** @brief Constructor
+  *
+  * \param trajectories The trajectory index, with its inverse
+  * \param maxLag The largest lag (in frames) to compute
+  * \param nbComponents Number of double per position in the pushed fields (1 for scalar, 3 for Coord, booComponents(l) for BooData)
+  * \param chunk Number of frames correlated at once. Memory scales as chunk+maxLag frames. 0 to choose it from maxLag.
+  */
+TimeCorrelation::TimeCorrelation(const TrajIndex &trajectories, const size_t &maxLag, const size_t &nbComponents, const size_t &chunk) :
+    trajectories(trajectories), maxLag(maxLag), nbComponents(nbComponents), t(0), t0(0),
+    sums(maxLag+1, 0.0), nbPairs(maxLag+1, 0.0)
+{
+    if(trajectories.nbFrames()==0)
+        throw invalid_argument("TimeCorrelation: make the inverse of the trajectory index first");
+    if(nbComponents==0)
+        throw invalid_argument("TimeCorrelation: at least one component needed");
+    //the FFT is a power of 2 large enough to avoid wrapping
+    fftSize = 2;
+    while(fftSize < max(chunk, maxLag+1) + maxLag)
+        fftSize *= 2;
+    this->chunk = fftSize - maxLag;
+
+    double *in = (double*)fftw_malloc(sizeof(double) * fftSize);
+    fftw_complex *out = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * (fftSize/2+1));
+    forward_plan = fftw_plan_dft_r2c_1d(fftSize, in, out, FFTW_ESTIMATE);
+    backward_plan = fftw_plan_dft_c2r_1d(fftSize, out, in, FFTW_ESTIMATE);
+    fftw_free(in);
+    fftw_free(out);
+}
+
+TimeCorrelation::~TimeCorrelation()
+{
+    fftw_destroy_plan(forward_plan);
+    fftw_destroy_plan(backward_plan);
+}
+
+/** @brief push a scalar field, indexed by position in the current frame */
+void TimeCorrelation::push_back(const std::vector<double> &field)
+{
+    if(nbComponents!=1)
+        throw invalid_argument("TimeCorrelation: scalar field needs 1 component");
+    vector<double> flat(field);
+    push_back_flat(flat);
+}
+
+/** @brief push a vector field, indexed by position in the current frame */
+void TimeCorrelation::push_back(const std::vector<Coord> &field)
+{
+    if(nbComponents!=3)
+        throw invalid_argument("TimeCorrelation: vector field needs 3 components");
+    vector<double> flat(3*field.size());
+    for(size_t p=0; p<field.size(); ++p)
+        copy(&field[p][0], &field[p][0]+3, flat.begin()+3*p);
+    push_back_flat(flat);
+}
+
+/** @brief push a BooData field, indexed by position in the current frame.
+  *
+  * The product is the same as BooData::innerProduct : sum over -l<=m<=l of qlm(t) conj(qlm(t+tau)).
+  * Components m>0 are weighted by sqrt(2) to account for the negative m.
+  */
+void TimeCorrelation::push_back(const std::vector<BooData> &field, const size_t &l)
+{
+    if(nbComponents!=booComponents(l))
+        throw invalid_argument("TimeCorrelation: wrong number of components for this l");
+    vector<double> flat(nbComponents*field.size());
+    for(size_t p=0; p<field.size(); ++p)
+    {
+        vector<double>::iterator it = flat.begin() + nbComponents*p;
+        *it++ = real(field[p](l, 0));
+        for(int m=1; m<=(int)l; ++m)
+        {
+            *it++ = M_SQRT2 * real(field[p](l, m));
+            *it++ = M_SQRT2 * imag(field[p](l, m));
+        }
+    }
+    push_back_flat(flat);
+}
+
+/** @brief correlate the frames remaining in memory. To be called after the last frame */
+void TimeCorrelation::finish()
+{
+    while(!window.empty())
+    {
+        const size_t length = min(chunk, window.size());
+        process(length);
+        window.erase(window.begin(), window.begin()+length);
+        t0 += length;
+    }
+}
+
+/** @brief the correlation function for all lags from 0 to maxLag */
+std::vector<double> TimeCorrelation::get() const
+{
+    vector<double> c(sums.size(), 0.0);
+    for(size_t tau=0; tau<c.size(); ++tau)
+        if(nbPairs[tau]>0)
+            c[tau] = sums[tau] / nbPairs[tau];
+    return c;
+}
+
+/** @brief the correlation function at some lags, typically given by logLags */
+std::vector<double> TimeCorrelation::get(const std::vector<size_t> &lags) const
+{
+    const vector<double> all = get();
+    vector<double> c(lags.size());
+    for(size_t i=0; i<lags.size(); ++i)
+        c[i] = all.at(lags[i]);
+    return c;
+}
+
+/** @brief Logarithmically spaced lags between 0 and maxLag, without duplicates */
+std::vector<size_t> TimeCorrelation::logLags(const size_t &maxLag, const size_t &perDecade)
+{
+    vector<size_t> lags(1, 0);
+    for(size_t i=0; ; ++i)
+    {
+        const size_t tau = (size_t)(pow(10.0, i/(double)perDecade) + 0.5);
+        if(tau > maxLag)
+            break;
+        if(tau > lags.back())
+            lags.push_back(tau);
+    }
+    return lags;
+}
+
+void TimeCorrelation::push_back_flat(std::vector<double> &flat)
+{
+    if(t >= trajectories.nbFrames())
+        throw out_of_range("TimeCorrelation: more frames than in the trajectory index");
+    if(flat.size() != nbComponents * trajectories.getInverse(t).size())
+        throw invalid_argument("TimeCorrelation: field size differs from the number of positions");
+    window.push_back(vector<double>());
+    window.back().swap(flat);
+    t++;
+    if(window.size() == chunk + maxLag)
+    {
+        process(chunk);
+        window.erase(window.begin(), window.begin()+chunk);
+        t0 += chunk;
+    }
+}
+
+/** @brief correlate the first length frames of the window with all the frames of the window */
+void TimeCorrelation::process(const size_t &length)
+{
+    const size_t t1 = t0 + length, t2 = t0 + window.size();
+    //trajectories existing during the chunk
+    vector<size_t> active;
+    for(size_t tr=0; tr<trajectories.size(); ++tr)
+        if(trajectories[tr].start_time < t1 && trajectories[tr].last_time() >= t0)
+            active.push_back(tr);
+
+    #pragma omp parallel
+    {
+        double *a = (double*)fftw_malloc(sizeof(double) * fftSize),
+            *y = (double*)fftw_malloc(sizeof(double) * fftSize);
+        fftw_complex *A = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * (fftSize/2+1)),
+            *Y = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * (fftSize/2+1)),
+            *S = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * (fftSize/2+1));
+        vector<double> s(maxLag+1, 0.0), n(maxLag+1, 0.0);
+
+        #pragma omp for schedule(dynamic)
+        for(ssize_t i=0; i<(ssize_t)active.size(); ++i)
+        {
+            const Traj &tr = trajectories[active[i]];
+            const size_t start = max(t0, tr.start_time),
+                stopA = min(t1, tr.last_time()+1),
+                stopY = min(t2, tr.last_time()+1);
+            fill(S[0], S[0] + 2*(fftSize/2+1), 0.0);
+            for(size_t c=0; c<nbComponents; ++c)
+            {
+                fill(a, a+fftSize, 0.0);
+                fill(y, y+fftSize, 0.0);
+                for(size_t u=start; u<stopY; ++u)
+                    y[u-t0] = window[u-t0][tr[u]*nbComponents + c];
+                copy(y + start-t0, y + stopA-t0, a + start-t0);
+                fftw_execute_dft_r2c(forward_plan, a, A);
+                fftw_execute_dft_r2c(forward_plan, y, Y);
+                //conj(A)*Y
+                for(size_t k=0; k<fftSize/2+1; ++k)
+                {
+                    S[k][0] += A[k][0]*Y[k][0] + A[k][1]*Y[k][1];
+                    S[k][1] += A[k][0]*Y[k][1] - A[k][1]*Y[k][0];
+                }
+            }
+            fftw_execute_dft_c2r(backward_plan, S, y);
+            for(size_t tau=0; tau<=maxLag; ++tau)
+            {
+                //number of u in [start, stopA) such that u+tau < stopY
+                if(start + tau >= stopY)
+                    break;
+                s[tau] += y[tau] / fftSize;
+                n[tau] += min(stopA, stopY - tau) - start;
+            }
+        }
+        #pragma omp critical
+        {
+            transform(s.begin(), s.end(), sums.begin(), sums.begin(), plus<double>());
+            transform(n.begin(), n.end(), nbPairs.begin(), nbPairs.begin(), plus<double>());
+        }
+        fftw_free(a);
+        fftw_free(y);
+        fftw_free(A);
+        fftw_free(Y);
+        fftw_free(S);
+    }
+}
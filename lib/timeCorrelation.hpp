@@ -0,0 +1,85 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+
+ * \file timeCorrelation.hpp
+ * \brief Defines classes to compute time autocorrelation of per-particle fields along trajectories
+ * \author Mathieu Leocmach
+ * \date 18 October 2026
+ *
+ */
+
+#ifndef time_correlation_H
+#define time_correlation_H
+
+#include "traj.hpp"
+#include "boo_data.hpp"
+
+#include <fftw3.h>
+#include <boost/noncopyable.hpp>
+
+namespace Colloids
+{
+    /**
+        \brief Trajectory averaged autocorrelation of a per-particle field.
+
+        \f$C(\tau) = \frac{\sum_{tr}\sum_t x_{tr}(t)\cdot x_{tr}(t+\tau)}{\sum_{tr}\sum_t 1}\f$, both sums running over the pairs of times where the trajectory exists.
+
+        Frames are pushed one by one and only a window of chunk+maxLag frames is kept in memory.
+        Each chunk is correlated with the following frames by FFT, trajectory by trajectory, in parallel.
+        The field is stored as nbComponents doubles per position, the product being the sum over components.
+    */
+    class TimeCorrelation : boost::noncopyable
+    {
+        public:
+            explicit TimeCorrelation(const TrajIndex &trajectories, const size_t &maxLag, const size_t &nbComponents=1, const size_t &chunk=0);
+            ~TimeCorrelation();
+
+            void push_back(const std::vector<double> &field);
+            void push_back(const std::vector<Coord> &field);
+            void push_back(const std::vector<BooData> &field, const size_t &l);
+            void finish();
+
+            /** \brief number of frames already pushed */
+            size_t size() const {return t;};
+            const size_t & getMaxLag() const {return maxLag;};
+            const size_t & getChunk() const {return chunk;};
+            /** \brief numerator of the correlation, for each lag */
+            const std::vector<double> & getSums() const {return sums;};
+            /** \brief number of pairs of times contributing to each lag */
+            const std::vector<double> & getNbPairs() const {return nbPairs;};
+            std::vector<double> get() const;
+            std::vector<double> get(const std::vector<size_t> &lags) const;
+
+            static std::vector<size_t> logLags(const size_t &maxLag, const size_t &perDecade=10);
+            /** \brief number of components needed to store a BooData at a given l */
+            static size_t booComponents(const size_t &l) {return 2*l+1;};
+
+        private:
+            const TrajIndex &trajectories;
+            const size_t maxLag, nbComponents;
+            size_t chunk, fftSize, t, t0;
+            std::deque< std::vector<double> > window;
+            std::vector<double> sums, nbPairs;
+            fftw_plan forward_plan, backward_plan;
+
+            void push_back_flat(std::vector<double> &flat);
+            void process(const size_t &length);
+    };
+}
+
+#endif
@@ -47,7 +47,9 @@ Create new trajectories in the new frame if needed.
 void Colloids::TrajMap::push_back(const vector< multimap<double, size_t> > &followersByDist, const size_t &frameSize)
 {
     //convert the input into a list of links (pos,tr) sorted by distence between pos and the last position of the trajectory
-    multimap<double, Link> potential_links;
+    //the nodes are only needed during this call, so they are taken from the arena
+    ArenaScope scope;
+    ScratchMap<double, Link>::multimap potential_links;
     for(Frame::map_by<Coord>::const_iterator p_tr=bm.back().by<Coord>().begin();p_tr!=bm.back().by<Coord>().end();++p_tr)
         for(FolMap::const_iterator dist_fol=followersByDist[p_tr->first].begin();dist_fol!=followersByDist[p_tr->first].end();++dist_fol)
             potential_links.insert(make_pair(dist_fol->first, Link(dist_fol->second, p_tr->second)));
@@ -57,7 +59,7 @@ void Colloids::TrajMap::push_back(const vector< multimap<double, size_t> > &foll
 
     //insert the links into the new frame, statring by the shortest link
     //The links pointing to the same trajectory or to the same object as an already inserted link are automatically ignored
-    for(multimap<double, Link>::const_iterator l=potential_links.begin();l!=potential_links.end();++l)
+    for(ScratchMap<double, Link>::multimap::const_iterator l=potential_links.begin();l!=potential_links.end();++l)
         bm.back().insert(l->second);
 
     //some elements of the new frame may not have found a trajectory to be linked to. Creates a new trajectory for each of them.
@@ -200,8 +202,10 @@ void TrajIndex::makeInverse(const std::vector<size_t> &frameSizes)
 		inverse.push_back(new vector<size_t>(frameSizes[t]));
     for(size_t tr=0;tr<size();++tr)
         for(size_t t = (*this)[tr].start_time;t<=(*this)[tr].last_time();++t)
-            inverse[t][(*this)[tr][t]]=tr;
-}
+            //the positions of frames that are not loaded are not indexed
+            if((*this)[tr][t] < inverse[t].size())
+                inverse[t][(*this)[tr][t]]=tr;
+}
 
 /** @brief fill the TrajIndex with the content of a file stream  */
 istream & Colloids::operator>>(std::istream& is, TrajIndex& tri)
@@ -223,6 +227,37 @@ istream & Colloids::operator>>(std::istream& is, TrajIndex& tri)
     return is;
 }
 
+/** @brief fill the TrajIndex with the parts of the trajectories of a file stream that are inside a time interval
+  *
+  * Trajectories that do not overlap the interval are skipped, so the trajectory indices are not the ones of the file.
+  */
+istream & Colloids::readWithin(std::istream& is, TrajIndex& tri, const Interval &frames)
+{
+    size_t start;
+    string indexString;
+    is>>start;
+    while(is.good())
+    {
+        is.get(); //escape the endl
+        getline(is,indexString);
+        if(start<=frames.second)
+        {
+            Traj tr(start);
+            istringstream indexStream(indexString,istringstream::in);
+            indexStream>>tr;
+            if(tr.size() && tr.last_time()>=frames.first)
+            {
+                if(tr.start_time>=frames.first && tr.last_time()<=frames.second)
+                    tri.push_back(tr);
+                else
+                    tri.push_back(tr.subtraj(max(tr.start_time, frames.first), min(tr.last_time(), frames.second)));
+            }
+        }
+        is>>start;
+    }
+    return is;
+}
+
 /** @brief operator<<
   *
   * @todo: document this function
@@ -161,6 +161,7 @@ namespace Colloids
     };
 
     std::istream& operator>> (std::istream& is, TrajIndex& tri );
+    std::istream& readWithin(std::istream& is, TrajIndex& tri, const Interval &frames);
     std::ostream& operator<< (std::ostream& os, const TrajIndex& tri );
 
     /** \brief easy constructor */
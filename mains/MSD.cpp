@@ -18,8 +18,6 @@ int main(int argc, char ** argv)
 
     try
     {
-        DynamicParticles parts(filename);
-        parts.removeDrift();
         vector<double> MSD;
         boost::format name (inputPath+"_%1%from_%2%to_%3%av.msd");
         for(size_t i=0;i<nbSub;++i)
@@ -27,12 +25,15 @@ int main(int argc, char ** argv)
         	start = atoi(argv[3*i+2]);
         	stop = atoi(argv[3*i+3]);
         	av = atoi(argv[3*i+4]);
+        	//only the time steps of the sub interval are in memory
+        	DynamicParticles parts(filename, Interval(start, stop+av));
         	if(start+1>parts.getNbTimeSteps() || stop+av+1>parts.getNbTimeSteps())
 				throw invalid_argument
 				(
 					(boost::format("[%1%,%2%] not included in [0,%3%]") % start % (stop+av) % (parts.getNbTimeSteps()-1)).str()
 				);
 			cout<<"["<<start<<","<<stop<<"] <"<<av<<">" << endl;
+			parts.removeDrift();
         	MSD = parts.getMSD(start,stop,av);
 
         	//export to file
@@ -0,0 +1,72 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "ageing.hpp"
+#include "instrument.hpp"
+#include <boost/format.hpp>
+
+using namespace std;
+using namespace Colloids;
+
+int main(int argc, char ** argv)
+{
+    Instrument::setToolName("ageing");
+    if(argc<5 || (argc-2)%3)
+    {
+        cout << "compute MSD, non Gaussian parameter and self ISF for many sub-time intervals in a single pass"<<endl;
+        cout << "Syntax : ageing [path]filename.traj start1 stop1 av1 [start2 stop2 av2 [...]]" << endl;
+        cout << "\tav>0 averages over the time origins start to start+av-1, av=0 over all the intervals inside [start, stop]" << endl;
+        cout << "Output: .ageing binary file, see ageing.hpp for the layout" << endl;
+        return EXIT_FAILURE;
+    }
+
+    const string filename(argv[1]);
+    const string inputPath = filename.substr(0,filename.find_last_of("."));
+    const size_t nbSub = (argc-2)/3;
+
+    try
+    {
+        vector<AgeingWindow> windows(nbSub);
+        size_t first = atoi(argv[2]), last = 0;
+        for(size_t i=0;i<nbSub;++i)
+        {
+            windows[i] = AgeingWindow(atoi(argv[3*i+2]), atoi(argv[3*i+3]), atoi(argv[3*i+4]));
+            first = min(first, windows[i].start);
+            last = max(last, windows[i].last());
+        }
+        //only the time steps of the union of the windows are in memory
+        DynamicParticles parts(filename, Interval(first, last));
+        if(last+1>parts.getNbTimeSteps())
+            throw invalid_argument
+            (
+                (boost::format("[%1%,%2%] not included in [0,%3%]") % first % last % (parts.getNbTimeSteps()-1)).str()
+            );
+        cout << nbSub << " windows in [" << first << "," << last << "]" << endl;
+        parts.removeDrift();
+
+        const AgeingDynamics ageing(parts, windows);
+        ageing.exportBinary(inputPath+".ageing");
+    }
+    catch(const std::exception &e)
+    {
+        cerr<<e.what() << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
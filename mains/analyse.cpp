@@ -0,0 +1,176 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "frameAnalysis.hpp"
+#include "files_series.hpp"
+#include "instrument.hpp"
+#include <boost/progress.hpp>
+#include <boost/program_options.hpp>
+#include <boost/tokenizer.hpp>
+
+namespace po = boost::program_options;
+using namespace std;
+using namespace Colloids;
+
+void exportBoo(const vector<BooData> &qlm, const string &qlmName, const string &cloudName, const string &header)
+{
+    if(!qlmName.empty())
+    {
+        ofstream qlmFile(qlmName.c_str(), ios::out | ios::trunc);
+        copy(qlm.begin(), qlm.end(), ostream_iterator<BooData>(qlmFile,"\n"));
+    }
+    ofstream cloudFile(cloudName.c_str(), ios::out | ios::trunc);
+    cloudFile<<header<<endl;
+    transform(qlm.begin(), qlm.end(), ostream_iterator<string>(cloudFile,"\n"), cloud_exporter());
+}
+
+/** \brief compute the products of a frame and write them with the same names as the single purpose programs */
+void analyse(const string &filename, const double &radius, const FrameAnalysis::Products &products, FrameAnalysis::Options options, const bool recompute, const bool cache)
+{
+    const string inputPath = filename.substr(0,filename.find_last_of("."));
+    const string head = filename.substr(0,filename.rfind("_t"));
+    const string neck = filename.substr(head.size(), inputPath.size()-head.size());
+    if(!recompute)
+        options.bondsFile = inputPath+".bonds";
+    if(cache)
+    {
+        options.cacheFile = inputPath+".cache";
+        options.cacheKey = frameCacheKey(filename, radius, options.bondLength);
+    }
+
+    Particles parts(filename, radius);
+    FrameAnalysis analysis(parts, options);
+    analysis.require(products);
+    analysis.run();
+
+    if(products[FrameAnalysis::bonds] && !analysis.bondsLoaded())
+        saveBonds(inputPath+".bonds", analysis.getBonds());
+    if(products[FrameAnalysis::rdf])
+    {
+        ofstream output((inputPath + ".rdf").c_str(), ios::out | ios::trunc);
+        output<<"#r\tg"<<endl;
+        const double scale = options.rdfBins/options.rdfRange;
+        for(size_t r=0;r<analysis.getRdf().size();++r)
+            output<< r/scale <<"\t"<< analysis.getRdf()[r] << "\n";
+    }
+    if(products[FrameAnalysis::qlm])
+        exportBoo(analysis.getQlm(), inputPath+".qlm", inputPath+".cloud", "#q4\tq6\tq8\tq10\tw4\tw6\tw8\tw10");
+    if(products[FrameAnalysis::cg_qlm])
+        exportBoo(analysis.getCgQlm(), head+"_space"+neck+".qlm", head+"_space"+neck+".cloud", "#Q4\tQ6\tQ8\tQ10\tW4\tW6\tW8\tW10");
+    if(products[FrameAnalysis::surf_qlm])
+        exportBoo(analysis.getSurfQlm(), "", head+"_surf"+neck+".cloud", "#q4\tq6\tq8\tq10\tw4\tw6\tw8\tw10");
+    if(products[FrameAnalysis::cna])
+    {
+        ofstream output((inputPath+".n7a").c_str(), ios::out | ios::trunc);
+        copy(analysis.getCna().begin(), analysis.getCna().end(), ostream_iterator<size_t>(output, "\n"));
+    }
+    if(products[FrameAnalysis::clusters])
+    {
+        const vector< vector<size_t> > &members = analysis.getClusters();
+        ofstream output((inputPath+".cluster").c_str(), ios::out | ios::trunc);
+        output<<members.size()<<"\n";
+        for(size_t K=0; K<members.size(); ++K)
+        {
+            output<<K<<"\t"<<members[K].size()<<"\t";
+            copy(members[K].begin(), members[K].end(), ostream_iterator<size_t>(output, "\t"));
+            output<<"\n";
+        }
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    Instrument::setToolName("analyse");
+    try
+    {
+        string filename, token, productList;
+        double radius;
+        size_t t_offset;
+        FrameAnalysis::Options options;
+        po::options_description
+            compulsory_options("Compulsory options"),
+            additional_options("Additional options"),
+            cmdline_options("Command-line options");
+        compulsory_options.add_options()
+            ("input", po::value<string>(&filename), "input file or pattern")
+            ("products", po::value<string>(&productList), "comma separated list among bonds, rdf, qlm, surf_qlm, cg_qlm, cna, clusters")
+            ;
+        po::positional_options_description pd;
+        pd.add("input", 1);
+        pd.add("products", 1);
+        additional_options.add_options()
+            ("help", "produce help message")
+            ("radius", po::value<double>(&radius)->default_value(1.0), "radius of the particles")
+            ("bondLength", po::value<double>(&options.bondLength)->default_value(1.3), "maximum bond length, in diameter unit")
+            ("rdfBins", po::value<size_t>(&options.rdfBins)->default_value(200), "number of bins of the g(r)")
+            ("rdfRange", po::value<double>(&options.rdfRange)->default_value(15.0), "range of the g(r), in diameter unit")
+            ("clusterQ6", po::value<double>(&options.clusterQ6)->default_value(0.25), "coarse grained Q6 above which a particle belongs to a cluster")
+            ("noZ", "the boundaries perpendicular to z are not walls")
+            ("recompute", "compute the bonds even if a .bonds file exists")
+            ("cache", "keep the spatial index and the neighbours in a .cache file, to skip building them on the next runs")
+            ("token", po::value<string>(&token)->default_value("_t"), "Token delimiting time step number (for time series only)")
+            ("span", po::value<size_t>(), "Number of time steps to process (compulsory for time series)")
+            ("offset", po::value<size_t>(&t_offset)->default_value(0), "Starting time step")
+            ;
+
+        cmdline_options.add(compulsory_options).add(additional_options);
+
+        po::variables_map vm;
+        po::store(po::command_line_parser(argc, argv).
+                  options(cmdline_options).positional(pd).run(), vm);
+
+        if (vm.count("help") || !vm.count("input") || !vm.count("products"))
+        {
+            cout << "analyse input products [options]\n";
+            cout << "Compute several analyses of each frame in a single pass, sharing the spatial index, the bonds and the qlm.\n";
+            cout << "The outputs have the same names and formats as the programs bonds, rdf, boo and sp5c (.n7a).\n";
+            cout << "The clusters of crystalline particles are exported to .cluster\n";
+            cout << "With --cache, the .cache file is valid as long as the coordinates, the radius and the bond length do not change.\n";
+            cout << cmdline_options << "\n";
+            return EXIT_SUCCESS;
+        }
+        po::notify(vm);
+        options.noZ = vm.count("noZ");
+
+        FrameAnalysis::Products products;
+        boost::char_separator<char> sep(",");
+        boost::tokenizer< boost::char_separator<char> > names(productList, sep);
+        for(boost::tokenizer< boost::char_separator<char> >::const_iterator n=names.begin(); n!=names.end(); ++n)
+            products.set(FrameAnalysis::parseProduct(*n));
+
+        if(vm.count("span"))
+        {
+            FileSerie datSerie(filename, token, vm["span"].as<size_t>(), t_offset);
+            boost::progress_display show_progress(vm["span"].as<size_t>());
+            for(size_t t=0; t<vm["span"].as<size_t>(); ++t)
+            {
+                analyse(datSerie%t, radius, products, options, vm.count("recompute"), vm.count("cache"));
+                ++show_progress;
+            }
+        }
+        else
+            analyse(filename, radius, products, options, vm.count("recompute"), vm.count("cache"));
+    }
+    catch(const exception &e)
+    {
+        cerr<< e.what()<<endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "bondLife.hpp"
+
+#include <boost/progress.hpp>
+
+using namespace std;
+using namespace Colloids;
+
+int main(int argc, char ** argv)
+{
+    if(argc<2)
+    {
+    	cerr<<"bondlife [path]filename.traj" << endl;
+    	cerr<<"Follow the bonds (.bonds files) between trajectories and output"<<endl;
+    	cerr<<"\t.bondlife\tbinary event log, 4 uint32 per event: time, trajectory, trajectory, type (0 birth, 1 death, 2 censored, 3 formed before first seen)"<<endl;
+    	cerr<<"\t.blt\thistogram of bond lifetimes: lifetime, born and broken, censored at either end (lower bounds)"<<endl;
+    	cerr<<"\t.bbd\tnumber of bond births and deaths per frame"<<endl;
+    	cerr<<"\t.nrf\tbroken bonds that never reformed: trajectory, trajectory, time of breaking"<<endl;
+		return EXIT_FAILURE;
+    }
+    const string filename(argv[1]);
+    const string inputPath = filename.substr(0,filename.find_last_of("."));
+    const string path = filename.substr(0, filename.find_last_of("/\\")+1);
+
+    try
+    {
+    	//construct the trajectory index
+    	TrajIndex trajectories;
+    	double radius, dt;
+		string pattern, token;
+		size_t offset, size;
+		{
+			ifstream trajfile(filename.c_str(), ios::in);
+			if(!trajfile.good())
+				throw invalid_argument((filename+" doesn't exist").c_str() );
+			trajfile >> radius >> dt;
+			trajfile.ignore(1); //escape the endl
+			getline(trajfile, pattern); //pattern is on the 2nd line
+			getline(trajfile, token); //token is on the 3rd line
+			trajfile >> offset >> size;
+			trajfile >> trajectories;
+			trajfile.close();
+			trajectories.makeInverse(trajectories.getFrameSizes(size));
+		}
+		cout << trajectories.size() << " particles in "<<size<<" time steps"<<endl;
+		FileSerie datSerie(path+pattern, token, size, offset),
+			bondSerie = datSerie.changeExt(".bonds");
+
+		ofstream log((inputPath+".bondlife").c_str(), ios::out | ios::trunc | ios::binary);
+		BondLife life(trajectories, &log);
+		{
+			boost::progress_display show_progress(size);
+			for(size_t t=0; t<size; ++t)
+			{
+				life.push_back(loadBonds(bondSerie%t));
+				++show_progress;
+			}
+		}
+		life.finish();
+		log.close();
+		cout << life.getNbReformed() << " bonds reformed after breaking" << endl;
+
+		//lifetime histograms
+		{
+			const vector<size_t> &broken = life.getLifetimes(), &censored = life.getCensoredLifetimes();
+			ofstream f((inputPath+".blt").c_str(), ios::out | ios::trunc);
+			f << "#t\tbroken\tcensored\n";
+			for(size_t l=1; l<max(broken.size(), censored.size()); ++l)
+				f << l*dt << "\t"
+					<< (l<broken.size() ? broken[l] : 0) << "\t"
+					<< (l<censored.size() ? censored[l] : 0) << "\n";
+		}
+		//births and deaths
+		{
+			ofstream f((inputPath+".bbd").c_str(), ios::out | ios::trunc);
+			f << "#t\tbirths\tdeaths\n";
+			for(size_t t=0; t<size; ++t)
+				f << t*dt << "\t" << life.getNbBirths()[t] << "\t" << life.getNbDeaths()[t] << "\n";
+		}
+		//never reformed bonds
+		{
+			const vector< pair<Bond, size_t> > nr = life.getNeverReformed();
+			ofstream f((inputPath+".nrf").c_str(), ios::out | ios::trunc);
+			for(size_t b=0; b<nr.size(); ++b)
+				f << nr[b].first << "\t" << nr[b].second << "\n";
+			cout << nr.size() << " bonds never reformed" << endl;
+		}
+	}
+    catch(const exception &e)
+    {
+        cerr<< e.what()<<endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
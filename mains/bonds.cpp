@@ -54,9 +54,7 @@ int main(int argc, char ** argv)
 		}
 		parts.makeNgbList(maxBondLength);
 		bonds = parts.getBonds();
-		ofstream output((inputPath + ".bonds").c_str(), ios::out | ios::trunc);
-		for(BondSet::const_iterator b=bonds.begin(); b!= bonds.end();++b)
-			output<<b->low()<<" "<<b->high()<<"\n";
+		saveBonds(inputPath + ".bonds", bonds);
     }
     catch(const exception &e)
     {
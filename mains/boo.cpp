@@ -22,6 +22,7 @@
 //#include "pv.hpp"
 #include "dynamicParticles.hpp"
 #include <boost/progress.hpp>
+#include "instrument.hpp"
 
 using namespace std;
 using namespace Colloids;
@@ -49,9 +50,7 @@ void calculateBoo(Particles &parts, const string& filename, const bool noZ=false
         parts.makeRTreeIndex();
         parts.makeNgbList(1.3);
         BondSet bonds = parts.getBonds();
-        ofstream bondFile((inputPath+".bonds").c_str(), ios::out | ios::trunc);
-        for(BondSet::const_iterator b=bonds.begin(); b!= bonds.end();++b)
-            bondFile<<b->low()<<" "<<b->high()<<"\n";
+        saveBonds(inputPath+".bonds", bonds);
         inside = parts.selectInside(1.3*parts.radius, noZ);
         secondInside = parts.selectInside(2.0*1.3*parts.radius, noZ);
         if(!quiet) delete ti;
@@ -135,6 +134,7 @@ void calculateBoo(Particles &parts, const string& filename, const bool noZ=false
 
 int main(int argc, char ** argv)
 {
+    Instrument::setToolName("boo");
 #ifdef use_periodic
 	if(argc<7)
 	{
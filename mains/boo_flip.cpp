@@ -80,9 +80,7 @@ int main(int argc, char ** argv)
 			parts.makeRTreeIndex();
 			parts.makeNgbList(1.3);
 			bonds = parts.getBonds();
-			ofstream bondFile((inputPath+".bonds").c_str(), ios::out | ios::trunc);
-			for(BondSet::const_iterator b=bonds.begin(); b!= bonds.end();++b)
-				bondFile<<b->low()<<" "<<b->high()<<"\n";
+			saveBonds(inputPath+".bonds", bonds);
 			inside = parts.selectInside(1.3*radius);
 			secondInside = parts.selectInside(2.0*1.3*radius);
 		}
@@ -0,0 +1,145 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "distributed.hpp"
+#include "instrument.hpp"
+#include <boost/program_options.hpp>
+#include <fstream>
+
+namespace po = boost::program_options;
+using namespace std;
+using namespace Colloids;
+
+int main(int ac, char* av[])
+{
+    MPI_Init(&ac, &av);
+    Instrument::setToolName("mpi_analyse");
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    try
+    {
+        string filename;
+        double radius;
+        size_t nbBins;
+        DistributedFrame::Options options;
+        po::options_description
+            compulsory_options("Compulsory options"),
+            additional_options("Additional options"),
+            cmdline_options("Command-line options");
+        compulsory_options.add_options()
+            ("input", po::value<string>(&filename), "coordinates file (.dat)")
+            ("radius", po::value<double>(&radius), "radius of the particles")
+            ;
+        po::positional_options_description pd;
+        pd.add("input", 1);
+        pd.add("radius", 1);
+        additional_options.add_options()
+            ("help", "produce help message")
+            ("periodic", "periodic boundary conditions, the period being the box of the file")
+            ("bondLength", po::value<double>(&options.bondLength)->default_value(1.3), "maximum bond length, in diameters")
+            ("rdfBins", po::value<size_t>(&options.rdfBins)->default_value(200), "number of bins of the g(r). 0 to skip the g(r)")
+            ("rdfRange", po::value<double>(&options.rdfRange)->default_value(15.0), "range of the g(r), in diameters")
+            ("clusterQ6", po::value<double>(&options.clusterQ6)->default_value(0.25), "coarse grained Q6 above which a particle belongs to a cluster")
+            ("qlBins", po::value<size_t>(&nbBins)->default_value(100), "number of bins of the Ql histograms")
+            ("noZ", "do not consider the boundaries perpendicular to z as walls")
+            ;
+        cmdline_options.add(compulsory_options).add(additional_options);
+
+        po::variables_map vm;
+        po::store(po::command_line_parser(ac, av).options(cmdline_options).positional(pd).run(), vm);
+        if(vm.count("help") || !vm.count("input") || !vm.count("radius"))
+        {
+            if(!rank)
+            {
+                cout << "mpirun -np N mpi_analyse input radius [options]\n";
+                cout << "Analyse a single frame distributed over N processes, each owning a domain of the box.\n";
+                cout << "Output files (written by the process of rank 0)\n";
+                cout << "\t.rdf\tradial distribution function\n";
+                cout << "\t.qlh\thistograms of q4 q6 q8 q10 and of the coarse grained Q4 Q6 Q8 Q10\n";
+                cout << "\t.clsize\tlabel (smallest position of the members in the file) and size of each cluster\n";
+                cout << cmdline_options << "\n";
+            }
+            MPI_Finalize();
+            return EXIT_SUCCESS;
+        }
+        po::notify(vm);
+        options.periodic = !!vm.count("periodic");
+        options.noZ = !!vm.count("noZ");
+        const string inputPath = filename.substr(0,filename.find_last_of("."));
+
+        DistributedFrame frame(MPI_COMM_WORLD, filename, radius, options);
+        size_t ghosts = frame.getNbGhosts();
+        MPI_Reduce(rank ? &ghosts : MPI_IN_PLACE, &ghosts, 1, mpiType(&ghosts), MPI_SUM, 0, MPI_COMM_WORLD);
+        if(!rank)
+            cout << frame.getGlobalSize() << " particles on " << frame.getNbProcesses() << " processes, "
+                << ghosts << " ghosts within " << frame.getHalo() << endl;
+
+        if(options.rdfBins)
+        {
+            const vector<double> g = frame.getRdf();
+            if(!rank)
+            {
+                ofstream output((inputPath + ".rdf").c_str(), ios::out | ios::trunc);
+                output<<"#r\tg"<<endl;
+                const double scale = options.rdfBins/options.rdfRange;
+                for(size_t r=0;r<g.size();++r)
+                    output<< r/scale <<"\t"<< g[r] << "\n";
+            }
+        }
+
+        frame.computeBOOs();
+        vector< vector<size_t> > hist;
+        for(int coarse=0; coarse<2; ++coarse)
+            for(size_t l=4; l<=10; l+=2)
+                hist.push_back(frame.getQlHistogram(l, coarse, nbBins));
+        if(!rank)
+        {
+            ofstream output((inputPath + ".qlh").c_str(), ios::out | ios::trunc);
+            output<<"#Ql\tq4\tq6\tq8\tq10\tQ4\tQ6\tQ8\tQ10"<<endl;
+            for(size_t b=0; b<nbBins; ++b)
+            {
+                output << (b+0.5)/nbBins;
+                for(size_t h=0; h<hist.size(); ++h)
+                    output << "\t" << hist[h][b];
+                output << "\n";
+            }
+        }
+
+        const vector< pair<size_t, size_t> > sizes = frame.getClusterSizes(frame.getClusterLabels());
+        if(!rank)
+        {
+            ofstream output((inputPath + ".clsize").c_str(), ios::out | ios::trunc);
+            output<<"#label\tsize"<<endl;
+            size_t largest = 0;
+            for(size_t K=0; K<sizes.size(); ++K)
+            {
+                output << sizes[K].first << "\t" << sizes[K].second << "\n";
+                largest = max(largest, sizes[K].second);
+            }
+            cout << sizes.size() << " clusters, the largest having " << largest << " particles" << endl;
+        }
+    }
+    catch(const exception &e)
+    {
+        cerr << "process " << rank << ": " << e.what() << endl;
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+    MPI_Finalize();
+    return EXIT_SUCCESS;
+}
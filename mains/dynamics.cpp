@@ -18,12 +18,14 @@
 **/
 
 #include "dynamicParticles.hpp"
+#include "instrument.hpp"
 
 using namespace std;
 using namespace Colloids;
 
 int main(int argc, char ** argv)
 {
+    Instrument::setToolName("dynamics");
     if(argc<3)
     {
         cout << "compute both Mean Square displacement and Self Intermediate scattering function for maximum averaging."<<endl;
@@ -31,6 +33,7 @@ int main(int argc, char ** argv)
         cout<<"\tmode=0\t No drift removal"<<endl;
         cout<<"\tmode=1\t Drift removed (default)"<<endl;
         cout<<"\tmode=2\t 0 then 1"<<endl;
+        cout<<"\tmode=3\t Drift removed, relative to the neighbours at the time origin. Optional bond length (in diameters, default 1.3)"<<endl;
         return EXIT_FAILURE;
     }
 
@@ -53,6 +56,23 @@ int main(int argc, char ** argv)
             cout<<"ok"<<endl;
             parts.exportDynamics(inputPath);
         }
+        if(mode==3)
+        {
+            const double bondLength = (argc>3)?atof(argv[3]):1.3;
+            cout <<"Removing drift ... ";
+            parts.removeDrift();
+            cout<<"ok"<<endl;
+            cout <<"Neighbour lists ... ";
+            #pragma omp parallel for schedule(dynamic)
+            for(int t=0; t<(int)parts.getNbTimeSteps(); ++t)
+            {
+                if(!parts.positions[t].hasIndex())
+                    parts.positions[t].makeRTreeIndex();
+                parts.positions[t].makeNgbList(bondLength);
+            }
+            cout<<"ok"<<endl;
+            parts.exportDynamics(inputPath+"_cage", true);
+        }
     }
     catch(const std::exception &e)
     {
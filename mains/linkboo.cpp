@@ -200,9 +200,7 @@ int main(int argc, char ** argv)
 				//create neighbour list and export bonds
 				positions[t].makeNgbList(bondLength);
 				bonds = positions[t].getBonds();
-				ofstream bondFile((bondSerie%t).c_str(), ios::out | ios::trunc);
-				copy(bonds.begin(), bonds.end(), ostream_iterator<Bond>(bondFile, "\n"));
-				bondFile.close();
+				saveBonds(bondSerie%t, bonds);
 
 				//select the particles further than the bond length from the boundaries
 				inside = positions[t].selectInside(bondLength);
@@ -19,12 +19,14 @@
 
 
 #include "dynamicParticles.hpp"
+#include "instrument.hpp"
 
 using namespace std;
 using namespace Colloids;
 
 int main(int argc, char ** argv)
 {
+    Instrument::setToolName("linker");
     if(argc<5)
     {
         cout << "Syntax : linker [path]filename token radius time_step t_span t_offset(0)" << endl;
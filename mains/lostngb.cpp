@@ -54,15 +54,21 @@ void export_post_lostNgb(const TrajIndex &trajectories, const size_t &tau, FileS
 		{
 		    bondfile = bondSerie%t;
 		}
-		ifstream f(bondfile.c_str());
-		size_t a,b;
-		while(f.good())
+		BondSet bonds;
+		try
+		{
+			bonds = loadBonds(bondfile);
+		}
+		catch(const exception &e)
+		{
+			#pragma omp critical
+			cerr<<e.what()<<endl;
+		}
+		for(BondSet::const_iterator b=bonds.begin(); b!=bonds.end(); ++b)
 		{
-			f>>a>>b;
-			easy[a].push_back(trajectories.getInverse(t)[b]);
-			easy[b].push_back(trajectories.getInverse(t)[a]);
+			easy[b->low()].push_back(trajectories.getInverse(t)[b->high()]);
+			easy[b->high()].push_back(trajectories.getInverse(t)[b->low()]);
 		}
-		f.close();
 
 
 		//#pragma omp parallel for shared(easy, dyn) schedule(dynamic)
@@ -0,0 +1,183 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "frameAnalysis.hpp"
+#include "nuclei.hpp"
+#include "files_series.hpp"
+#include "instrument.hpp"
+#include <boost/progress.hpp>
+#include <boost/program_options.hpp>
+#include <boost/scoped_ptr.hpp>
+
+namespace po = boost::program_options;
+using namespace std;
+using namespace Colloids;
+
+/** \brief find the nuclei of a frame, export them and append a line to the summary */
+void nuclei(const string &filename, const double &radius, FrameAnalysis::Options analysisOptions, const NucleusFinder::Options &options,
+	const bool recompute, NucleusTracker *tracker, const size_t &t, ostream &summary)
+{
+	const string inputPath = filename.substr(0,filename.find_last_of("."));
+	if(!recompute)
+		analysisOptions.bondsFile = inputPath+".bonds";
+
+	Particles parts(filename, radius);
+	FrameAnalysis analysis(parts, analysisOptions);
+	analysis.require(FrameAnalysis::bonds);
+	analysis.require(FrameAnalysis::qlm);
+	analysis.run();
+
+	const NucleusFinder finder(parts, analysis.getQlm(), options);
+	const vector< vector<size_t> > &nuclei = finder.getNuclei();
+	vector<size_t> ids(nuclei.size());
+	if(tracker)
+		ids = tracker->push_back(nuclei);
+	else
+		for(size_t k=0; k<ids.size(); ++k)
+			ids[k] = k;
+
+	size_t largest = 0;
+	{
+		ofstream output((inputPath+".nuclei").c_str(), ios::out | ios::trunc);
+		output<<"#id\tsize\tmembers"<<endl;
+		for(size_t k=0; k<nuclei.size(); ++k)
+		{
+			output<<ids[k]<<"\t"<<nuclei[k].size()<<"\t";
+			copy(nuclei[k].begin(), nuclei[k].end(), ostream_iterator<size_t>(output, "\t"));
+			output<<"\n";
+			if(nuclei[k].size() > nuclei[largest].size())
+				largest = k;
+		}
+	}
+	{
+		const vector<size_t> distribution = finder.getSizeDistribution();
+		ofstream output((inputPath+".nsd").c_str(), ios::out | ios::trunc);
+		output<<"#size\tcount"<<endl;
+		for(size_t s=1; s<distribution.size(); ++s)
+			if(distribution[s])
+				output<<s<<"\t"<<distribution[s]<<"\n";
+	}
+	summary<<t<<"\t"<<finder.getNbSolid()<<"\t"<<nuclei.size()<<"\t"<<finder.getLargest();
+	if(tracker)
+		summary<<"\t"<<(nuclei.empty() ? -1 : (long)ids[largest]);
+	summary<<endl;
+}
+
+int main(int argc, char ** argv)
+{
+    Instrument::setToolName("nuclei");
+    try
+    {
+        string filename, token, trajFilename;
+        double radius;
+        size_t t_offset;
+        FrameAnalysis::Options analysisOptions;
+        NucleusFinder::Options options;
+        po::options_description
+            compulsory_options("Compulsory options"),
+            additional_options("Additional options"),
+            cmdline_options("Command-line options");
+        compulsory_options.add_options()
+            ("input", po::value<string>(&filename), "input file or pattern")
+            ;
+        po::positional_options_description pd;
+        pd.add("input", 1);
+        additional_options.add_options()
+            ("help", "produce help message")
+            ("radius", po::value<double>(&radius)->default_value(1.0), "radius of the particles")
+            ("bondLength", po::value<double>(&analysisOptions.bondLength)->default_value(1.3), "maximum bond length, in diameter unit")
+            ("threshold", po::value<double>(&options.threshold)->default_value(0.7), "normalised q6 product above which two bonded particles are connected")
+            ("connections", po::value<size_t>(&options.minConnections)->default_value(7), "number of connections from which a particle is solid-like")
+            ("noZ", "the boundaries perpendicular to z are not walls")
+            ("recompute", "compute the bonds even if a .bonds file exists")
+            ("traj", po::value<string>(&trajFilename), "trajectory file (.traj) to follow the nuclei in time. It must start at or before the first frame processed")
+            ("token", po::value<string>(&token)->default_value("_t"), "Token delimiting time step number (for time series only)")
+            ("span", po::value<size_t>(), "Number of time steps to process (compulsory for time series)")
+            ("offset", po::value<size_t>(&t_offset)->default_value(0), "Starting time step")
+            ;
+
+        cmdline_options.add(compulsory_options).add(additional_options);
+
+        po::variables_map vm;
+        po::store(po::command_line_parser(argc, argv).
+                  options(cmdline_options).positional(pd).run(), vm);
+
+        if (vm.count("help") || !vm.count("input"))
+        {
+            cout << "nuclei input [options]\n";
+            cout << "Find the crystal nuclei of each frame: the bonded particles whose normalised q6 product is above the threshold are connected,\n";
+            cout << "the particles having enough connections are solid-like, and the nuclei are the clusters of bonded solid-like particles.\n";
+            cout << "Output files\n";
+            cout << "\t.nuclei\tid, size and members of each nucleus. With --traj, a nucleus keeps its id from frame to frame\n";
+            cout << "\t.nsd\tnuclei size distribution\n";
+            cout << "\t.nucleation\tfor each frame, number of solid-like particles, number of nuclei, size (and id) of the largest\n";
+            cout << cmdline_options << "\n";
+            return EXIT_SUCCESS;
+        }
+        po::notify(vm);
+        analysisOptions.noZ = vm.count("noZ");
+
+        TrajIndex trajectories;
+        boost::scoped_ptr<NucleusTracker> tracker;
+        if(vm.count("traj"))
+        {
+            ifstream trajfile(trajFilename.c_str(), ios::in);
+            if(!trajfile.good())
+                throw invalid_argument((trajFilename+" doesn't exist").c_str() );
+            double trajRadius, dt;
+            string pattern, trajToken;
+            size_t offset, size;
+            trajfile >> trajRadius >> dt;
+            trajfile.ignore(1); //escape the endl
+            getline(trajfile, pattern); //pattern is on the 2nd line
+            getline(trajfile, trajToken); //token is on the 3rd line
+            trajfile >> offset >> size;
+            trajfile >> trajectories;
+            if(t_offset < offset)
+                throw invalid_argument("the trajectories start after the first frame processed");
+            trajectories.makeInverse(trajectories.getFrameSizes(size));
+            tracker.reset(new NucleusTracker(trajectories, t_offset - offset));
+        }
+
+        if(vm.count("span"))
+        {
+            FileSerie datSerie(filename, token, vm["span"].as<size_t>(), t_offset);
+            ofstream summary((datSerie.head()+".nucleation").c_str(), ios::out | ios::trunc);
+            summary<<"#t\tsolid\tnuclei\tlargest"<<(tracker ? "\tid" : "")<<endl;
+            boost::progress_display show_progress(vm["span"].as<size_t>());
+            for(size_t t=0; t<vm["span"].as<size_t>(); ++t)
+            {
+                nuclei(datSerie%t, radius, analysisOptions, options, vm.count("recompute"), tracker.get(), t+t_offset, summary);
+                ++show_progress;
+            }
+        }
+        else
+        {
+            ofstream summary((filename.substr(0,filename.find_last_of("."))+".nucleation").c_str(), ios::out | ios::trunc);
+            summary<<"#t\tsolid\tnuclei\tlargest"<<(tracker ? "\tid" : "")<<endl;
+            nuclei(filename, radius, analysisOptions, options, vm.count("recompute"), tracker.get(), t_offset, summary);
+        }
+    }
+    catch(const exception &e)
+    {
+        cerr<< e.what()<<endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
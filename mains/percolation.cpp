@@ -85,9 +85,7 @@ int main(int argc, char ** argv)
 				parts.positions[t].makeRTreeIndex();
 				parts.positions[t].makeNgbList(1.3);
 				BondSet bonds = parts.positions[t].getBonds();
-				ofstream bondFile((inputPath+".bonds").c_str(), ios::out | ios::trunc);
-				for(BondSet::const_iterator b=bonds.begin(); b!= bonds.end();++b)
-					bondFile<<b->low()<<" "<<b->high()<<"\n";
+				saveBonds(inputPath+".bonds", bonds);
 			}
 		}
 
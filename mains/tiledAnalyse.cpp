@@ -0,0 +1,107 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "tiledFrame.hpp"
+#include "instrument.hpp"
+#include <boost/program_options.hpp>
+#include <fstream>
+
+namespace po = boost::program_options;
+using namespace std;
+using namespace Colloids;
+
+int main(int ac, char* av[])
+{
+    Instrument::setToolName("tiled_analyse");
+    try
+    {
+        string filename;
+        double radius, memory;
+        TiledFrame::Options options;
+        po::options_description
+            compulsory_options("Compulsory options"),
+            additional_options("Additional options"),
+            cmdline_options("Command-line options");
+        compulsory_options.add_options()
+            ("input", po::value<string>(&filename), "coordinates file (.dat)")
+            ("radius", po::value<double>(&radius), "radius of the particles")
+            ;
+        po::positional_options_description pd;
+        pd.add("input", 1);
+        pd.add("radius", 1);
+        additional_options.add_options()
+            ("help", "produce help message")
+            ("periodic", "periodic boundary conditions, the period being the box of the file")
+            ("bondLength", po::value<double>(&options.bondLength)->default_value(1.3), "maximum bond length, in diameters")
+            ("rdfBins", po::value<size_t>(&options.rdfBins)->default_value(200), "number of bins of the g(r). 0 to skip the g(r)")
+            ("rdfRange", po::value<double>(&options.rdfRange)->default_value(15.0), "range of the g(r), in diameters")
+            ("noBoo", "skip the bond orientational order")
+            ("noZ", "do not consider the boundaries perpendicular to z as walls")
+            ("memory", po::value<double>(&memory)->default_value(1024.0), "memory budget of the tiles analysed concurrently, in MB")
+            ("tileWidth", po::value<double>(&options.tileWidth)->default_value(0.0), "width of the tiles in diameters, halo excluded. 0 to deduce it from the memory budget")
+            ("tiles", po::value<string>(&options.tilePrefix), "path and prefix of the temporary tile files (default: the input without extension)")
+            ;
+        cmdline_options.add(compulsory_options).add(additional_options);
+
+        po::variables_map vm;
+        po::store(po::command_line_parser(ac, av).options(cmdline_options).positional(pd).run(), vm);
+        if(vm.count("help") || !vm.count("input") || !vm.count("radius"))
+        {
+            cout << "tiled_analyse input radius [options]\n";
+            cout << "Analyse a frame too large for the memory, tile by tile. The tiles are stored in temporary files.\n";
+            cout << "Output files, with the same names as analyse\n";
+            cout << "\t.rdf\tradial distribution function\n";
+            cout << "\t.cloud\tq4 q6 q8 q10 w4 w6 w8 w10\n";
+            cout << "\t_space.cloud\tthe same, coarse grained\n";
+            cout << cmdline_options << "\n";
+            return EXIT_SUCCESS;
+        }
+        po::notify(vm);
+        options.periodic = !!vm.count("periodic");
+        options.noZ = !!vm.count("noZ");
+        options.boo = !vm.count("noBoo");
+        options.memoryBudget = (size_t)(memory * (1<<20));
+
+        const string inputPath = filename.substr(0,filename.find_last_of("."));
+        const string head = filename.substr(0,filename.rfind("_t"));
+        const string neck = filename.substr(head.size(), inputPath.size()-head.size());
+
+        TiledFrame frame(filename, radius, options);
+        cout << frame.getGlobalSize() << " particles in " << frame.getNbTiles() << " tiles of at most "
+            << frame.getLargestTile() << " particles with their halo, " << frame.getNbConcurrent() << " at a time" << endl;
+        frame.run();
+
+        if(options.rdfBins)
+        {
+            ofstream output((inputPath + ".rdf").c_str(), ios::out | ios::trunc);
+            output<<"#r\tg"<<endl;
+            const double scale = options.rdfBins/options.rdfRange;
+            for(size_t r=0;r<frame.getRdf().size();++r)
+                output<< r/scale <<"\t"<< frame.getRdf()[r] << "\n";
+        }
+        if(options.boo)
+            frame.exportClouds(inputPath+".cloud", head+"_space"+neck+".cloud");
+    }
+    catch(const exception &e)
+    {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+/**
+    Copyright 2011 Mathieu Leocmach
+
+    This file is part of Colloids.
+
+    Colloids is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Colloids is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Colloids.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#include "timeCorrelation.hpp"
+
+#include <boost/progress.hpp>
+
+using namespace std;
+using namespace Colloids;
+
+int main(int argc, char ** argv)
+{
+    if(argc<3)
+    {
+    	cerr<<"timecorrelation [path]filename.traj maxLag [l=6 [postfix]]" << endl;
+    	cerr<<"Trajectory averaged time correlation of qlm (from the .qlm files, or postfix.qlm like _space)"<<endl;
+		return EXIT_FAILURE;
+    }
+    const string filename(argv[1]);
+    const string inputPath = filename.substr(0,filename.find_last_of("."));
+    const string path = filename.substr(0, filename.find_last_of("/\\")+1);
+    const size_t maxLag = atoi(argv[2]);
+    const size_t l = (argc>3)?atoi(argv[3]):6;
+    const string postfix = (argc>4)?argv[4]:"";
+
+    try
+    {
+    	if(l%2 || l>10)
+    		throw invalid_argument("l must be even and <= 10");
+    	//construct the trajectory index
+    	TrajIndex trajectories;
+    	double radius, dt;
+		string pattern, token;
+		size_t offset, size;
+		{
+			ifstream trajfile(filename.c_str(), ios::in);
+			if(!trajfile.good())
+				throw invalid_argument((filename+" doesn't exist").c_str() );
+			trajfile >> radius >> dt;
+			trajfile.ignore(1); //escape the endl
+			getline(trajfile, pattern); //pattern is on the 2nd line
+			getline(trajfile, token); //token is on the 3rd line
+			trajfile >> offset >> size;
+			trajfile >> trajectories;
+			trajfile.close();
+			trajectories.makeInverse(trajectories.getFrameSizes(size));
+		}
+		cout << trajectories.size() << " particles in "<<size<<" time steps"<<endl;
+		FileSerie datSerie(path+pattern, token, size, offset),
+			qlmSerie = datSerie.addPostfix(postfix, ".qlm");
+
+		TimeCorrelation cor(trajectories, min(maxLag, size-1), TimeCorrelation::booComponents(l));
+		{
+			boost::progress_display show_progress(size);
+			for(size_t t=0; t<size; ++t)
+			{
+				vector<BooData> qlm(trajectories.getInverse(t).size());
+				ifstream f((qlmSerie%t).c_str(), ios::in);
+				if(!f.good())
+					throw invalid_argument("no such file as "+qlmSerie%t);
+				for(size_t p=0; p<qlm.size() && f.good(); ++p)
+					f >> qlm[p];
+				cor.push_back(qlm, l);
+				++show_progress;
+			}
+		}
+		cor.finish();
+
+		const vector<size_t> lags = TimeCorrelation::logLags(cor.getMaxLag());
+		const vector<double> c = cor.get(lags);
+		ofstream out((inputPath+postfix+(boost::format("_q%1%")%l).str()+".tcor").c_str(), ios::out | ios::trunc);
+		out << "#t\tC\tC/C0\tpairs\n";
+		for(size_t i=0; i<lags.size(); ++i)
+			out << lags[i]*dt << "\t" << c[i] << "\t" << c[i]/c[0] << "\t" << cor.getNbPairs()[lags[i]] << "\n";
+	}
+    catch(const exception &e)
+    {
+        cerr<< e.what()<<endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
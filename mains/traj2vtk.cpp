@@ -373,18 +373,25 @@ int main(int argc, char ** argv)
 					tau = atoi(argv[2]);
                 cout<<"relaxation time is "<<tau<<" steps, ie "<<tau*dt<<"s"<<endl;
 				cout<<"calculate velocities"<<endl;
-				#pragma omp parallel for schedule(runtime) shared(parts, tau, velSerie)
-				for(size_t t=0; t<parts.getNbTimeSteps(); ++t)
-				{
-				    string velfile;
-				    #pragma omp critical
-				    {
-				        velfile = velSerie%t;
-				    }
-					vector<Coord> vel = parts.velocities(t, (tau+1)/2);
-					ofstream v_f(velfile.c_str(), ios::out | ios::trunc);
-					v_f << VectorField(vel.begin(), vel.end(), "V");
-					v_f.close();
+				//by blocks of frames to bound memory
+				const size_t block = 64;
+				vector<float> vel;
+				for(size_t t0=0; t0<parts.getNbTimeSteps(); t0+=block)
+				{
+					const size_t t1 = min(t0+block, parts.getNbTimeSteps());
+					vel.resize(3*parts.getNbPositions(t0, t1));
+					//the frames of the block may have no particle
+					if(!vel.empty())
+						parts.displacements(&vel[0], t0, t1, (tau+1)/2);
+					const float *v = vel.empty() ? 0 : &vel[0];
+					for(size_t t=t0; t<t1; ++t)
+					{
+						const size_t n = parts.trajectories.getInverse(t).size();
+						ofstream v_f((velSerie%t).c_str(), ios::out | ios::trunc);
+						toVTKvectors(v_f, "V", v, n);
+						v_f.close();
+						v += 3*n;
+					}
 				}
 			}
 		} //no more positions in memory
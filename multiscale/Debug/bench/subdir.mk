@@ -0,0 +1,21 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+CPP_SRCS += $(wildcard ../bench/*.cpp)
+
+OBJS += $(patsubst ../bench/%.cpp, ./bench/%.o, $(wildcard ../bench/*.cpp))
+
+CPP_DEPS += $(patsubst ../bench/%.cpp, ./bench/%.d, $(wildcard ../bench/*.cpp))
+
+
+# Each subdirectory must supply rules for building sources it contributes
+bench/%.o: ../bench/%.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: GCC C++ Compiler'
+	g++ -I/usr/local/include -g -Wall -c -fmessage-length=0 -mtune=native -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@:%.o=%.d)" -o"$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+
@@ -26,4 +26,5 @@ SUBDIRS := \
 . \
 src \
 test \
+bench \
 
@@ -0,0 +1,127 @@
+#include "../src/multiscalefinder.hpp"
+#include "../src/reconstructor.hpp"
+#include "../../bench/confocal.hpp"
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <fstream>
+
+using namespace Colloids;
+using namespace boost::posix_time;
+
+double elapsed(const ptime &past)
+{
+	return (microsec_clock::local_time() - past).total_microseconds() * 1e-6;
+}
+
+/**
+ * Time the stages of MultiscaleFinder3D::get_centers and of a LocatorFromLif-style reconstruction
+ * (MultiscaleFinder2D on each slice + Reconstructor) on synthetic confocal stacks.
+ * Each stage is scored against the ground truth.
+ */
+int main(int ac, char* av[]){
+	if(ac<2)
+	{
+		std::cerr<<"syntax: bench output.csv [nz ny nx [radius [frames [ZXratio]]]]"<<std::endl;
+		std::cerr<<"Default is a 64x128x128 stack of particles of radius 5 pixels, 3 frames, cubic voxels."<<std::endl;
+		return EXIT_FAILURE;
+	}
+	try {
+		ConfocalParameters param;
+		if(ac>4)
+		{
+			param.nz = boost::lexical_cast<size_t>(av[2]);
+			param.ny = boost::lexical_cast<size_t>(av[3]);
+			param.nx = boost::lexical_cast<size_t>(av[4]);
+		}
+		if(ac>5)
+			param.radius = boost::lexical_cast<double>(av[5]);
+		const size_t nbFrames = ac>6 ? boost::lexical_cast<size_t>(av[6]) : 3;
+		if(ac>7)
+			param.ZXratio = boost::lexical_cast<double>(av[7]);
+
+		std::ofstream out(av[1]);
+		if(!out.good())
+			throw std::invalid_argument((std::string("Cannot open ")+av[1]).c_str());
+		writeTrackingHeader(out);
+
+		ConfocalStack stack(param);
+		std::cout << stack.getSpheres().size() << " particles" << std::endl;
+		int dims[3] = {(int)param.nz, (int)param.ny, (int)param.nx};
+		//same settings as the multiscale executable without deconvolution
+		MultiscaleFinder3D finder3D(dims[0], dims[1], dims[2]);
+		finder3D.disable_Octave0();
+		finder3D.set_halfZpreblur(true);
+		MultiscaleFinder2D finder2D(dims[1], dims[2]);
+		Reconstructor rec;
+
+		//particles cut by the sides of the image are not expected to be found
+		boost::array<double,3> margin = {{param.radius, param.radius, param.radius}},
+			extent = {{(double)param.nx, (double)param.ny, param.nz*param.ZXratio}};
+		std::vector<unsigned char> data;
+		for(size_t t=0; t<nbFrames; ++t)
+		{
+			if(t)
+				stack.next();
+			stack.render(data);
+			cv::Mat_<uchar> image = cv::Mat(3, dims, CV_8UC1, &data[0]);
+
+			//3D multiscale tracking
+			{
+				std::vector<Center3D> centers;
+				double times[3];
+				ptime past = microsec_clock::local_time();
+				finder3D.fill(image);
+				times[0] = elapsed(past);
+				past = microsec_clock::local_time();
+				finder3D.initialize_binary();
+				times[1] = elapsed(past);
+				past = microsec_clock::local_time();
+				finder3D.subpix(centers);
+				times[2] = elapsed(past);
+				for(size_t c=0; c<centers.size(); ++c)
+					centers[c][2] *= param.ZXratio;
+				removeHalfOverlapping(centers);
+				const TrackingScore sc = score(stack.getSpheres(), centers.begin(), centers.end(), margin, extent);
+				const char* stages[3] = {"fill", "initialize_binary", "subpix"};
+				for(size_t s=0; s<3; ++s)
+					writeTrackingStage(out, "MultiscaleFinder3D", t, stages[s], times[s], stack.size(), sc);
+				writeTrackingStage(out, "MultiscaleFinder3D", t, "get_centers", times[0]+times[1]+times[2], stack.size(), sc);
+				std::cout << "3D t=" << t << " recall=" << sc.recall() << " precision=" << sc.precision() << " rms xy=" << sc.rmsXY << " z=" << sc.rmsZ << std::endl;
+			}
+			//2D tracking of each slice and reconstruction, as in LocatorFromLif
+			{
+				Reconstructor::OutputType centers;
+				double times[3] = {0.0, 0.0, 0.0};
+				rec.clear();
+				for(int z=0; z<dims[0]; ++z)
+				{
+					cv::Mat_<uchar> slice(dims[1], dims[2], &data[z*dims[1]*dims[2]]);
+					std::vector<Center2D> centers2D;
+					ptime past = microsec_clock::local_time();
+					finder2D.get_centers(slice, centers2D);
+					times[0] += elapsed(past);
+					past = microsec_clock::local_time();
+					rec.push_back(centers2D);
+					times[1] += elapsed(past);
+				}
+				ptime past = microsec_clock::local_time();
+				rec.get_blobs(centers);
+				times[2] = elapsed(past);
+				for(Reconstructor::OutputType::iterator c=centers.begin(); c!=centers.end(); ++c)
+					(*c)[2] *= param.ZXratio;
+				const TrackingScore sc = score(stack.getSpheres(), centers.begin(), centers.end(), margin, extent);
+				const char* stages[3] = {"get_centers2D", "push_back", "get_blobs"};
+				for(size_t s=0; s<3; ++s)
+					writeTrackingStage(out, "LocatorFromLif", t, stages[s], times[s], stack.size(), sc);
+				writeTrackingStage(out, "LocatorFromLif", t, "total", times[0]+times[1]+times[2], stack.size(), sc);
+				std::cout << "2D+reconstruction t=" << t << " recall=" << sc.recall() << " precision=" << sc.precision() << " rms xy=" << sc.rmsXY << " z=" << sc.rmsZ << std::endl;
+			}
+		}
+	}
+	catch(std::exception& e)
+	{
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -34,7 +34,9 @@ int main(int ac, char* av[]){
 					)
 			("incore",
 					"Do not use memory mapped file to store the data. If you have enough RAM this will speed up the calculation. If you don't it will trigger swapping and global slow down or even crash.\n"
-					"If the Octave0 option in ON, the 0th octave still uses memory mapped file.")
+					"If the Octave0 option in ON, the 0th octave still uses memory mapped file, unless Octave0-tile is set.")
+			("Octave0-tile", po::value<int>()->default_value(0),
+					"If the Octave0 option is ON, process the 0th octave in tiles of this size (in pixels of the input) plus an overlap, keeping a single tile in memory instead of the whole upsampled image. 0 to upsample the whole image.")
 			("deconvolution", po::value<int>()->default_value(0), "Whether to use or not deconvolution and where to get the deconvolution kernel:\n"
 					"(0) Do not use deconvolution."
 					"(1) Compute the kernel. This supposes the sample is physically isotropic but the image is not. If --deconvolution-kernel is given, the result is written to this file.\n"
@@ -83,7 +85,7 @@ int main(int ac, char* av[]){
 			const double ZXratio = serie.getZXratio();
 			//initialize the finder
 			int dimsint[3] = {dims[2], dims[1], dims[0]};
-			MultiscaleFinder3D finder(dimsint[0], dimsint[1], dimsint[2], 3, preblur_width, vm.count("incore"));
+			MultiscaleFinder3D finder(dimsint[0], dimsint[1], dimsint[2], 3, preblur_width, vm.count("incore"), vm["Octave0-tile"].as<int>());
 			//set the voxel size ratio (sampling in Z is often poorer than in X and Y)
 			//finder.set_ZXratio(serie.getZXratio()); //DISABLED Particles get lost
 			if(!vm.count("Octave0"))
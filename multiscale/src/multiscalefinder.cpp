@@ -40,12 +40,26 @@ namespace Colloids {
 			occ /= 2;
 		}
 	}
-	MultiscaleFinder3D::MultiscaleFinder3D(const int nplanes, const int nrows, const int ncols, const int nbLayers, const double &preblur_radius, bool incore)
+	/**
+	 * \brief Constructor. If Octave0_tile>0, the 0th octave is processed in tiles of that size (in input pixels)
+	 * and only a single tile is kept in memory, instead of the whole upscaled image in a memory mapped file.
+	 */
+	MultiscaleFinder3D::MultiscaleFinder3D(const int nplanes, const int nrows, const int ncols, const int nbLayers, const double &preblur_radius, bool incore, const int Octave0_tile) :
+		Octave0_tile(Octave0_tile)
 	{
+		if(Octave0_tile<0)
+			throw std::invalid_argument("MultiscaleFinder3D: the size of the tiles of the 0th octave must be positive");
+		this->shape[0] = nplanes;
+		this->shape[1] = nrows;
+		this->shape[2] = ncols;
 		//must not fail if the image is too small, construct the 0th octave anyway
 		const int s = (nplanes<10 || nrows<10 || ncols<10)?1:(log(min(nplanes, min(nrows, ncols))/5)/log(2));
 		this->octaves.reserve((size_t)s);
-		this->octaves.push_back(new OctaveFinder3D(2*nplanes, 2*nrows, 2*ncols, nbLayers, preblur_radius, false));
+		if(Octave0_tile>0)
+			//resized below, once the halo of the tiles is known
+			this->octaves.push_back(new OctaveFinder3D(2*min(nplanes, Octave0_tile), 2*min(nrows, Octave0_tile), 2*min(ncols, Octave0_tile), nbLayers, preblur_radius, true));
+		else
+			this->octaves.push_back(new OctaveFinder3D(2*nplanes, 2*nrows, 2*ncols, nbLayers, preblur_radius, false));
 		int opl = nplanes, ocr = nrows, occ = ncols;
 		while(opl >=10 && ocr >= 10 && occ >= 10)
 		{
@@ -54,6 +68,8 @@ namespace Colloids {
 			ocr /= 2;
 			occ /= 2;
 		}
+		if(Octave0_tile>0)
+			this->make_Octave0_tile();
 	}
 
 	MultiscaleFinder::~MultiscaleFinder() {
@@ -106,11 +122,7 @@ namespace Colloids {
     	    throw std::invalid_argument("MultiscaleFinder::fill : the input's cols must match the height of the finder");
     	}
     	if(this->use_Octave0())
-    	{
-			//half preblur and upscale the input to fill the first octave
-			Image upscaled = this->upscale(input);
-			this->octaves[0]->fill(upscaled);
-    	}
+    		this->fill_Octave0(input);
     	if(this->octaves.size()>1)
 			//Octave 1 corresponds to the size of the input image.
 			//To avoid errors in the upsampling+downsampling process, we use the input directly
@@ -122,19 +134,118 @@ namespace Colloids {
     		this->octaves[o]->fill(small);
     	}
     }
+    void MultiscaleFinder::fill_Octave0(const cv::Mat &input)
+    {
+    	//half preblur and upscale the input to fill the first octave
+    	Image upscaled = this->upscale(input);
+    	this->octaves[0]->fill(upscaled);
+    }
+    /**
+     * \brief Fill the 0th octave tile by tile, and look for the centers of each tile as soon as it is filled.
+     *
+     * A tile is made of a core and of a halo on each side, clipped to the image. It is upscaled, blurred and searched on its own.
+     * Only the centers found in the core are kept. The cores do not overlap and the halo covers the support of all the blurs,
+     * so that each center is found once, as in the whole upscaled image.
+     */
+    void MultiscaleFinder3D::fill_Octave0(const cv::Mat &input)
+    {
+    	if(this->Octave0_tile<=0)
+    	{
+    		MultiscaleFinder::fill_Octave0(input);
+    		return;
+    	}
+    	//the halo may have changed with the preblur radius or the ZX ratio
+    	this->make_Octave0_tile();
+    	OctaveFinder3D &o0 = dynamic_cast<OctaveFinder3D&>(*this->octaves[0]);
+    	o0.clear_centers();
+    	int halo[3], tile[3], nb[3];
+    	for(int d=0; d<3; ++d)
+    	{
+    		halo[d] = this->get_Octave0_halo(d);
+    		tile[d] = min(this->shape[d], this->Octave0_tile + 2*halo[d]);
+    		nb[d] = (this->shape[d] + this->Octave0_tile - 1) / this->Octave0_tile;
+    	}
+    	for(int tk=0; tk<nb[0]; ++tk)
+    		for(int tj=0; tj<nb[1]; ++tj)
+    			for(int ti=0; ti<nb[2]; ++ti)
+    			{
+    				const int t[3] = {tk, tj, ti};
+    				cv::Range ranges[3];
+    				std::vector<int> origin(3), first(3), last(3);
+    				for(int d=0; d<3; ++d)
+    				{
+    					//core of the tile, then the tile itself, inside the image
+    					const int c0 = t[d]*this->Octave0_tile,
+    							c1 = min(this->shape[d], c0 + this->Octave0_tile),
+    							s = max(0, min(c0 - halo[d], this->shape[d] - tile[d]));
+    					ranges[d] = cv::Range(s, s + tile[d]);
+    					//in upscaled pixels, x first. The origin is even, so the blocks of the search are aligned with the whole image
+    					origin[2-d] = 2*s;
+    					first[2-d] = 2*(c0 - s);
+    					last[2-d] = 2*(c1 - s);
+    				}
+    				Image upscaled = this->upscale(cv::Mat(input, ranges));
+    				o0.fill(upscaled);
+    				//OctaveFinder::initialize_binary is called with a ratio of 1.2 on the whole 0th octave
+    				o0.append_centers(origin, first, last, 1.2);
+    			}
+    }
+    /**
+     * \brief Number of input pixels by which a tile of the 0th octave extends beyond its core along dimension d (0 for z).
+     * Covers the support of the half preblur, of the interpolation and of the successive blurs,
+     * the margin of the centers to the edges and the neighbourhood used for subpixel resolution.
+     */
+    const int MultiscaleFinder3D::get_Octave0_halo(const int &d) const
+    {
+    	const OctaveFinder3D &o0 = dynamic_cast<const OctaveFinder3D&>(*this->octaves[0]);
+    	const double ratio = d ? 1.0 : o0.get_ZXratio();
+    	//half preblur of the input, then linear interpolation, in upscaled pixels
+    	int reach = 2 * ((int)(2.0*o0.get_radius_preblur()/ratio + 0.5) + 1);
+    	for(size_t l=0; l<o0.get_n_layers()+2; ++l)
+    		reach += (int)(4.0*o0.get_iterative_radius(l)/ratio + 0.5);
+    	reach += o0.get_size(o0.get_n_layers()+2) + 6;
+    	return (reach + 1) / 2;
+    }
+    /**
+     * \brief Allocate the 0th octave to the size of a tile, unless it already has this size.
+     */
+    void MultiscaleFinder3D::make_Octave0_tile()
+    {
+    	const OctaveFinder3D *o0 = dynamic_cast<OctaveFinder3D*>(this->octaves[0]);
+    	int dims[3];
+    	for(int d=0; d<3; ++d)
+    		dims[d] = 2 * min(this->shape[d], this->Octave0_tile + 2*this->get_Octave0_halo(d));
+    	if(o0->get_depth()==dims[0] && o0->get_width()==dims[1] && o0->get_height()==dims[2])
+    		return;
+    	OctaveFinder3D *tile = new OctaveFinder3D(dims[0], dims[1], dims[2], o0->get_n_layers(), o0->get_radius_preblur(), true);
+    	tile->set_ZXratio(o0->get_ZXratio());
+    	delete this->octaves[0];
+    	this->octaves[0] = tile;
+    }
     /**
      * \brief Locate centers with pixel resolutions and scale resolution
      */
 	void MultiscaleFinder::initialize_binary()
 	{
-		const size_t o0 = this->use_Octave0()?0:1;
+		if(this->use_Octave0())
+			this->initialize_binary_Octave0();
 		//initialize binary for each octave
-    	for(size_t o=o0; o<this->octaves.size(); ++o)
+    	for(size_t o=1; o<this->octaves.size(); ++o)
 			this->octaves[o]->initialize_binary();
     	//Remove pixel centers that exist in consecutive octaves
     	/*for(size_t o=0; o<this->octaves.size()-1; ++o)
     		this->octaves[o]->seam_binary(*this->octaves[o+1]);*/
 	}
+	void MultiscaleFinder::initialize_binary_Octave0()
+	{
+		this->octaves[0]->initialize_binary();
+	}
+	void MultiscaleFinder3D::initialize_binary_Octave0()
+	{
+		//the tiles are searched as they are filled
+		if(this->Octave0_tile<=0)
+			MultiscaleFinder::initialize_binary_Octave0();
+	}
 
     MultiscaleFinder::Image MultiscaleFinder2D::downscale(const size_t &o) const
 	{
@@ -244,10 +355,8 @@ namespace Colloids {
 	}
     MultiscaleFinder::Image MultiscaleFinder3D::upscale(const cv::Mat &input) const
 	{
-    	int dims[3] = {
-			dynamic_cast<OctaveFinder3D*>(this->octaves[0])->get_depth(),
-			this->octaves[0]->get_width(),
-			this->octaves[0]->get_height()};
+    	//the input may be the whole image or a tile of it
+    	int dims[3] = {2*input.size[0], 2*input.size[1], 2*input.size[2]};
     	Image halfblurred;
     	input.convertTo(halfblurred, halfblurred.type());
     	inplace_blur3D(halfblurred, this->get_radius_preblur()/2.0, this->get_ZXratio());
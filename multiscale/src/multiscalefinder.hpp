@@ -26,7 +26,7 @@ public:
 	inline const size_t get_n_octaves() const {return this->octaves.size();};
 	inline const OctaveFinder & get_octave(const size_t l) const {return *this->octaves[l];};
 	virtual const size_t get_width() const =0;
-	const size_t get_height() const {return this->octaves[0]->get_height()/2; };
+	virtual const size_t get_height() const {return this->octaves[0]->get_height()/2; };
 	inline const size_t get_n_layers() const {return this->octaves[0]->get_n_layers();};
 	const double & get_radius_preblur() const {return this->octaves[0]->get_radius_preblur();}
 	const double & get_prefactor() const {return this->octaves[0]->get_prefactor();}
@@ -51,6 +51,8 @@ protected:
 	bool Octave0;
 	//Image small, upscaled;
 	MultiscaleFinder():Octave0(true){};
+	virtual void fill_Octave0(const cv::Mat &input);
+	virtual void initialize_binary_Octave0();
 };
 
 class MultiscaleFinder2D : public MultiscaleFinder
@@ -74,9 +76,12 @@ public:
 class MultiscaleFinder3D : public MultiscaleFinder
 {
 public:
-	MultiscaleFinder3D(const int nplanes=256, const int nrows=256, const int ncols=256, const int nbLayers=3, const double &preblur_radius=1.6, bool incore=false);
-	virtual const size_t get_width() const {return this->octaves[0]->get_width()/2; };
-	const size_t get_depth() const {return dynamic_cast<OctaveFinder3D*>(this->octaves[0])->get_depth()/2; };
+	MultiscaleFinder3D(const int nplanes=256, const int nrows=256, const int ncols=256, const int nbLayers=3, const double &preblur_radius=1.6, bool incore=false, const int Octave0_tile=0);
+	virtual const size_t get_width() const {return this->shape[1]; };
+	virtual const size_t get_height() const {return this->shape[2]; };
+	const size_t get_depth() const {return this->shape[0]; };
+	inline const int& get_Octave0_tile() const {return this->Octave0_tile;}
+	const int get_Octave0_halo(const int &d) const;
 	void set_ZXratio(const double &ratio);
 	void set_halfZpreblur(bool value);
 	void set_deconv(bool value=true);
@@ -85,6 +90,14 @@ public:
 	virtual Image downscale(const size_t &o) const;
 	virtual Image upscale(const cv::Mat &input) const;
 	void global_scale2radius(std::vector<Center3D > &centers) const;
+
+protected:
+	int shape[3];
+	/** \brief Size of the core of the tiles of the 0th octave, in input pixels. 0 to upscale the whole image */
+	int Octave0_tile;
+	virtual void fill_Octave0(const cv::Mat &input);
+	virtual void initialize_binary_Octave0();
+	void make_Octave0_tile();
 };
 
 /**
@@ -1,5 +1,6 @@
 #include "octavefinder.hpp"
 #include "deconvolution.hpp"
+#include "../../lib/cpuDispatch.hpp"
 #include <boost/array.hpp>
 #include <algorithm>
 #include <numeric>
@@ -331,6 +332,47 @@ void Colloids::OctaveFinder::preblur_and_fill(Image &input)
 	this->_fill_internal(input);
 }
 
+namespace {
+	/**
+	 * \brief Minimum of each 2x2x2 block of a pair of rows in a pair of layers
+	 *
+	 * Block b spans the pixels 2b and 2b+1 of the rows r00, r01 (first layer) and r10, r11 (second layer).
+	 * The position of the minimum inside the block follows the bit convention of initialize_binary:
+	 * bit 0 for the column, bit 1 for the row, bit 2 for the layer. Ties are resolved as std::min_element.
+	 */
+	inline void rowBlockMin_impl(const float *r00, const float *r01, const float *r10, const float *r11, const int nblocks, float *value, int *pos)
+	{
+		for(int b=0; b<nblocks; ++b)
+		{
+			const float v[8] = {
+					r00[2*b], r00[2*b+1], r01[2*b], r01[2*b+1],
+					r10[2*b], r10[2*b+1], r11[2*b], r11[2*b+1]};
+			float m = v[0];
+			int p = 0;
+			for(int q=1; q<8; ++q)
+			{
+				const bool lower = v[q] < m;
+				m = lower ? v[q] : m;
+				p = lower ? q : p;
+			}
+			value[b] = m;
+			pos[b] = p;
+		}
+	}
+
+	COLLOIDS_DISPATCH_VARIANTS(void, rowBlockMin, rowBlockMin_impl,
+			(const float *r00, const float *r01, const float *r10, const float *r11, const int nblocks, float *value, int *pos),
+			(r00, r01, r10, r11, nblocks, value, pos))
+
+	typedef void (*RowBlockMin)(const float *, const float *, const float *, const float *, const int, float *, int *);
+	void rowBlockMin(const float *r00, const float *r01, const float *r10, const float *r11, const int nblocks, float *value, int *pos)
+	{
+		static const RowBlockMin f = dispatch<RowBlockMin>(
+				rowBlockMin_generic, rowBlockMin_sse42, rowBlockMin_avx2, rowBlockMin_avx512);
+		f(r00, r01, r10, r11, nblocks, value, pos);
+	}
+}
+
 /**
  * \brief Detect local minima of the scale space
  *
@@ -339,6 +381,7 @@ void Colloids::OctaveFinder::preblur_and_fill(Image &input)
  */
 void Colloids::OctaveFinder::initialize_binary(const double & max_ratio)
 {
+	//the block minima of a row are found at once by a kernel dispatched on the instruction set
 	const int nblayers = this->binary.size();
     //initialize
 	this->centers_no_subpix.clear();
@@ -349,26 +392,19 @@ void Colloids::OctaveFinder::initialize_binary(const double & max_ratio)
 	{
 		const Image & layer0 = this->layers[k], layer1 = this->layers[k+1];
 		const int si = max(this->sizes[k]+1, 3);
+		const int nblocks = max(0, (this->get_height() - 2*si + 1) / 2);
+		std::vector<float> block_values(nblocks);
+		std::vector<int> block_pos(nblocks);
 		for(int j = si;j < this->get_width() - si;j += 2)
 		{
-			boost::array<const PixelType*, 4> ngb_ptr = {{
-					&layer0(j, si),
-					&layer0(j+1, si),
-					&layer1(j, si),
-					&layer1(j+1, si)
-			}};
-			for(int i = si;i < this->get_height() -si;i += 2){
-				//copy the whole neighbourhood together for locality
-				boost::array<float, 8> ngb = {{
-						*ngb_ptr[0]++, *ngb_ptr[0]++,
-						*ngb_ptr[1]++, *ngb_ptr[1]++,
-						*ngb_ptr[2]++, *ngb_ptr[2]++,
-						*ngb_ptr[3]++, *ngb_ptr[3]++
-				}};
-				const boost::array<float, 8>::const_iterator mpos = std::min_element(ngb.begin(), ngb.end());
-				if(*mpos>=0.0)
+			if(nblocks>0)
+				rowBlockMin(&layer0(j, si), &layer0(j+1, si), &layer1(j, si), &layer1(j+1, si), nblocks, &block_values[0], &block_pos[0]);
+			for(int bl = 0;bl < nblocks;++bl){
+				if(block_values[bl]>=0.0)
 					continue;
-				const int ml = mpos-ngb.begin(),
+				const int i = si + 2*bl;
+				const float *mpos = &block_values[bl];
+				const int ml = block_pos[bl],
 					mi = i + !!(ml&1),
 					mj = j + !!(ml&2),
 					mk = k + !!(ml&4);
@@ -479,11 +515,26 @@ void Colloids::OctaveFinder1D::initialize_binary(const double & max_ratio)
 }
 
 void Colloids::OctaveFinder3D::initialize_binary(const double & max_ratio)
+{
+	this->clear_centers();
+	std::vector<int> first(3, 0), last(3);
+	for(int d=0; d<3; ++d)
+		last[d] = this->layersG.front().size[2-d];
+	this->append_centers(first, first, last, max_ratio);
+}
+
+/**
+ * \brief Add to the existing centers the ones of the present layers whose pixel is inside [first, last).
+ * The centers are translated by origin.
+ * Coordinates are in x, y, z order.
+ */
+void Colloids::OctaveFinder3D::append_centers(const std::vector<int> &origin, const std::vector<int> &first, const std::vector<int> &last, const double & max_ratio)
 {
 	const int nblayers = this->layersG.size()-3;
-    //initialize
-	this->centers_no_subpix.clear();
-	this->centers.clear();
+	//only the blocks that may contain a pixel inside [first, last) are visited. They keep the parity of the full scan.
+	const int sk = max(this->sizes[1],3),
+			k0 = (first[2]-1 > sk) ? sk + 2*((first[2]-1-sk)/2) : sk,
+			kmax = min(this->layersG.front().size[0] - sk - 1, last[2]);
 
 	//In 3D, the Gaussian layers are stored in (memory mapped) files,
 	//so we have to access the data in large chunks to avoid disk latency.
@@ -495,10 +546,10 @@ void Colloids::OctaveFinder3D::initialize_binary(const double & max_ratio)
 	CircularZ4D circ(this->layersG.size(), this->layersG.front().size[1], this->layersG.front().size[2]);
 	//initial fill of the 6 first planes at every scale
 	for(int l=0; l<(int)this->layersG.size(); ++l)
-		circ.loadplanes(&this->layersG[l](this->sizes[1]-3, 0, 0), l, -3, 6);
+		circ.loadplanes(&this->layersG[l](k0-3, 0, 0), l, -3, 6);
 
 	//dynamic block algorithm in 4D
-	for(int k=max(this->sizes[1],3); k<this->layersG.front().size[0] - max(this->sizes[1],3)-1; k += 2)
+	for(int k=k0; k<kmax; k += 2)
 	{
 		//load the 2 next planes at every scale
 		for(int l=0; l<(int)this->layersG.size(); ++l)
@@ -507,10 +558,14 @@ void Colloids::OctaveFinder3D::initialize_binary(const double & max_ratio)
 		//look for local minima in DoG
 		for(int l=1; l<(int)this->layersG.size()-2; l+=2)
 		{
-			const int si = std::max(this->sizes[l], 3);
+			const int si = std::max(this->sizes[l], 3),
+					j0 = (first[1]-1 > si) ? si + 2*((first[1]-1-si)/2) : si,
+					i0 = (first[0]-1 > si) ? si + 2*((first[0]-1-si)/2) : si,
+					jmax = min(this->layersG.front().size[1] - si-1, last[1]),
+					imax = min(this->layersG.front().size[2] - si-1, last[0]);
 		    #pragma omp parallel for
-			for(int j = si; j < this->layersG.front().size[1] - si-1; j += 2)
-				for(int i = si; i < this->layersG.front().size[2] - si-1; i += 2)
+			for(int j = j0; j < jmax; j += 2)
+				for(int i = i0; i < imax; i += 2)
 				{
 					//DoG block
 					int ml, mk, mj, mi;
@@ -538,15 +593,20 @@ void Colloids::OctaveFinder3D::initialize_binary(const double & max_ratio)
 					ci[1] = mj;
 					ci[2] = mk+k;
 					ci[3] = ml;
-					#pragma omp critical(centers_no_subpix)
-					this->centers_no_subpix.push_back(ci);
+					//the centers outside [first, last) belong to an other part of the image
+					if(ci[0]<first[0] || ci[0]>=last[0] || ci[1]<first[1] || ci[1]>=last[1] || ci[2]<first[2] || ci[2]>=last[2])
+						continue;
 					//subpixel resolution
 					Center3D c;
 					c.intensity = value;
-					c[0] = ci[0] + circ.shift(ml, mk, mj, mi, 0);
-					c[1] = ci[1] + circ.shift(ml, mk, mj, mi, 1);
-					c[2] = ci[2] + circ.shift(ml, mk, mj, mi, 2);
+					for(int d=0; d<3; ++d)
+					{
+						ci[d] += origin[d];
+						c[d] = ci[d] + circ.shift(ml, mk, mj, mi, d);
+					}
 					c.r = ml + circ.shift(ml, mk, mj, mi, 3);
+					#pragma omp critical(centers_no_subpix)
+					this->centers_no_subpix.push_back(ci);
 					#pragma omp critical(centers)
 					this->centers.push_back(c);
 				} //end of finding local minima
@@ -104,6 +104,8 @@ namespace Colloids
 			void load_deconv_kernel(const std::vector<PixelType> &kernel);
 
 			virtual void initialize_binary(const double &max_ratio = 1.1);
+			void append_centers(const std::vector<int> &origin, const std::vector<int> &first, const std::vector<int> &last, const double &max_ratio = 1.1);
+			inline void clear_centers(){this->centers_no_subpix.clear(); this->centers.clear();}
 			virtual void spatial_subpix(const std::vector<int> &ci, Center_base& c) const;
 			virtual double scale_subpix(const std::vector<int> &ci) const;
 			virtual double gaussianResponse(const std::vector<int> &ci, const double & scale) const;
@@ -6,6 +6,7 @@
 #include <boost/progress.hpp>
 #include <boost/array.hpp>
 #include <set>
+#include <algorithm>
 
 using namespace Colloids;
 using namespace boost::posix_time;
@@ -642,6 +643,35 @@ BOOST_AUTO_TEST_SUITE( multiscale3D_call )
 		finder.get_centers(input, v);
 		BOOST_REQUIRE_EQUAL(v.size(),1);
 	}
+	BOOST_AUTO_TEST_CASE( Octave0_tiles )
+	{
+		//small particles along a long image, so that the tiles of the 0th octave overlap along x
+		int dims[3] = {24, 24, 120};
+		cv::Mat_<uchar>input(3, dims, (unsigned char)0);
+		input.setTo(0);
+		for(int p=0; p<10; ++p)
+			drawsphere(input, 12, 8+8*(p%2), 6+11*p, 2.5, (unsigned char)255);
+		MultiscaleFinder3D whole(24, 24, 120), tiled(24, 24, 120, 3, 1.6, false, 24);
+		BOOST_CHECK_EQUAL(tiled.get_depth(), 24);
+		BOOST_CHECK_EQUAL(tiled.get_width(), 24);
+		BOOST_CHECK_EQUAL(tiled.get_height(), 120);
+		//only a tile of the 0th octave is allocated
+		BOOST_CHECK_LT(tiled.get_octave(0).get_height(), 240);
+		BOOST_CHECK_EQUAL(tiled.get_octave(0).get_height(), 2*(24 + 2*tiled.get_Octave0_halo(2)));
+		std::vector<Center3D> v, w;
+		whole.get_centers(input, v);
+		tiled.get_centers(input, w);
+		BOOST_CHECK_EQUAL(tiled.get_octave(0).get_nb_centers(), whole.get_octave(0).get_nb_centers());
+		BOOST_REQUIRE_EQUAL(w.size(), v.size());
+		std::sort(v.begin(), v.end(), by_coordinate<Center3D>(0));
+		std::sort(w.begin(), w.end(), by_coordinate<Center3D>(0));
+		for(size_t c=0; c<v.size(); ++c)
+		{
+			for(int d=0; d<3; ++d)
+				BOOST_CHECK_SMALL(w[c][d] - v[c][d], 1e-3);
+			BOOST_CHECK_SMALL(w[c].r - v[c].r, 1e-3);
+		}
+	}
 BOOST_AUTO_TEST_SUITE_END() //multiscale 3D call
 
 BOOST_AUTO_TEST_SUITE( john )